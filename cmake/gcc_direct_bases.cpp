@@ -0,0 +1,15 @@
+// The GCC intrinsic __direct_bases(T) expands to the direct bases of T
+template<typename... Bases>
+struct base_list {};
+
+struct Base1 {};
+struct Base2 {};
+struct Derived : public Base1, public Base2 {};
+
+template<typename T>
+using direct_bases = base_list<__direct_bases(T)...>;
+
+int main() {
+    direct_bases<Derived> bases;
+    ((void)bases);
+}
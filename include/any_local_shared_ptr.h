@@ -0,0 +1,476 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include "any_ptr.h"
+#include "any_shared_ptr.h"
+#include "call_site_cache.h"
+#include "dynamic_up_cast.h"
+#include "held_type.h"
+#include "trivially_relocatable.h"
+#ifdef _MSC_VER
+  #if _HAS_CXX17 != 0
+    #include <optional>
+    #define ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#else
+  #if __has_include(<optional>) // requires GCC 5 or greater
+    #include <optional>
+    #define ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL 
+  #else
+    #include <experimental/optional>
+    namespace std {
+      using std::experimental::optional;
+    } // namespace std
+    #define ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#endif
+
+namespace xxx {
+
+  namespace detail {
+
+    // The control block shared by the handles, and by the local_shared_ptr returned by the casts,
+    // that own the same object. The count isn't atomic as it's confined to the thread that created it,
+    // which is asserted in a debug build.
+    struct local_control_block
+    {
+      const held_type *   my_held_type;
+      // The owned object as its unqualified type
+      void *              my_ptr;
+      // Deletes the object and the control block
+      void                (*my_destroy)(local_control_block * block) noexcept;
+      long                my_use_count{ 1 };
+      // Always stored, so the layout doesn't depend on NDEBUG, though only a debug build checks it
+      std::thread::id     my_thread{ std::this_thread::get_id() };
+
+      void assert_owner_thread() const noexcept
+      {
+        assert(my_thread == std::this_thread::get_id() && "a local shared pointer is confined to the thread that created it");
+      }
+
+      static local_control_block * acquire(local_control_block * block) noexcept
+      {
+        if (block != nullptr) {
+          block->assert_owner_thread();
+          ++block->my_use_count;
+        }
+        return block;
+      }
+
+      static void release(local_control_block * block) noexcept
+      {
+        if (block != nullptr) {
+          block->assert_owner_thread();
+          if (--block->my_use_count == 0) {
+            block->my_destroy(block);
+          }
+        }
+      }
+    };
+
+    // The control block of an object that's allocated along with it by make_any_local_shared_ptr
+    template<typename T>
+    struct local_inplace_block : local_control_block
+    {
+      T   my_value;
+
+      template<typename... Args>
+      local_inplace_block(const held_type * held, Args&&... args)
+        : local_control_block{ held, nullptr, &destroy }
+        , my_value(std::forward<Args>(args)...)
+      {
+        my_ptr = &my_value;
+      }
+
+      static void destroy(local_control_block * block) noexcept { delete static_cast<local_inplace_block*>(block); }
+    };
+
+    // Deletes an object that was adopted from a std::unique_ptr<T> along with its control block
+    template<typename T>
+    void destroy_adopted(local_control_block * block) noexcept
+    {
+      delete static_cast<T*>(block->my_ptr);
+      delete block;
+    }
+
+  } // namespace detail
+
+  inline namespace v1 {
+
+    class any_local_shared_ptr;
+
+    /**
+      The class local_shared_ptr<T> is the shared pointer to T that's returned by the casts of an
+      any_local_shared_ptr. Like the any_local_shared_ptr, its reference count isn't atomic and so 
+      it mustn't be copied or destroyed on another thread.
+    */
+    template<typename T>
+    class local_shared_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors/dtor and copy operators
+
+      ~local_shared_ptr() { detail::local_control_block::release(my_block); }
+
+      local_shared_ptr(local_shared_ptr const & other) noexcept 
+        : my_block{ detail::local_control_block::acquire(other.my_block) }
+        , my_ptr{ other.my_ptr }
+      {
+      }
+
+      local_shared_ptr(local_shared_ptr && other) noexcept
+        : my_block{ std::exchange(other.my_block, nullptr) }
+        , my_ptr{ std::exchange(other.my_ptr, nullptr) }
+      {
+      }
+
+      local_shared_ptr& operator=(local_shared_ptr const& other) noexcept
+      {
+        local_shared_ptr{ other }.swap(*this);
+        return *this;
+      }
+
+      local_shared_ptr& operator=(local_shared_ptr && other) noexcept
+      {
+        local_shared_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // ctors
+
+      constexpr local_shared_ptr() noexcept = default;
+
+      constexpr local_shared_ptr(std::nullptr_t) noexcept {}
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // swaps two local_shared_ptr objects
+      void swap(local_shared_ptr & other) noexcept 
+      { 
+        std::swap(my_block, other.my_block);
+        std::swap(my_ptr, other.my_ptr);
+      }
+
+      // reset to empty state 
+      void reset() noexcept { local_shared_ptr{}.swap(*this); }
+
+      //-----------------------------------------------------
+      // Observers
+
+      T * get() const noexcept { return my_ptr; }
+
+      T & operator*() const noexcept { return *my_ptr; }
+
+      T * operator->() const noexcept { return my_ptr; }
+
+      explicit operator bool() const noexcept { return my_ptr != nullptr; }
+
+      // returns the number of handles and local_shared_ptr objects that own the object
+      long use_count() const noexcept { return my_block != nullptr ? my_block->my_use_count : 0; }
+
+    private:
+
+      detail::local_control_block *   my_block{ nullptr };
+      T *                             my_ptr{ nullptr };
+
+      // Takes over the reference to 'block' 
+      local_shared_ptr(detail::local_control_block * block, T * ptr) noexcept : my_block{ block }, my_ptr{ ptr } {}
+
+      friend class any_local_shared_ptr;
+    };
+
+    template<typename T>
+    bool operator==(local_shared_ptr<T> const & lhs, std::nullptr_t) noexcept { return lhs.get() == nullptr; }
+
+    template<typename T>
+    bool operator!=(local_shared_ptr<T> const & lhs, std::nullptr_t) noexcept { return lhs.get() != nullptr; }
+
+    template<typename T, typename U>
+    bool operator==(local_shared_ptr<T> const & lhs, local_shared_ptr<U> const & rhs) noexcept { return lhs.get() == rhs.get(); }
+
+    template<typename T, typename U>
+    bool operator!=(local_shared_ptr<T> const & lhs, local_shared_ptr<U> const & rhs) noexcept { return lhs.get() != rhs.get(); }
+
+    /**
+      The class any_local_shared_ptr is an any_shared_ptr for an object graph that's confined 
+      to one thread e.g. per-connection state in a shard-per-core server. It has the same casting
+      API as v3::any_shared_ptr except a cast returns a local_shared_ptr<T> rather than a 
+      std::shared_ptr<T>:
+
+        xxx::any_local_shared_ptr a = xxx::make_any_local_shared_ptr<Derived>();
+        xxx::local_shared_ptr<const Base> p = xxx::any_shared_ptr_cast<const Base>( a ); // cv-promotion and up cast succeed
+
+      The handle is a pointer to a control block that holds a count that isn't atomic, so copying
+      a handle or casting it is a plain increment. In a debug build every copy, cast and 
+      destruction asserts that it's on the thread that created the object.
+    */
+    class any_local_shared_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors/dtor and copy operators
+
+      ~any_local_shared_ptr() { detail::local_control_block::release(my_block); }
+
+      any_local_shared_ptr(any_local_shared_ptr const & other) noexcept : my_block{ detail::local_control_block::acquire(other.my_block) } {}
+
+      any_local_shared_ptr(any_local_shared_ptr && other) noexcept : my_block{ std::exchange(other.my_block, nullptr) } {}
+
+      any_local_shared_ptr& operator=(any_local_shared_ptr const& other) noexcept
+      {
+        any_local_shared_ptr{ other }.swap(*this);
+        return *this;
+      }
+
+      any_local_shared_ptr& operator=(any_local_shared_ptr && other) noexcept
+      {
+        any_local_shared_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // ctors
+
+      constexpr any_local_shared_ptr() noexcept = default;
+
+      // Takes ownership of the object owned by 'ptr', which allocates a control block
+      template<typename T>
+      any_local_shared_ptr(std::unique_ptr<T> && ptr)
+      {
+        static_assert(!std::is_array<T>::value, "any_local_shared_ptr doesn't support arrays");
+        if (ptr != nullptr) {
+          my_block = new detail::local_control_block{ &held_type_of<T>(), const_cast<std::remove_cv_t<T>*>(ptr.get()), &detail::destroy_adopted<std::remove_cv_t<T>> };
+          ptr.release();
+        }
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // swaps two any objects
+      void swap(any_local_shared_ptr & other) noexcept { std::swap(my_block, other.my_block); }
+
+      // reset to empty state 
+      void reset() noexcept { any_local_shared_ptr{}.swap(*this); }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // return true if not empty
+      bool has_value() const noexcept { return my_block != nullptr; }
+
+      // Returns typeid(local_shared_ptr<T>) if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info & type() const noexcept { return *held().type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return held().type_id(); }
+
+      // returns the number of handles and local_shared_ptr objects that own the object
+      long  use_count() const noexcept { return my_block != nullptr ? my_block->my_use_count : 0; }
+
+      // Returns an any_ptr that views the object without owning it whose casts are the same as 
+      // any_shared_ptr_cast. It's only valid while the object is owned.
+      any_ptr view() const noexcept { return detail::any_ptr_view(held(), my_block != nullptr ? my_block->my_ptr : nullptr); }
+
+    private:
+
+      // Points to the control block, otherwise nullptr to indicate an empty state.
+      detail::local_control_block *   my_block{ nullptr };
+
+      explicit any_local_shared_ptr(detail::local_control_block * block) noexcept : my_block{ block } {}
+
+      template<typename T>
+      using HeldType = local_shared_ptr<T>;
+
+      template<typename T>
+      static constexpr const detail::held_type & held_type_of() noexcept
+      {
+        return detail::held_type_v<T, HeldType<T>, HeldType<std::remove_cv_t<T>>>;
+      }
+
+      const detail::held_type & held() const noexcept { return my_block != nullptr ? *my_block->my_held_type : detail::empty_held_type; }
+
+      // Attempt a dynamic up cast to T to replicate an implicit up cast
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      local_shared_ptr<T> dynamic_up_cast(bool & cast_ok, Site&... site) const noexcept
+      {
+        if (has_value()) {
+          const detail::held_type & held{ *my_block->my_held_type };
+          if (detail::is_same_unqualified_type(held, held_type_of<T>())) { // is the same type up to cv-qualifiers
+            if (held.is_cv_promotable_to(detail::cv_qualifiers_of<T>())) {
+              cast_ok = true;
+              return local_shared_ptr<T>{ detail::local_control_block::acquire(my_block), static_cast<T*>(my_block->my_ptr) };
+            }
+            // else the cast drops cv-qualifiers
+          }
+          else { // try an up-cast
+            void * ptr = my_block->my_ptr;
+            if (detail::dynamic_up_cast<T>(held, ptr, site...)) { // up-cast succeeded
+              cast_ok = true;
+              return local_shared_ptr<T>{ detail::local_control_block::acquire(my_block), static_cast<T*>(ptr) };
+            }
+          }
+        }
+        return local_shared_ptr<T>{};
+      }
+
+      template<typename T, typename... Args>
+      friend any_local_shared_ptr make_any_local_shared_ptr(Args&&... args);
+
+      template<typename T>
+      friend local_shared_ptr<T> any_shared_ptr_cast(any_local_shared_ptr const & anySharedPtr);
+
+      template<typename T>
+      friend local_shared_ptr<T> any_shared_ptr_cast(any_local_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<local_shared_ptr<T>> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<local_shared_ptr<T>> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<local_shared_ptr<T>> with std::pair<local_shared_ptr<T>,bool>
+      template<typename T>
+      friend std::pair<local_shared_ptr<T>, bool> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<local_shared_ptr<T>, bool> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#endif
+
+    };
+
+    static_assert(sizeof(any_local_shared_ptr) == sizeof(void*), "any_local_shared_ptr should be the size of a pointer");
+
+    //-----------------------------------------------------------------------------------------------------
+
+    template<typename T>
+    local_shared_ptr<T> any_shared_ptr_cast(any_local_shared_ptr const & anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL
+    template<typename T>
+    std::optional<local_shared_ptr<T>> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<local_shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+#else // replace std::optional<local_shared_ptr<T>> with std::pair<local_shared_ptr<T>,bool>
+    template<typename T>
+    std::pair<local_shared_ptr<T>, bool> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As above except the up cast is cached in the call site's cache - see ANY_SHARED_PTR_CAST
+
+    template<typename T>
+    local_shared_ptr<T> any_shared_ptr_cast(any_local_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<local_shared_ptr<T>> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<local_shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<local_shared_ptr<T>> with std::pair<local_shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<local_shared_ptr<T>, bool> any_shared_ptr_cast(any_local_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      local_shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    // Constructs an any_local_shared_ptr that owns a T, passing the provided arguments to the 
+    // constructor of T. The control block and T are allocated in a single allocation.
+    template<typename T, typename... Args>
+    any_local_shared_ptr make_any_local_shared_ptr(Args&&... args)
+    {
+      using block = detail::local_inplace_block<std::remove_cv_t<T>>;
+      return any_local_shared_ptr{ new block(&any_local_shared_ptr::held_type_of<T>(), std::forward<Args>(args)...) };
+    }
+
+  } // namespace v1
+
+  // A pointer to the control block that's relocated by copying its bytes - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<any_local_shared_ptr> : std::true_type {};
+  template<typename T> struct is_trivially_relocatable<local_shared_ptr<T>> : std::true_type {};
+
+} // namespace xxx
+
+
+namespace std {
+
+  inline void swap(xxx::any_local_shared_ptr & lhs, xxx::any_local_shared_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+} // namespace std
+
+#ifdef ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL 
+#undef ANY_LOCAL_SHARED_PTR_HAS_LIB_OPTIONAL 
+#endif
@@ -23,6 +23,9 @@
 #include <utility>
 #include <typeinfo>
 #include <type_traits>
+#include <variant>
+#include "dynamic_up_cast.h"
+#include "held_type.h"
 #ifdef _MSC_VER
   #if _HAS_CXX17 != 0
     #include <optional>
@@ -31,11 +34,13 @@
 #else
   #if __has_include(<optional>) // requires GCC 5 or greater
     #include <optional>
+    #define ANY_PTR_HAS_LIB_OPTIONAL 
   #else
     #include <experimental/optional>
     namespace std {
       using std::experimental::optional;
     } // namespace std
+    #define ANY_PTR_HAS_LIB_OPTIONAL 
   #endif
 #endif
 
@@ -52,6 +57,31 @@ namespace xxx {
     virtual const char* what() const noexcept override { return "bad any_ptr cast"; }
   };
 
+  inline namespace v1 {
+    class any_ptr;
+  } // namespace v1
+
+  namespace detail {
+
+    // Returns an any_ptr that views the object 'ptr' of a held pointer that's described by 'held'
+    // e.g. the object of a shared_ptr<T>, with the same cv-qualifiers and up casts.
+    any_ptr any_ptr_view(const held_type & held, void * ptr) noexcept;
+
+    // Grants any_ptr_visit access to the held pointer and its held_type
+    struct any_ptr_access;
+
+    // Returns the Variant with the alternative index + 1 set to make(std::integral_constant<std::size_t, index>{}),
+    // or the std::monostate alternative if 'index' isn't one of I... - see any_ptr_cast_first
+    template<typename Variant, typename Make, std::size_t... I>
+    Variant make_first_variant(std::size_t index, Make && make, std::index_sequence<I...>) noexcept
+    {
+      Variant result;
+      (void)((index == I && (result.template emplace<I + 1>(make(std::integral_constant<std::size_t, I>{})), true)) || ...);
+      return result;
+    }
+
+  } // namespace detail
+
   inline namespace v1 {
 
     /**
@@ -97,9 +127,8 @@ namespace xxx {
 
       template<typename T>
       any_ptr(T* ptr) noexcept
-        : my_type_info{ &typeid(HeldType<T>) }
-        , my_ptr{ const_cast<HeldType<T>> (ptr) }
-        , my_throw_func{ &any_ptr::throw_function<HeldBaseType<T>> }
+        : my_held_type{ &detail::held_type_v<T> }
+        , my_ptr{ const_cast<std::remove_cv_t<T>*>(ptr) }
       {
       }
 
@@ -123,60 +152,66 @@ namespace xxx {
       // Observers
 
       // Returns true if instance is non-empty.
-      bool has_value() const noexcept { return my_throw_func != nullptr; }
+      bool has_value() const noexcept { return my_held_type->up_cast != nullptr; }
 
       // Returns the typeid(T*) of the contained pointer T* if instance is non-empty,
       // otherwise typeid(void).
-      const std::type_info& type() const noexcept { return *my_type_info; }
+      const std::type_info& type() const noexcept { return *my_held_type->type; }
 
-    private:
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return my_held_type->type_id(); }
 
-      template<typename T>
-      using HeldBaseType = T;
+    private:
 
       template<typename T>
       using HeldType = std::add_pointer_t<T>;
 
-      using Throw_func = void(void *);
-
-      // The typeid(T*) of the held pointer, 
-      // otherwise set to typeid(void) to indicate an empty state.
-      const std::type_info *  my_type_info{ & typeid(void) };
+      // Describes the held pointer type T* (see type()) including the function that 
+      // implements a dynamic up cast, otherwise set to typeid(void) to indicate an empty state.
+      const detail::held_type *   my_held_type{ &detail::empty_held_type };
       // The held pointer
-      void*                   my_ptr{ nullptr };
-      // The throw function that implements a dynamic up cast
-      Throw_func *            my_throw_func{ nullptr };
+      void*                       my_ptr{ nullptr };
 
       // Attempt a dynamic up cast to T to replicate an implicit up cast. 
       // If the cast is successful then return { ptr , true } where ptr is the casted pointer
       // otherwise return { nullptr , false }.
-      template <typename T>
-      std::pair<T*,bool> dynamic_up_cast() const noexcept
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      std::pair<T*,bool> dynamic_up_cast(Site&... site) const noexcept
       {
         std::pair<T*, bool> result{ nullptr, false };
-        if (type() == typeid(HeldType<T>)) { // cast succeeded
-          result.first = static_cast<T*>(my_ptr);
-          result.second = true;
-        }
-        else if (has_value()) { // attempt a dynamic up cast by throwing an exception
-          try {
-            my_throw_func(const_cast<void*>(my_ptr));
-          }
-          catch (T* const ptr) { // up cast succeeded
-            result.first = ptr;
+        if (detail::is_same_unqualified_type(*my_held_type, detail::held_type_v<T>)) { // same type up to cv-qualifiers
+          if (my_held_type->is_cv_promotable_to(detail::cv_qualifiers_of<T>())) { // cast succeeded
+            result.first = static_cast<T*>(my_ptr);
             result.second = true;
           }
-          catch (...) { // up cast failed
+          // else the cast drops cv-qualifiers
+        }
+        else if (has_value()) { // attempt a dynamic up cast
+          void * ptr = my_ptr;
+          if (detail::dynamic_up_cast<T>(*my_held_type, ptr, site...)) { // up cast succeeded
+            result.first = static_cast<T*>(ptr);
+            result.second = true;
           }
         }
         // else dynamic up cast failed
         return result;
       }
 
-      template<typename T>
-      static void throw_function(void * const ptr)
+      // As dynamic_up_cast() except a cast that isn't an up cast is resolved with the semantics of 
+      // dynamic_cast from the most derived object i.e. a down cast or a cross cast (see dynamic_cross_cast).
+      template <typename T>
+      std::pair<T*, bool> full_dynamic_cast() const noexcept
       {
-        throw static_cast<T*>(ptr);
+        std::pair<T*, bool> result = dynamic_up_cast<T>();
+        if (!result.second) {
+          void * ptr = my_ptr;
+          if (detail::dynamic_cross_cast<T>(*my_held_type, ptr)) {
+            result.first = static_cast<T*>(ptr);
+            result.second = true;
+          }
+        }
+        return result;
       }
 
 #ifdef ANY_PTR_HAS_LIB_OPTIONAL
@@ -184,17 +219,64 @@ namespace xxx {
       template<typename T>
       friend std::optional<T*> any_ptr_cast(any_ptr const * any_ptr_) noexcept;
 
+      template<typename T>
+      friend std::optional<T*> any_ptr_cast(any_ptr const * any_ptr_, call_site_cache<T> & site) noexcept;
+
+      template<typename T>
+      friend std::optional<T*> any_ptr_dynamic_cast(any_ptr const * any_ptr_) noexcept;
+
 #else // replace std::optional<T*> with std::pair<T*, bool>
 
       template<typename T>
-      std::pair<T*, bool> any_ptr_cast(const any_ptr * any_ptr_) noexcept;
+      friend std::pair<T*, bool> any_ptr_cast(const any_ptr * any_ptr_) noexcept;
+
+      template<typename T>
+      friend std::pair<T*, bool> any_ptr_cast(const any_ptr * any_ptr_, call_site_cache<T> & site) noexcept;
+
+      template<typename T>
+      friend std::pair<T*, bool> any_ptr_dynamic_cast(const any_ptr * any_ptr_) noexcept;
 
 #endif
 
       template<typename T>
       friend T* any_ptr_cast(any_ptr const & any_ptr_);
+
+      template<typename T>
+      friend T* any_ptr_cast(any_ptr const & any_ptr_, call_site_cache<T> & site);
+
+      template<typename T>
+      friend T* any_ptr_dynamic_cast(any_ptr const & any_ptr_);
+
+      template<typename... Ts>
+      friend std::variant<std::monostate, Ts*...> any_ptr_cast_first(any_ptr const & any_ptr_) noexcept;
+
+      friend class caching_any_ptr;
+      friend class tagged_any_ptr;
+      friend class any_unique_ptr;
+      friend any_ptr detail::any_ptr_view(const detail::held_type & held, void * ptr) noexcept;
+      friend struct detail::any_ptr_access;
     };
 
+    // A held pointer plus a pointer to the static held_type of its type
+    static_assert(sizeof(any_ptr) == 2 * sizeof(void*), "any_ptr should be the size of two pointers");
+    static_assert(std::is_trivially_copyable<any_ptr>::value, "any_ptr should be trivially copyable");
+
+  } // namespace v1
+
+  namespace detail {
+
+    inline any_ptr any_ptr_view(const held_type & held, void * ptr) noexcept
+    {
+      any_ptr result;
+      result.my_held_type = held.pointer;
+      result.my_ptr = ptr;
+      return result;
+    }
+
+  } // namespace detail
+
+  inline namespace v1 {
+
     //-----------------------------------------------------------------------------------------------------
 
 
@@ -231,6 +313,96 @@ namespace xxx {
       throw bad_any_ptr_cast();
     }
 
+    //-----------------------------------------------------------------------------------------------------
+    // As above except the up cast is cached in the call site's cache - see ANY_PTR_CAST
+
+#ifdef ANY_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_ptr_cast(const any_ptr * any_ptr_, call_site_cache<T> & site) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = any_ptr_->template dynamic_up_cast<T>(site);
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_ptr_cast(const any_ptr * any_ptr_, call_site_cache<T> & site) noexcept
+    {
+      return any_ptr_->template dynamic_up_cast<T>(site);
+    }
+
+#endif
+
+    template<typename T>
+    T* any_ptr_cast(any_ptr const & any_ptr_, call_site_cache<T> & site)
+    {
+      const std::pair<T*, bool> result = any_ptr_.template dynamic_up_cast<T>(site);
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_ptr_cast();
+    }
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_ptr_cast except, when the held pointer is to a polymorphic class, a cast that isn't an 
+    // up cast has the semantics of dynamic_cast i.e. a down cast or a cross cast. The up cast is tried 
+    // first so an up cast costs the same as any_ptr_cast.
+
+#ifdef ANY_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_ptr_dynamic_cast(const any_ptr * any_ptr_) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = any_ptr_->template full_dynamic_cast<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_ptr_dynamic_cast(const any_ptr * any_ptr_) noexcept
+    {
+      return any_ptr_->template full_dynamic_cast<T>();
+    }
+
+#endif
+
+    template<typename T>
+    T* any_ptr_dynamic_cast(any_ptr const & any_ptr_)
+    {
+      const std::pair<T*, bool> result = any_ptr_.template full_dynamic_cast<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_ptr_cast();
+    }
+
+    //-----------------------------------------------------------------------------------------------------
+    // Returns the held pointer cast to the first of Ts... that the cast succeeds for, or std::monostate if 
+    // there's none, where the alternative index + 1 is set for Ts[index]. Unlike trying any_ptr_cast 
+    // for each in turn, the candidates that aren't resolved by the up cast caches cost a single up cast 
+    // e.g. a single throw for the portable engine.
+
+    template<typename... Ts>
+    std::variant<std::monostate, Ts*...> any_ptr_cast_first(any_ptr const & any_ptr_) noexcept
+    {
+      void * ptr = any_ptr_.my_ptr;
+      const std::size_t index = detail::dynamic_up_cast_first<Ts...>(*any_ptr_.my_held_type, ptr);
+      return detail::make_first_variant<std::variant<std::monostate, Ts*...>>(index, 
+        [ptr](auto i) noexcept { return static_cast<detail::nth_type_t<decltype(i)::value, Ts...>*>(ptr); }, 
+        std::index_sequence_for<Ts...>{});
+    }
+
   } // namespace v2
 
 } // namespace xxx
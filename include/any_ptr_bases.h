@@ -0,0 +1,445 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "up_cast_cache.h"
+#include "itanium_rtti.h"
+#include "type_fingerprint.h"
+
+// The GCC intrinsic __direct_bases is detected by the build (see cmake/gcc_direct_bases.cpp), 
+// define ANY_PTR_DISABLE_BASE_DISCOVERY to only use the bases listed by any_ptr_bases.
+#if defined(HAVE_GCC_DIRECT_BASES) && !defined(ANY_PTR_DISABLE_BASE_DISCOVERY)
+#define ANY_PTR_HAS_DIRECT_BASES
+#endif
+
+namespace xxx {
+
+  // A list of base classes - see any_ptr_bases
+  template<typename... Bases>
+  struct base_list {};
+
+  /**
+    The trait any_ptr_bases lists the direct public non-virtual base classes of T.
+    It's opt-in, so by default no bases are listed, and is specialised for a class 
+    hierarchy known at compile time, e.g.
+
+      struct Derived : public Base1, public Base2 {};
+
+      template<>
+      struct xxx::any_ptr_bases<Derived> { using type = xxx::base_list<Base1, Base2>; };
+
+    or equivalently
+
+      ANY_PTR_BASES(Derived, Base1, Base2);
+
+    any_ptr and any_shared_ptr record a table of the ancestors of the held type, 
+    i.e. the listed bases, their listed bases and so on, along with their static offsets. 
+    An up cast to an ancestor with a static offset is then a scan of the table and a pointer 
+    adjustment without walking the RTTI or throwing an exception. Up casts to the other bases 
+    use the dynamic up cast. A specialisation should list all the direct bases of T as an 
+    unlisted base could make a listed ancestor ambiguous.
+
+    When the compiler provides the GCC intrinsic __direct_bases (see ANY_PTR_HAS_DIRECT_BASES) 
+    the direct bases of a class that isn't listed are discovered automatically. The discovered 
+    private, protected and virtual bases, and their ancestors, are recorded without an offset 
+    so an up cast to them is still resolved by the dynamic up cast.
+
+    A class whose bases are listed, or whose discovered ancestors are all public non-virtual 
+    bases, uses the table built from the static offsets. Otherwise, when the RTTI layout is 
+    known (see ANY_PTR_HAS_ITANIUM_RTTI), the table of a class is instead flattened from its 
+    RTTI on its first up cast, which also records the outcome for a virtual or non-public 
+    ancestor.
+  */
+  template<typename T>
+  struct any_ptr_bases
+  {
+    using type = base_list<>;
+  };
+
+  namespace detail {
+
+    // A base class subobject of the held type where 'type' is typeid(B) of its class B, 'vbase' is the nearest
+    // virtual base on its path (if any) and 'offset' is its offset from 'vbase', or else from the held object,
+    // 'is_public' is true if each base on its path is public and 'is_known' is false if only 'type' is known.
+    // If non-zero, the offset of 'vbase' is stored at 'vtable_offset' in the vtable of the subobject at 'vbase_path'.
+    struct base_subobject
+    {
+      const std::type_info *  type;
+      const std::type_info *  vbase;
+      std::ptrdiff_t          offset;
+      bool                    is_public;
+      bool                    is_known;
+      std::ptrdiff_t          vbase_path{ 0 };
+      std::ptrdiff_t          vtable_offset{ 0 };
+
+      bool is_same_subobject(const base_subobject & other) const noexcept
+      {
+        if (offset != other.offset) {
+          return false;
+        }
+        if (vbase == nullptr || other.vbase == nullptr) {
+          return vbase == other.vbase;
+        }
+        return *vbase == *other.vbase;
+      }
+    };
+
+    // An ancestor B of the held type where 'result' is the outcome of an up cast to B:
+    //   static_offset - B is at 'offset' from the held object
+    //   dynamic_offset - B is at 'offset' from the virtual base located as in base_subobject
+    //   failed - B is ambiguous or isn't public
+    //   unknown - B must be resolved by the dynamic up cast
+    // 'fingerprint' is the fingerprint_of(typeid(B)).
+    struct ancestor
+    {
+      std::ptrdiff_t  offset;
+      std::ptrdiff_t  vbase_path;
+      std::ptrdiff_t  vtable_offset;
+      up_cast_result  result;
+      std::uint64_t   fingerprint;
+
+      // Returns the outcome of an up cast of the held pointer 'ptr' to B where 'ptr' is adjusted if it succeeds
+      up_cast_result up_cast(void*& ptr) const noexcept
+      {
+        if (ptr != nullptr) {
+          if (result == up_cast_result::static_offset) {
+            ptr = static_cast<char*>(ptr) + offset;
+          }
+          else if (result == up_cast_result::dynamic_offset) {
+            char * const derived = static_cast<char*>(ptr) + vbase_path;
+            const char * const vtable = *reinterpret_cast<const char* const*>(derived);
+            ptr = derived + *reinterpret_cast<const std::ptrdiff_t*>(vtable + vtable_offset) + offset;
+          }
+        }
+        return result;
+      }
+    };
+
+    // The ancestors of a type, one entry per ancestor class
+    struct base_table
+    {
+      // typeid(B) of each ancestor B sorted by address
+      const std::type_info * const *  types;
+      const ancestor *                ancestors;
+      std::size_t                     size;
+
+      // Returns the ancestor 'target' i.e. typeid(B) with the fingerprint 'fingerprint', or nullptr if 'target' isn't an ancestor
+      const ancestor * find(const std::type_info & target, std::uint64_t fingerprint) const noexcept
+      {
+        // Comparing the addresses is sufficient unless typeid(B) has more than one instance e.g. across shared libraries 
+        const std::type_info * const * const last = types + size;
+        const std::type_info * const * const it = std::lower_bound(types, last, &target, std::less<const std::type_info*>());
+        if (it != last && *it == &target) {
+          return ancestors + (it - types);
+        }
+        for (std::size_t i = 0; i < size; ++i) {
+          if (!is_different_fingerprint(ancestors[i].fingerprint, fingerprint) && *types[i] == target) {
+            return ancestors + i;
+          }
+        }
+        return nullptr;
+      }
+    };
+
+    // The storage of a base_table that's flattened from the base class subobjects of a type
+    class flat_base_table
+    {
+    public:
+
+      explicit flat_base_table(const std::vector<base_subobject> & subobjects)
+      {
+        std::vector<std::pair<const std::type_info*, ancestor>> ancestors;
+        std::vector<bool> is_merged(subobjects.size(), false);
+        for (std::size_t i = 0; i < subobjects.size(); ++i) {
+          if (is_merged[i]) {
+            continue;
+          }
+          const base_subobject & first = subobjects[i];
+          bool is_known{ first.is_known };
+          bool is_public{ first.is_public };
+          bool is_ambiguous{ false };
+          const base_subobject * located{ &first };
+          for (std::size_t j = i + 1; j < subobjects.size(); ++j) {
+            const base_subobject & other = subobjects[j];
+            if (is_merged[j] || *other.type != *first.type) {
+              continue;
+            }
+            is_merged[j] = true;
+            if (!is_known || !other.is_known) {
+              is_known = false;
+            }
+            else if (first.is_same_subobject(other)) { // e.g. a virtual base reached by another path
+              is_public = is_public || other.is_public;
+              if (located->vtable_offset == 0) {
+                located = &other;
+              }
+            }
+            else {
+              is_ambiguous = true;
+            }
+          }
+          ancestor entry{ 0, 0, 0, up_cast_result::unknown, fingerprint_of(*first.type) };
+          if (is_known) {
+            if (is_ambiguous || !is_public) {
+              entry.result = up_cast_result::failed;
+            }
+            else if (first.vbase == nullptr) {
+              entry.offset = first.offset;
+              entry.result = up_cast_result::static_offset;
+            }
+            else if (located->vtable_offset != 0) {
+              entry.offset = first.offset;
+              entry.vbase_path = located->vbase_path;
+              entry.vtable_offset = located->vtable_offset;
+              entry.result = up_cast_result::dynamic_offset;
+            }
+          }
+          ancestors.emplace_back(first.type, entry);
+        }
+        std::sort(ancestors.begin(), ancestors.end(), [](const auto & lhs, const auto & rhs) {
+          return std::less<const std::type_info*>()(lhs.first, rhs.first);
+        });
+        my_types.reserve(ancestors.size());
+        my_ancestors.reserve(ancestors.size());
+        for (const auto & entry : ancestors) {
+          my_types.push_back(entry.first);
+          my_ancestors.push_back(entry.second);
+        }
+      }
+
+      base_table table() const noexcept
+      {
+        return { my_types.data(), my_ancestors.data(), my_types.size() };
+      }
+
+    private:
+
+      std::vector<const std::type_info*>  my_types;
+      std::vector<ancestor>               my_ancestors;
+    };
+
+    using base_table_func = base_table() noexcept;
+
+    // True if Base is a virtual base of Derived, given that it's a public base - a down cast from a virtual base is ill-formed
+    template<typename Base, typename Derived, typename = void>
+    struct is_virtual_base_of : std::true_type {};
+
+    template<typename Base, typename Derived>
+    struct is_virtual_base_of<Base, Derived, std::void_t<decltype(static_cast<Derived*>(std::declval<Base*>()))>> : std::false_type {};
+
+    // True if Base is an unambiguous public non-virtual base of Derived
+    template<typename Base, typename Derived>
+    constexpr bool is_static_base_of = std::is_convertible<Derived*, Base*>::value && !is_virtual_base_of<Base, Derived>::value;
+
+    // Returns the pointer offset from Derived to its non-virtual base Base.
+    // The offset only depends on the types, so it's found from storage for a Derived that's never constructed, 
+    // which is well defined as an implicit conversion to a non-virtual base is allowed before an object's lifetime.
+    template<typename Derived, typename Base>
+    std::ptrdiff_t base_offset()
+    {
+      void * const storage = ::operator new(sizeof(Derived), std::align_val_t{ alignof(Derived) });
+      Derived * const derived = static_cast<Derived*>(storage);
+      const Base * const base = derived;
+      const std::ptrdiff_t offset = reinterpret_cast<const char*>(base) - static_cast<const char*>(storage);
+      ::operator delete(storage, std::align_val_t{ alignof(Derived) });
+      return offset;
+    }
+
+    template<typename T, typename Bases>
+    struct checked_bases;
+
+    template<typename T, typename... Bases>
+    struct checked_bases<T, base_list<Bases...>>
+    {
+      static_assert((std::is_convertible<T*, Bases*>::value && ...), "any_ptr_bases<T> must only list public bases of T");
+      static_assert((!is_virtual_base_of<Bases, T>::value && ...), "any_ptr_bases<T> can't list virtual bases of T");
+      using type = base_list<Bases...>;
+    };
+
+    template<typename T, typename = void>
+    struct is_complete_class : std::false_type {};
+
+    template<typename T>
+    struct is_complete_class<T, std::void_t<decltype(sizeof(T))>> : std::is_class<T> {};
+
+#ifdef ANY_PTR_HAS_DIRECT_BASES
+    // The direct bases of a class in the order of their declaration except the virtual bases come first.
+    // The bases of an incomplete class are unknown, so none are discovered.
+    template<typename T, bool = is_complete_class<T>::value>
+    struct discovered_bases
+    {
+      using type = base_list<__direct_bases(T)...>;
+    };
+
+    template<typename T>
+    struct discovered_bases<T, false>
+    {
+      using type = base_list<>;
+    };
+#else
+    template<typename T>
+    struct discovered_bases
+    {
+      using type = base_list<>;
+    };
+#endif
+
+    // True if any_ptr_bases lists the bases of T
+    template<typename T>
+    constexpr bool has_listed_bases = !std::is_same<typename any_ptr_bases<T>::type, base_list<>>::value;
+
+    // The direct bases of T that are listed by any_ptr_bases, otherwise the discovered bases
+    template<typename T>
+    using direct_bases_t = typename std::conditional_t<!has_listed_bases<T>,
+      discovered_bases<T>,
+      checked_bases<T, typename any_ptr_bases<T>::type>>::type;
+
+    // Returns the number of ancestors
+    template<typename... Bases>
+    constexpr std::size_t ancestor_count(base_list<Bases...>) noexcept
+    {
+      return (std::size_t{ 0 } + ... + (1 + ancestor_count(direct_bases_t<Bases>{})));
+    }
+
+    // Returns true if each of the ancestors is a public non-virtual base of its derived class, so they all have a static offset
+    template<typename Derived, typename... Bases>
+    constexpr bool has_static_ancestors(base_list<Bases...>) noexcept
+    {
+      return (true && ... && (is_static_base_of<Bases, Derived> && has_static_ancestors<Bases>(direct_bases_t<Bases>{})));
+    }
+
+    template<typename Derived, typename... Bases>
+    void append_ancestors(std::vector<base_subobject> & out, std::ptrdiff_t offset, bool is_static, base_list<Bases...>);
+
+    // Appends Base and its ancestors where 'offset' is the offset of Derived from the held type if 'is_static'
+    template<typename Derived, typename Base>
+    void append_ancestor(std::vector<base_subobject> & out, std::ptrdiff_t offset, bool is_static)
+    {
+      if constexpr (is_static_base_of<Base, Derived>) {
+        if (is_static) {
+          offset += base_offset<Derived, Base>();
+        }
+      }
+      else {
+        is_static = false;
+      }
+      out.push_back(base_subobject{ &typeid(Base), nullptr, is_static ? offset : 0, is_static, is_static });
+      append_ancestors<Base>(out, offset, is_static, direct_bases_t<Base>{});
+    }
+
+    template<typename Derived, typename... Bases>
+    void append_ancestors([[maybe_unused]] std::vector<base_subobject> & out, [[maybe_unused]] std::ptrdiff_t offset, [[maybe_unused]] bool is_static, base_list<Bases...>)
+    {
+      (append_ancestor<Derived, Bases>(out, offset, is_static), ...);
+    }
+
+    // Returns the ancestors of T that are registered or discovered by any_ptr_bases. 
+    // If the table can't be built, e.g. std::bad_alloc, it's empty so the up casts use the dynamic up cast,
+    // and it's built again by the next call.
+    template<typename T>
+    base_table base_table_of() noexcept
+    {
+      try {
+        static const flat_base_table our_table{ [] {
+          using bases = direct_bases_t<T>;
+          std::vector<base_subobject> subobjects;
+          subobjects.reserve(ancestor_count(bases{}));
+          append_ancestors<T>(subobjects, 0, true, bases{});
+          return subobjects;
+        }() };
+        return our_table.table();
+      }
+      catch (...) {
+        return base_table{ nullptr, nullptr, 0 };
+      }
+    }
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+    // Returns all the ancestors of the class T that are found by walking its RTTI once, 
+    // or an empty table if it can't be built - see base_table_of()
+    template<typename T>
+    base_table rtti_base_table_of() noexcept
+    {
+      try {
+        static const flat_base_table our_table{ [] {
+          std::vector<base_subobject> subobjects;
+          auto visit = [&subobjects](const std::type_info & base, const itanium::base_path & path) {
+            subobjects.push_back(base_subobject{ &base, path.vbase, path.offset, path.is_public, true, path.vbase_path, path.vtable_offset });
+          };
+          itanium::for_each_base(typeid(T), itanium::base_path{}, visit);
+          return subobjects;
+        }() };
+        return our_table.table();
+      }
+      catch (...) {
+        return base_table{ nullptr, nullptr, 0 };
+      }
+    }
+#endif
+
+    // Returns the function that returns the ancestors of T, or nullptr if T has none. The ancestors 
+    // are found at compile time from the bases listed by any_ptr_bases, or from the discovered bases 
+    // if every ancestor has a static offset. Otherwise, i.e. a virtual or non-public ancestor, or 
+    // bases that aren't known at compile time, they're found by walking the RTTI if the layout is known.
+    template<typename T>
+    constexpr base_table_func * base_table_function() noexcept
+    {
+      using type = std::remove_cv_t<T>;
+#if defined(ANY_PTR_HAS_ITANIUM_RTTI) && defined(ANY_PTR_HAS_DIRECT_BASES)
+      if constexpr (ancestor_count(direct_bases_t<type>{}) == 0) {
+        return nullptr;
+      }
+      else if constexpr (has_listed_bases<type> || has_static_ancestors<type>(direct_bases_t<type>{})) {
+        return &base_table_of<type>;
+      }
+      else {
+        return &rtti_base_table_of<type>;
+      }
+#elif defined(ANY_PTR_HAS_ITANIUM_RTTI)
+      if constexpr (has_listed_bases<type>) {
+        return &base_table_of<type>;
+      }
+      else {
+        return !is_complete_class<type>::value ? nullptr : &rtti_base_table_of<type>;
+      }
+#else
+      return ancestor_count(direct_bases_t<type>{}) == 0 ? nullptr : &base_table_of<type>;
+#endif
+    }
+
+  } // namespace detail
+
+} // namespace xxx
+
+// Specialises xxx::any_ptr_bases to list the direct public non-virtual bases of Derived.
+// Must be used at global namespace scope.
+#define ANY_PTR_BASES(Derived, ...) \
+  template<> \
+  struct xxx::any_ptr_bases<Derived> { using type = xxx::base_list<__VA_ARGS__>; }
@@ -0,0 +1,667 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "any_ptr.h"
+#include "any_shared_ptr.h"
+#include "dynamic_up_cast.h"
+#include "held_type.h"
+#include "type_registry.h"
+
+namespace xxx {
+
+  inline namespace v1 {
+
+    // Combines lambdas into a visitor with an overload set e.g. 
+    //    any_ptr_visit(any, overloaded{ [](Derived&){}, [](Base&){}, [](auto&){} })
+    template<typename... Ls>
+    struct overloaded : Ls... { using Ls::operator()...; };
+
+    template<typename... Ls>
+    overloaded(Ls...) -> overloaded<Ls...>;
+
+  } // namespace v1
+
+  namespace detail {
+
+    struct any_ptr_access
+    {
+      static const held_type & held(const any_ptr & any) noexcept { return *any.my_held_type; }
+      static void * pointer(const any_ptr & any) noexcept { return any.my_ptr; }
+    };
+
+    template<typename... Ts>
+    struct type_list {};
+
+    template<typename... Lists>
+    struct concat_type_lists { using type = type_list<>; };
+
+    template<typename... Ts>
+    struct concat_type_lists<type_list<Ts...>> { using type = type_list<Ts...>; };
+
+    template<typename... Ts, typename... Us, typename... Lists>
+    struct concat_type_lists<type_list<Ts...>, type_list<Us...>, Lists...> { using type = typename concat_type_lists<type_list<Ts..., Us...>, Lists...>::type; };
+
+    // The alternative of a call operator whose parameter is T& is T, otherwise there's none
+    template<typename Param>
+    struct parameter_alternative { using type = type_list<>; };
+
+    template<typename T>
+    struct parameter_alternative<T&> { using type = type_list<T>; };
+
+    template<typename MemberFunction>
+    struct call_operator_alternative { using type = type_list<>; };
+
+    template<typename R, typename C, typename Param>
+    struct call_operator_alternative<R(C::*)(Param)> : parameter_alternative<Param> {};
+
+    template<typename R, typename C, typename Param>
+    struct call_operator_alternative<R(C::*)(Param) const> : parameter_alternative<Param> {};
+
+    template<typename R, typename C, typename Param>
+    struct call_operator_alternative<R(C::*)(Param) noexcept> : parameter_alternative<Param> {};
+
+    template<typename R, typename C, typename Param>
+    struct call_operator_alternative<R(C::*)(Param) const noexcept> : parameter_alternative<Param> {};
+
+    // The alternative of a visitor with a single call operator that isn't a template e.g. a 
+    // lambda with the parameter Derived&, otherwise there's none e.g. a generic lambda.
+    template<typename Visitor, typename = void>
+    struct lambda_alternatives { using type = type_list<>; };
+
+    template<typename Visitor>
+    struct lambda_alternatives<Visitor, std::void_t<decltype(&Visitor::operator())>> : call_operator_alternative<decltype(&Visitor::operator())> {};
+
+    template<typename Visitor>
+    struct visitor_alternatives : lambda_alternatives<Visitor> {};
+
+    // The alternatives of an overloaded visitor are those of its lambdas in the order given
+    template<typename... Ls>
+    struct visitor_alternatives<overloaded<Ls...>> : concat_type_lists<typename lambda_alternatives<Ls>::type...> {};
+
+    // True if the alternatives of the visitor are found, or it can be invoked with the any_ptr itself. It's false 
+    // for e.g. a class with several call operators, as &Visitor::operator() is ambiguous, that has none for the any_ptr 
+    // and so would throw bad_any_ptr_cast on every visit unless the alternatives are given explicitly.
+    template<typename Visitor>
+    inline constexpr bool has_visit_alternatives_v = !std::is_same<typename visitor_alternatives<std::decay_t<Visitor>>::type, type_list<>>::value
+      || std::is_invocable<Visitor, const any_ptr &>::value;
+
+    // Returns true if binding a T& to an object is a better conversion than binding a U& to it i.e. the derived 
+    // to base preference of overload resolution, or T is the same type as U but has fewer cv-qualifiers.
+    template<typename T, typename U>
+    constexpr bool is_better_alternative() noexcept
+    {
+      using UnqualifiedT = std::remove_cv_t<T>;
+      using UnqualifiedU = std::remove_cv_t<U>;
+      if constexpr (std::is_same<UnqualifiedT, UnqualifiedU>::value) {
+        return cv_qualifiers_of<T>() != cv_qualifiers_of<U>() && (cv_qualifiers_of<T>() & ~cv_qualifiers_of<U>()) == 0;
+      }
+      else if constexpr (std::is_class<UnqualifiedT>::value && std::is_class<UnqualifiedU>::value) {
+        return std::is_base_of<UnqualifiedU, UnqualifiedT>::value;
+      }
+      else {
+        return false;
+      }
+    }
+
+    // The resolved visit of a held type i.e. the function that invokes the visitor with the overload 
+    // that's selected for the held type, where 'offset' adjusts the held pointer for a static_offset up cast.
+    template<typename R, typename Visitor>
+    struct visit_entry
+    {
+      R(*invoke)(Visitor & visitor, const any_ptr & any, std::ptrdiff_t offset);
+      std::ptrdiff_t offset;
+    };
+
+    // Invokes the visitor with the held object as a T& where the up cast is a static_offset
+    template<typename R, typename Visitor, typename T>
+    R invoke_static_alternative(Visitor & visitor, const any_ptr & any, std::ptrdiff_t offset)
+    {
+      return std::forward<Visitor>(visitor)(*static_cast<T*>(static_cast<void*>(static_cast<char*>(any_ptr_access::pointer(any)) + offset)));
+    }
+
+    // Invokes the visitor with the held object as a T& where the up cast depends on the object e.g. a virtual base
+    template<typename R, typename Visitor, typename T>
+    R invoke_dynamic_alternative(Visitor & visitor, const any_ptr & any, std::ptrdiff_t /*offset*/)
+    {
+      return std::forward<Visitor>(visitor)(*any_ptr_cast<T>(any));
+    }
+
+    // Invokes the visitor with the any_ptr itself when there's no alternative for the held type, e.g. 
+    // the generic lambda of an overloaded visitor, otherwise throws bad_any_ptr_cast.
+    template<typename R, typename Visitor>
+    R invoke_no_alternative(Visitor & visitor, const any_ptr & any, std::ptrdiff_t /*offset*/)
+    {
+      if constexpr (std::is_invocable<Visitor, const any_ptr &>::value) {
+        return std::forward<Visitor>(visitor)(any);
+      }
+      else {
+        (void)visitor;
+        (void)any;
+        throw bad_any_ptr_cast();
+      }
+    }
+
+    template<typename R, typename Visitor, typename T>
+    inline constexpr visit_entry<R, Visitor> static_alternative_entry_v{ &invoke_static_alternative<R, Visitor, T>, 0 };
+
+    template<typename R, typename Visitor, typename T>
+    inline constexpr visit_entry<R, Visitor> dynamic_alternative_entry_v{ &invoke_dynamic_alternative<R, Visitor, T>, 0 };
+
+    template<typename R, typename Visitor>
+    inline constexpr visit_entry<R, Visitor> no_alternative_entry_v{ &invoke_no_alternative<R, Visitor>, 0 };
+
+    /**
+      The class visit_table is a table of the resolved visit of each held type, for a visitor and 
+      its alternatives, that's indexed by the type_registry ID of the held pointer type. 
+      The table is split into chunks of entries that are allocated on the first use of an ID in 
+      the chunk and never moved, so that a lookup is a pair of acquire loads.
+      An entry is only computed once per held type, other than by threads that race to compute it.
+      'Entry' is const for an entry that's immutable once it's recorded.
+    */
+    template<typename Entry, typename Alternatives>
+    class visit_table
+    {
+    public:
+
+      // Returns the resolved visit of the held type with the ID 'id', or nullptr if it's yet to be resolved
+      Entry * find(type_registry::id_type id) const noexcept
+      {
+        const std::atomic<Entry*> * const chunk = my_chunks[id / chunk_size].load(std::memory_order_acquire);
+        return chunk != nullptr ? chunk[id % chunk_size].load(std::memory_order_acquire) : nullptr;
+      }
+
+      // Records the resolved visit of the held type with the ID 'id' and returns it, or returns 
+      // the entry of a thread that recorded it first. The table takes ownership of an 'allocated' entry.
+      Entry * insert(type_registry::id_type id, Entry * entry, std::unique_ptr<Entry> allocated)
+      {
+        std::atomic<Entry*> * chunk = my_chunks[id / chunk_size].load(std::memory_order_acquire);
+        if (chunk == nullptr) {
+          std::unique_ptr<std::atomic<Entry*>[]> new_chunk{ new std::atomic<Entry*>[chunk_size]{} };
+          if (my_chunks[id / chunk_size].compare_exchange_strong(chunk, new_chunk.get(), std::memory_order_acq_rel)) {
+            chunk = new_chunk.release();
+          }
+        }
+        Entry * expected = nullptr;
+        if (chunk[id % chunk_size].compare_exchange_strong(expected, entry, std::memory_order_acq_rel)) {
+          allocated.release(); // owned by the table, which is never destroyed
+          return entry;
+        }
+        return expected;
+      }
+
+      // Returns the table of the visitor and its alternatives that's never destroyed 
+      // so that it's safe to use during static destruction
+      static visit_table & instance() noexcept
+      {
+        static visit_table * const our_instance = new visit_table;
+        return *our_instance;
+      }
+
+    private:
+
+      static constexpr std::size_t chunk_size = 1024;
+
+      std::atomic<std::atomic<Entry*>*>         my_chunks[type_registry::max_size / chunk_size]{};
+    };
+
+    // Returns the type_registry ID of 'held' that indexes a visit_table. 
+    // Throws std::length_error if the held type can't be registered as the visit can't be recorded.
+    inline type_registry::id_type registered_id_of(const held_type & held)
+    {
+      const type_registry::id_type id = held.type_id();
+      if (id == type_registry::invalid_id) {
+        throw std::length_error("type_registry is full");
+      }
+      return id;
+    }
+
+    // Returns, for each of Ts..., true if binding a T& is a better conversion - see is_better_alternative
+    template<typename T, typename... Ts>
+    constexpr std::array<bool, sizeof...(Ts)> better_alternatives(type_list<Ts...>) noexcept
+    {
+      return { { is_better_alternative<T, Ts>()... } };
+    }
+
+    // Returns the index of the best of the matching alternatives i.e. the first that no other 
+    // match is better than, or 'count' if there's no match. Thus a tie, which overload resolution 
+    // would reject as ambiguous, is resolved in favour of the first alternative.
+    template<std::size_t count>
+    std::size_t best_alternative(const bool(&is_match)[count], const std::array<std::array<bool, count>, count> & is_better) noexcept
+    {
+      for (std::size_t i = 0; i < count; ++i) {
+        if (is_match[i]) {
+          bool is_best{ true };
+          for (std::size_t j = 0; j < count && is_best; ++j) {
+            is_best = !(is_match[j] && is_better[j][i]);
+          }
+          if (is_best) {
+            return i;
+          }
+        }
+      }
+      return count;
+    }
+
+    // The result of visiting with the first of the alternatives Ts..., which is the result of all the alternatives as for std::visit
+    template<typename Visitor, typename... Ts>
+    struct visit_result { using type = std::invoke_result_t<Visitor, nth_type_t<0, Ts...>&>; };
+
+    template<typename Visitor>
+    struct visit_result<Visitor> { using type = std::invoke_result_t<Visitor, const any_ptr &>; };
+
+    // Resolves the visit of the held type of 'any', whose type_registry ID is 'id', and records it in 'table'.
+    // The alternative of Ts... that's selected is the one that overload resolution would select if the held 
+    // type was known at compile time, where the held pointer can be cast to a T* for each candidate T.
+    template<typename R, typename Visitor, typename Table, typename... Ts>
+    const visit_entry<R, Visitor> * resolve_visit(Table & table, type_registry::id_type id, const any_ptr & any)
+    {
+      using entry = visit_entry<R, Visitor>;
+      constexpr std::size_t count = sizeof...(Ts);
+      const entry * resolved{ &no_alternative_entry_v<R, Visitor> };
+      std::unique_ptr<entry> allocated;
+      if constexpr (count != 0) {
+        static constexpr std::array<std::array<bool, count>, count> our_is_better{ { better_alternatives<Ts>(type_list<Ts...>{})... } };
+        up_cast_result(*const resolvers[])(const held_type &, void*&) noexcept = { &resolve_up_cast<Ts>... };
+        R(*const static_invokers[])(Visitor &, const any_ptr &, std::ptrdiff_t) = { &invoke_static_alternative<R, Visitor, Ts>... };
+        const entry * const static_entries[] = { &static_alternative_entry_v<R, Visitor, Ts>... };
+        const entry * const dynamic_entries[] = { &dynamic_alternative_entry_v<R, Visitor, Ts>... };
+
+        const held_type & held = any_ptr_access::held(any);
+        void * const held_ptr = any_ptr_access::pointer(any);
+        void * ptrs[count];
+        up_cast_result results[count];
+        bool is_match[count];
+        for (std::size_t i = 0; i < count; ++i) {
+          ptrs[i] = held_ptr;
+          results[i] = resolvers[i](held, ptrs[i]);
+          is_match[i] = results[i] != up_cast_result::failed;
+        }
+        const std::size_t best = best_alternative(is_match, our_is_better);
+        if (best == count) { // no alternative
+        }
+        else if (results[best] == up_cast_result::static_offset) {
+          const std::ptrdiff_t offset = static_cast<char*>(ptrs[best]) - static_cast<char*>(held_ptr);
+          if (offset == 0) {
+            resolved = static_entries[best];
+          }
+          else {
+            allocated.reset(new entry{ static_invokers[best], offset });
+            resolved = allocated.get();
+          }
+        }
+        else {
+          resolved = dynamic_entries[best];
+        }
+      }
+      return table.insert(id, resolved, std::move(allocated));
+    }
+
+    // Visits the held object of 'any' with the alternatives Ts... of the visitor - see any_ptr_visit
+    template<typename Visitor, typename... Ts>
+    typename visit_result<Visitor, Ts...>::type visit(const any_ptr & any, Visitor & visitor, type_list<Ts...>)
+    {
+      using R = typename visit_result<Visitor, Ts...>::type;
+      using entry = visit_entry<R, Visitor>;
+      using table = visit_table<const entry, type_list<Ts...>>;
+      if (any_ptr_access::pointer(any) == nullptr) { // empty or a held nullptr
+        return invoke_no_alternative<R, Visitor>(visitor, any, 0);
+      }
+      table & resolved_visits = table::instance();
+      const type_registry::id_type id = registered_id_of(any_ptr_access::held(any));
+      const entry * resolved = resolved_visits.find(id);
+      if (resolved == nullptr) {
+        resolved = resolve_visit<R, Visitor, table, Ts...>(resolved_visits, id, any);
+      }
+      return resolved->invoke(visitor, any, resolved->offset);
+    }
+
+    //-----------------------------------------------------------------------------------------------------
+    // Double dispatch - see any_ptr_visit2
+
+    // The alternative (X, Y) of a handler whose parameters are X& and Y&, otherwise it has none
+    template<typename Param1, typename Param2>
+    struct binary_parameter_alternative 
+    { 
+      static constexpr bool is_valid = false; 
+      using first = void; 
+      using second = void; 
+    };
+
+    template<typename X, typename Y>
+    struct binary_parameter_alternative<X&, Y&>
+    {
+      static constexpr bool is_valid = true;
+      using first = X;
+      using second = Y;
+    };
+
+    template<typename MemberFunction>
+    struct binary_call_operator_alternative : binary_parameter_alternative<void, void> {};
+
+    template<typename R, typename C, typename Param1, typename Param2>
+    struct binary_call_operator_alternative<R(C::*)(Param1, Param2)> : binary_parameter_alternative<Param1, Param2> {};
+
+    template<typename R, typename C, typename Param1, typename Param2>
+    struct binary_call_operator_alternative<R(C::*)(Param1, Param2) const> : binary_parameter_alternative<Param1, Param2> {};
+
+    template<typename R, typename C, typename Param1, typename Param2>
+    struct binary_call_operator_alternative<R(C::*)(Param1, Param2) noexcept> : binary_parameter_alternative<Param1, Param2> {};
+
+    template<typename R, typename C, typename Param1, typename Param2>
+    struct binary_call_operator_alternative<R(C::*)(Param1, Param2) const noexcept> : binary_parameter_alternative<Param1, Param2> {};
+
+    // The alternative of a handler with a single call operator that isn't a template e.g. a lambda 
+    // with the parameters Derived& and Base&, otherwise it has none e.g. a generic lambda.
+    template<typename Handler, typename = void>
+    struct handler_alternative : binary_parameter_alternative<void, void> {};
+
+    template<typename Handler>
+    struct handler_alternative<Handler, std::void_t<decltype(&Handler::operator())>> : binary_call_operator_alternative<decltype(&Handler::operator())> {};
+
+    // Returns true if the alternative A is a better match than B i.e. the conversion of one argument is 
+    // better, and the other is no worse, as for overload resolution - see is_better_alternative
+    template<typename A, typename B>
+    constexpr bool is_better_binary_alternative() noexcept
+    {
+      if constexpr (A::is_valid && B::is_valid) {
+        constexpr bool is_first_better = is_better_alternative<typename A::first, typename B::first>();
+        constexpr bool is_second_better = is_better_alternative<typename A::second, typename B::second>();
+        constexpr bool is_first_same = std::is_same<typename A::first, typename B::first>::value;
+        constexpr bool is_second_same = std::is_same<typename A::second, typename B::second>::value;
+        return (is_first_better || is_second_better) && (is_first_better || is_first_same) && (is_second_better || is_second_same);
+      }
+      else {
+        return false;
+      }
+    }
+
+    template<typename A, typename... As>
+    constexpr std::array<bool, sizeof...(As)> better_binary_alternatives(type_list<As...>) noexcept
+    {
+      return { { is_better_binary_alternative<A, As>()... } };
+    }
+
+    // The index of the first of the handlers Hs... that can be invoked with the two any_ptrs 
+    // when there's no alternative for the held types, or sizeof...(Hs) if there's none
+    template<typename... Hs>
+    constexpr std::size_t no_binary_alternative_handler() noexcept
+    {
+      constexpr bool is_invocable[] = { std::is_invocable<Hs&, const any_ptr &, const any_ptr &>::value..., false };
+      std::size_t i = 0;
+      while (i < sizeof...(Hs) && !is_invocable[i]) {
+        ++i;
+      }
+      return i;
+    }
+
+    // The result of the first handler, which is the result of all the handlers as for std::visit
+    template<typename H, typename Alternative = handler_alternative<std::remove_cv_t<H>>, bool = Alternative::is_valid>
+    struct binary_visit_result { using type = std::invoke_result_t<H&, typename Alternative::first &, typename Alternative::second &>; };
+
+    template<typename H, typename Alternative>
+    struct binary_visit_result<H, Alternative, false> { using type = std::invoke_result_t<H&, const any_ptr &, const any_ptr &>; };
+
+    // The resolved visit of a pair of held types i.e. the function that invokes the handler that's 
+    // selected for the held types, where the offsets adjust the held pointers for static_offset up casts.
+    template<typename R, typename... Hs>
+    struct binary_visit_entry
+    {
+      R(*invoke)(std::tuple<Hs&...> & handlers, const any_ptr & first, const any_ptr & second, const binary_visit_entry & entry);
+      std::ptrdiff_t first_offset;
+      std::ptrdiff_t second_offset;
+    };
+
+    inline void * offset_pointer(const any_ptr & any, std::ptrdiff_t offset) noexcept
+    {
+      return static_cast<char*>(any_ptr_access::pointer(any)) + offset;
+    }
+
+    // Invokes the handler I with the held objects where both up casts are a static_offset
+    template<typename R, std::size_t I, typename... Hs>
+    R invoke_static_binary_alternative(std::tuple<Hs&...> & handlers, const any_ptr & first, const any_ptr & second, const binary_visit_entry<R, Hs...> & entry)
+    {
+      using alternative = handler_alternative<std::remove_cv_t<nth_type_t<I, Hs...>>>;
+      return std::get<I>(handlers)(
+        *static_cast<typename alternative::first*>(offset_pointer(first, entry.first_offset)), 
+        *static_cast<typename alternative::second*>(offset_pointer(second, entry.second_offset)));
+    }
+
+    // Invokes the handler I with the held objects where an up cast depends on the object e.g. a virtual base
+    template<typename R, std::size_t I, typename... Hs>
+    R invoke_dynamic_binary_alternative(std::tuple<Hs&...> & handlers, const any_ptr & first, const any_ptr & second, const binary_visit_entry<R, Hs...> & /*entry*/)
+    {
+      using alternative = handler_alternative<std::remove_cv_t<nth_type_t<I, Hs...>>>;
+      return std::get<I>(handlers)(*any_ptr_cast<typename alternative::first>(first), *any_ptr_cast<typename alternative::second>(second));
+    }
+
+    // Invokes the first handler that can be invoked with the two any_ptrs when there's no alternative 
+    // for the held types, otherwise throws bad_any_ptr_cast
+    template<typename R, typename... Hs>
+    R invoke_no_binary_alternative(std::tuple<Hs&...> & handlers, const any_ptr & first, const any_ptr & second, const binary_visit_entry<R, Hs...> & /*entry*/)
+    {
+      constexpr std::size_t handler = no_binary_alternative_handler<Hs...>();
+      if constexpr (handler < sizeof...(Hs)) {
+        return std::get<handler>(handlers)(first, second);
+      }
+      else {
+        (void)handlers;
+        (void)first;
+        (void)second;
+        throw bad_any_ptr_cast();
+      }
+    }
+
+    template<typename R, typename... Hs>
+    inline constexpr binary_visit_entry<R, Hs...> no_binary_alternative_entry_v{ &invoke_no_binary_alternative<R, Hs...>, 0, 0 };
+
+    // Returns a resolver of the up cast to the first, or second, type of the alternative of handler I, or 
+    // a resolver that always fails if the handler has no alternative
+    inline up_cast_result no_up_cast(const held_type & /*held*/, void*& /*ptr*/) noexcept
+    {
+      return up_cast_result::failed;
+    }
+
+    template<std::size_t I, bool is_first, typename... Hs>
+    constexpr auto binary_alternative_resolver() noexcept
+    {
+      using alternative = handler_alternative<std::remove_cv_t<nth_type_t<I, Hs...>>>;
+      up_cast_result(*resolver)(const held_type &, void*&) noexcept = &no_up_cast;
+      if constexpr (alternative::is_valid) {
+        resolver = &resolve_up_cast<std::conditional_t<is_first, typename alternative::first, typename alternative::second>>;
+      }
+      return resolver;
+    }
+
+    template<typename R, std::size_t I, bool is_static, typename... Hs>
+    constexpr auto binary_alternative_invoker() noexcept
+    {
+      using alternative = handler_alternative<std::remove_cv_t<nth_type_t<I, Hs...>>>;
+      R(*invoker)(std::tuple<Hs&...> &, const any_ptr &, const any_ptr &, const binary_visit_entry<R, Hs...> &) = nullptr;
+      if constexpr (alternative::is_valid) {
+        invoker = is_static ? &invoke_static_binary_alternative<R, I, Hs...> : &invoke_dynamic_binary_alternative<R, I, Hs...>;
+      }
+      return invoker;
+    }
+
+    // Resolves the visit of the pair of held types of 'first' and 'second', where the row of the 
+    // table is that of the held type of 'first' and 'id' is the type_registry ID of the held type of 'second'.
+    // The handler that's selected is the one that overload resolution would select if the held types were 
+    // known at compile time, where the held pointers can be cast to an X* and Y* for each candidate (X, Y).
+    template<typename R, typename Row, typename... Hs, std::size_t... I>
+    const binary_visit_entry<R, Hs...> * resolve_binary_visit(Row & row, type_registry::id_type id, const any_ptr & first, const any_ptr & second, std::index_sequence<I...>)
+    {
+      using entry = binary_visit_entry<R, Hs...>;
+      constexpr std::size_t count = sizeof...(Hs);
+      static constexpr std::array<std::array<bool, count>, count> our_is_better{ 
+        { better_binary_alternatives<handler_alternative<std::remove_cv_t<Hs>>>(type_list<handler_alternative<std::remove_cv_t<Hs>>...>{})... } };
+      up_cast_result(*const first_resolvers[])(const held_type &, void*&) noexcept = { binary_alternative_resolver<I, true, Hs...>()... };
+      up_cast_result(*const second_resolvers[])(const held_type &, void*&) noexcept = { binary_alternative_resolver<I, false, Hs...>()... };
+      R(*const static_invokers[])(std::tuple<Hs&...> &, const any_ptr &, const any_ptr &, const entry &) = { binary_alternative_invoker<R, I, true, Hs...>()... };
+      R(*const dynamic_invokers[])(std::tuple<Hs&...> &, const any_ptr &, const any_ptr &, const entry &) = { binary_alternative_invoker<R, I, false, Hs...>()... };
+
+      void * const first_ptr = any_ptr_access::pointer(first);
+      void * const second_ptr = any_ptr_access::pointer(second);
+      void * first_ptrs[count];
+      void * second_ptrs[count];
+      up_cast_result first_results[count];
+      up_cast_result second_results[count];
+      bool is_match[count];
+      for (std::size_t i = 0; i < count; ++i) {
+        first_ptrs[i] = first_ptr;
+        second_ptrs[i] = second_ptr;
+        first_results[i] = first_resolvers[i](any_ptr_access::held(first), first_ptrs[i]);
+        second_results[i] = first_results[i] != up_cast_result::failed ? second_resolvers[i](any_ptr_access::held(second), second_ptrs[i]) : up_cast_result::failed;
+        is_match[i] = second_results[i] != up_cast_result::failed;
+      }
+      const std::size_t best = best_alternative(is_match, our_is_better);
+      if (best == count) { // no alternative
+        return row.insert(id, &no_binary_alternative_entry_v<R, Hs...>, nullptr);
+      }
+      const bool is_static = first_results[best] == up_cast_result::static_offset && second_results[best] == up_cast_result::static_offset;
+      std::unique_ptr<const entry> allocated{ new entry{ 
+        is_static ? static_invokers[best] : dynamic_invokers[best],
+        static_cast<char*>(first_ptrs[best]) - static_cast<char*>(first_ptr),
+        static_cast<char*>(second_ptrs[best]) - static_cast<char*>(second_ptr) } };
+      const entry * const resolved = allocated.get();
+      return row.insert(id, resolved, std::move(allocated));
+    }
+
+    // Visits the held objects of 'first' and 'second' with the handlers - see any_ptr_visit2
+    template<typename... Hs>
+    typename binary_visit_result<nth_type_t<0, Hs...>>::type visit2(const any_ptr & first, const any_ptr & second, std::tuple<Hs&...> handlers)
+    {
+      using R = typename binary_visit_result<nth_type_t<0, Hs...>>::type;
+      using entry = binary_visit_entry<R, Hs...>;
+      // A row per held type of 'first' that's indexed by the held type of 'second'
+      using row = visit_table<const entry, type_list<Hs...>>;
+      using table = visit_table<row, type_list<Hs...>>;
+      if (any_ptr_access::pointer(first) == nullptr || any_ptr_access::pointer(second) == nullptr) { // empty or a held nullptr
+        return invoke_no_binary_alternative<R, Hs...>(handlers, first, second, no_binary_alternative_entry_v<R, Hs...>);
+      }
+      const type_registry::id_type first_id = registered_id_of(any_ptr_access::held(first));
+      const type_registry::id_type second_id = registered_id_of(any_ptr_access::held(second));
+      table & rows = table::instance();
+      row * resolved_row = rows.find(first_id);
+      if (resolved_row == nullptr) {
+        std::unique_ptr<row> new_row{ new row };
+        row * const allocated_row = new_row.get();
+        resolved_row = rows.insert(first_id, allocated_row, std::move(new_row));
+      }
+      const entry * resolved = resolved_row->find(second_id);
+      if (resolved == nullptr) {
+        resolved = resolve_binary_visit<R, row, Hs...>(*resolved_row, second_id, first, second, std::index_sequence_for<Hs...>{});
+      }
+      return resolved->invoke(handlers, first, second, *resolved);
+    }
+
+  } // namespace detail
+
+  inline namespace v1 {
+
+    //-----------------------------------------------------------------------------------------------------
+    // Invokes the visitor with the held object as a T&, where T is the alternative that overload resolution 
+    // would select if the held type was known at compile time i.e. the most derived of the alternatives 
+    // that the held pointer can be cast to by any_ptr_cast, and the least cv-qualified. The alternatives 
+    // are the types Ts..., or if none are given then the parameter types T& of the lambdas of an overloaded 
+    // visitor, or of a lambda, that aren't generic e.g. 
+    //
+    //    any_ptr_visit(any, overloaded{ [](Derived&){}, [](Base&){}, [](auto&){} })
+    //
+    // The alternatives of any other visitor, e.g. a class with several call operators, can't be found so 
+    // they must be given, unless it can be invoked with the any_ptr, otherwise the visit doesn't compile.
+    // If there's no alternative for the held type, or the held pointer is a nullptr, then the visitor is 
+    // invoked with the any_ptr itself, e.g. by a generic lambda, otherwise bad_any_ptr_cast is thrown.
+    // All the alternatives must return the same type, as for std::visit.
+    //
+    // The alternative is selected once per held type and visitor, and recorded in a table that's indexed 
+    // by the type_registry ID of the held type, so that a repeated visit is a table lookup and an indirect call.
+    // Throws std::length_error if the held type can't be registered with the type_registry.
+
+    template<typename... Ts, typename Visitor>
+    decltype(auto) any_ptr_visit(const any_ptr & any, Visitor && visitor)
+    {
+      if constexpr (sizeof...(Ts) == 0) {
+        static_assert(detail::has_visit_alternatives_v<Visitor>, 
+          "The alternatives of the visitor can't be found, e.g. it has several call operators, so give them explicitly as any_ptr_visit<Ts...>");
+        return detail::visit<Visitor>(any, visitor, typename detail::visitor_alternatives<std::decay_t<Visitor>>::type{});
+      }
+      else {
+        return detail::visit<Visitor>(any, visitor, detail::type_list<Ts...>{});
+      }
+    }
+
+    // As above for the object held by an any_shared_ptr, which the visitor is invoked with the view() of if 
+    // there's no alternative for the held type
+    template<typename... Ts, typename Visitor>
+    decltype(auto) any_ptr_visit(const v1::any_shared_ptr & any, Visitor && visitor)
+    {
+      return any_ptr_visit<Ts...>(any.view(), std::forward<Visitor>(visitor));
+    }
+
+    template<typename... Ts, typename Visitor>
+    decltype(auto) any_ptr_visit(const v2::any_shared_ptr & any, Visitor && visitor)
+    {
+      return any_ptr_visit<Ts...>(any.view(), std::forward<Visitor>(visitor));
+    }
+
+    template<typename... Ts, typename Visitor>
+    decltype(auto) any_ptr_visit(const v3::any_shared_ptr & any, Visitor && visitor)
+    {
+      return any_ptr_visit<Ts...>(any.view(), std::forward<Visitor>(visitor));
+    }
+
+
+    //-----------------------------------------------------------------------------------------------------
+    // Invokes the handler that overload resolution would select, if the held types were known at compile 
+    // time, with the held objects of 'first' and 'second' i.e. the handler whose parameters X& and Y& are the 
+    // most specific of those that the held pointers can be cast to by any_ptr_cast e.g.
+    //
+    //    any_ptr_visit2(a, b, [](Ship&, Asteroid&){}, [](Ship&, Body&){}, [](Body&, Body&){}, [](auto&, auto&){})
+    //
+    // A handler that's a generic lambda, or isn't a lambda, isn't an alternative but may be the first 
+    // handler that can be invoked with the two any_ptrs, which is invoked if there's no alternative for the held 
+    // types, or a held pointer is a nullptr, otherwise bad_any_ptr_cast is thrown. A tie, which overload 
+    // resolution would reject as ambiguous, is resolved in favour of the first handler. All the handlers 
+    // must return the same type, as for std::visit.
+    //
+    // The handler is selected once per pair of held types and handlers, and recorded in a two dimensional table 
+    // that's indexed by the type_registry IDs of the held types, so that a repeated visit is a pair of table 
+    // lookups and an indirect call. Throws std::length_error if a held type can't be registered with the type_registry.
+
+    template<typename... Handlers>
+    decltype(auto) any_ptr_visit2(const any_ptr & first, const any_ptr & second, Handlers&&... handlers)
+    {
+      static_assert(sizeof...(Handlers) != 0, "any_ptr_visit2 requires a handler");
+      return detail::visit2<std::remove_reference_t<Handlers>...>(first, second, std::tuple<std::remove_reference_t<Handlers>&...>{ handlers... });
+    }
+
+  } // namespace v1
+
+} // namespace xxx
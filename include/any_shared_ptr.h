@@ -20,9 +20,18 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 #pragma once
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
 #include <typeinfo>
 #include <type_traits>
+#include <utility>
+#include <variant>
+#include "any_ptr.h"
+#include "dynamic_up_cast.h"
+#include "held_type.h"
+#include "trivially_relocatable.h"
 #ifdef _MSC_VER
   #if _HAS_CXX17 != 0
     #include <optional>
@@ -40,6 +49,15 @@
     #define ANY_SHARED_PTR_HAS_LIB_OPTIONAL 
   #endif
 #endif
+#ifdef _MSC_VER
+  #if _MSVC_LANG > 201703L
+    #define ANY_SHARED_PTR_HAS_ALIASING_MOVE
+  #endif
+#else
+  #if __cplusplus > 201703L // the shared_ptr aliasing ctor that moves from its source, see LWG 2996
+    #define ANY_SHARED_PTR_HAS_ALIASING_MOVE
+  #endif
+#endif
 
 namespace xxx {
 
@@ -49,8 +67,51 @@ namespace xxx {
     virtual const char* what() const noexcept override { return "bad any_shared_ptr cast"; }
   };
 
+  namespace detail {
+
+    // Returns a shared_ptr<T> to 'ptr' that takes over the reference held by 'from'.
+    template<typename T, typename U>
+    std::shared_ptr<T> alias_shared_ptr(std::shared_ptr<U> && from, T * ptr) noexcept
+    {
+#ifdef ANY_SHARED_PTR_HAS_ALIASING_MOVE
+      return std::shared_ptr<T>(std::move(from), ptr);
+#else // C++17 only has the aliasing ctor that copies, and so the reference is briefly counted twice
+      std::shared_ptr<T> result(from, ptr);
+      from.reset();
+      return result;
+#endif
+    }
+
+    // Returns { ptr, true } where ptr is the held pointer 'ptr' cast to T*, if the held type 'held' 
+    // can be cast to T* where 'target' is the held_type of shared_ptr<T>, otherwise { nullptr, false }.
+    // The optional 'site' is the call_site_cache of the caller.
+    template <typename T, typename... Site>
+    std::pair<T*, bool> borrowed_up_cast(const held_type & held, const held_type & target, void * ptr, Site&... site) noexcept
+    {
+      std::pair<T*, bool> result{ nullptr, false };
+      if (held.up_cast == nullptr) { // empty
+        return result;
+      }
+      if (is_same_unqualified_type(held, target)) { // is the same type up to cv-qualifiers
+        if (held.is_cv_promotable_to(cv_qualifiers_of<T>())) {
+          result.first = static_cast<T*>(ptr);
+          result.second = true;
+        }
+        // else the cast drops cv-qualifiers
+      }
+      else if (dynamic_up_cast<T>(held, ptr, site...)) { // up-cast succeeded
+        result.first = static_cast<T*>(ptr);
+        result.second = true;
+      }
+      return result;
+    }
+
+  } // namespace detail
+
   inline namespace v1 {
 
+    class any_weak_ptr;
+
     /** 
     The class any_shared_ptr is type-safe container for any std::shared_ptr<T>
     that, unlike std::any, supports cv-qualifier promotion and dynamic up-casting.
@@ -98,9 +159,8 @@ namespace xxx {
 
       template<typename T>
       any_shared_ptr(std::shared_ptr<T> ptr) noexcept
-        : my_type_info{ &typeid(HeldType<T>) }
+        : my_held_type{ &held_type_of<T>() }
         , my_shared_ptr{ std::const_pointer_cast<std::remove_cv_t<T>>(std::move(ptr)) }
-        , my_throw_func{ &any_shared_ptr::throw_func<T> }
       {
       }
 
@@ -111,78 +171,190 @@ namespace xxx {
       void swap(any_shared_ptr & other) noexcept { other = std::exchange(*this, std::move(other)); }
 
       // reset to empty state 
-      void reset() noexcept { ::new (this) any_shared_ptr(); }
+      void reset() noexcept { *this = any_shared_ptr(); }
 
       //-----------------------------------------------------
       // Observers
 
       // return true if not empty
-      bool has_value() const noexcept { return my_throw_func != nullptr; }
+      bool has_value() const noexcept { return my_held_type->up_cast != nullptr; }
 
       // Returns typeid(std::shared_ptr<T>) if instance is non-empty,
       // otherwise typeid(void).
-      const std::type_info & type() const noexcept { return *my_type_info; }
+      const std::type_info & type() const noexcept { return *my_held_type->type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return my_held_type->type_id(); }
 
       // returns the number of shared_ptr objects referring to the same managed object 
       long  use_count() const noexcept { return my_shared_ptr.use_count(); }
 
-    private:
+      // Returns an any_ptr that views the object without owning it, and so without changing the 
+      // reference count, whose casts are the same as any_shared_ptr_cast. It's only valid while 
+      // the object is owned.
+      any_ptr view() const noexcept { return detail::any_ptr_view(*my_held_type, my_shared_ptr.get()); }
 
-      // Make alias for signature for throw function  
-      using Throw_func = void(void *);
+    private:
 
-      // Holds typeid(shared_ptr<T*) if instance is not empty, 
+      // Describes typeid(shared_ptr<T>) if instance is not empty, 
       // otherwise set to typeid(void) to indicate an empty state.
-      const std::type_info *  my_type_info{ &typeid(void) };
+      const detail::held_type *   my_held_type{ &detail::empty_held_type };
       // The held shared_ptr, 
-      std::shared_ptr<void>   my_shared_ptr{ nullptr };
-      // The throw function that implements a dynamic up cast
-      Throw_func *            my_throw_func{ nullptr };
+      std::shared_ptr<void>       my_shared_ptr{ nullptr };
 
       template<typename T>
       using HeldType = std::shared_ptr<T>;
 
-      // Replicate a dynamic up cast by the using try/catch mechanism
-      template <typename T>
-      std::shared_ptr<T> dynamic_up_cast(bool & cast_ok) const noexcept
+      template<typename T>
+      static constexpr const detail::held_type & held_type_of() noexcept
+      {
+        return detail::held_type_v<T, HeldType<T>, HeldType<std::remove_cv_t<T>>>;
+      }
+
+      // Borrows the held pointer as T* - see any_shared_ptr_get
+      template <typename T, typename... Site>
+      std::pair<T*, bool> borrow(Site&... site) const noexcept
+      {
+        return detail::borrowed_up_cast<T>(*my_held_type, held_type_of<T>(), my_shared_ptr.get(), site...);
+      }
+
+      // Returns the held shared_ptr cast to the first of Ts... - see any_shared_ptr_cast_first
+      template <typename... Ts>
+      std::variant<std::monostate, std::shared_ptr<Ts>...> cast_first() const noexcept
+      {
+        void * ptr = my_shared_ptr.get();
+        const std::size_t index = detail::dynamic_up_cast_first<Ts...>(*my_held_type, ptr);
+        return detail::make_first_variant<std::variant<std::monostate, std::shared_ptr<Ts>...>>(index, 
+          [this, ptr](auto i) noexcept {
+            using T = detail::nth_type_t<decltype(i)::value, Ts...>;
+            return std::shared_ptr<T>(my_shared_ptr, static_cast<T*>(ptr));
+          }, 
+          std::index_sequence_for<Ts...>{});
+      }
+
+      template<typename... Ts>
+      friend std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept;
+
+      // As dynamic_up_cast() except the held shared_ptr is moved to the result, which resets 
+      // instance to the empty state, if the cast succeeds.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> move_up_cast(bool & cast_ok, Site&... site) noexcept
+      {
+        const std::pair<T*, bool> borrowed = borrow<T>(site...);
+        if (!borrowed.second) {
+          return nullptr;
+        }
+        cast_ok = true;
+        // The held shared_ptr<void> can only be moved to a shared_ptr<T> by the aliasing move ctor, so in C++17 
+        // every cast, including to the same type, counts the reference twice - v2 holds a typed shared_ptr instead.
+        std::shared_ptr<T> result = detail::alias_shared_ptr(std::move(my_shared_ptr), borrowed.first);
+        reset();
+        return result;
+      }
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr);
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept;
+#endif
+
+      // Attempt a dynamic up cast to T to replicate an implicit up cast
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> dynamic_up_cast(bool & cast_ok, Site&... site) const noexcept
       {
         std::shared_ptr<T> result;
         if (has_value()) {
-          if (type() == typeid(HeldType<T>)) { // is the same type
-            result = std::static_pointer_cast<T>(my_shared_ptr);
-            cast_ok = true;
-          }
-          else { // try an up-cast by throwing an exception
-            try {
-              my_throw_func(my_shared_ptr.get());
-            }
-            catch (T* p) { // up-cast succeeded
-              result = std::shared_ptr<T>(my_shared_ptr, p);
+          if (detail::is_same_unqualified_type(*my_held_type, held_type_of<T>())) { // is the same type up to cv-qualifiers
+            if (my_held_type->is_cv_promotable_to(detail::cv_qualifiers_of<T>())) {
+              result = std::static_pointer_cast<T>(my_shared_ptr);
               cast_ok = true;
             }
-            catch (...) { // up-cast failed
+            // else the cast drops cv-qualifiers
+          }
+          else { // try an up-cast
+            void * ptr = my_shared_ptr.get();
+            if (detail::dynamic_up_cast<T>(*my_held_type, ptr, site...)) { // up-cast succeeded
+              result = std::shared_ptr<T>(my_shared_ptr, static_cast<T*>(ptr));
+              cast_ok = true;
             }
           }
         }
         return result;
       }
 
-      // Throw exception to implement implicit up cast 
-      template<typename T>
-      static void throw_func(void * ptr)
+      // As dynamic_up_cast() except a cast that isn't an up cast is resolved with the semantics of 
+      // dynamic_cast from the most derived object i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+      template <typename T>
+      std::shared_ptr<T> full_dynamic_cast(bool & cast_ok) const noexcept
       {
-        throw static_cast<T*>(ptr);
+        std::shared_ptr<T> result = dynamic_up_cast<T>(cast_ok);
+        if (!cast_ok && has_value()) {
+          void * ptr = my_shared_ptr.get();
+          if (detail::dynamic_cross_cast<T>(*my_held_type, ptr)) {
+            result = std::shared_ptr<T>(my_shared_ptr, static_cast<T*>(ptr));
+            cast_ok = true;
+          }
+        }
+        return result;
       }
 
+      friend class any_weak_ptr;
+
       template<typename T>
       friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr);
 
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
 #ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
       template<typename T>
       friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
 #else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
       template<typename T>
-      std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
+#endif
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr);
+
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr);
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<T*> with std::pair<T*,bool>
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
 #endif
 
     };
@@ -226,6 +398,234 @@ namespace xxx {
 
 #endif
 
+    //-----------------------------------------------------------------------------------------------------
+    // As above except the up cast is cached in the call site's cache - see ANY_SHARED_PTR_CAST
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Borrows the held pointer as T* with the same cast as any_shared_ptr_cast but without a 
+    // shared_ptr<T> copy, and so no reference count traffic. The pointer is valid while the 
+    // any_shared_ptr, or a copy of it, holds the object.
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>(site);
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>(site);
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*,bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      return anySharedPtr->template borrow<T>();
+    }
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      return anySharedPtr->template borrow<T>(site);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_shared_ptr_cast except the held shared_ptr is moved to the result if the cast succeeds, 
+    // which leaves the any_shared_ptr empty, rather than copied. Otherwise the any_shared_ptr is unchanged.
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template move_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template move_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_shared_ptr_cast except a cast that isn't an up cast has the semantics of dynamic_cast 
+    // i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Returns the held shared_ptr cast to the first of Ts... that the cast succeeds for, or std::monostate 
+    // if there's none - see any_ptr_cast_first
+
+    template<typename... Ts>
+    std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept
+    {
+      return anySharedPtr.template cast_first<Ts...>();
+    }
+
     // Constructs an any object containing an object of type shared_ptr<T>, 
     // passing the provided arguments to std::make_shared<T>.
     // Is equivalent to 
@@ -246,8 +646,12 @@ namespace xxx {
     of v1::any_shared_ptr.
 
     It's more performant because;
-      1. sizeof(v2::any_shared_ptr) < sizeof(v1::any_shared_ptr) by 1 pointer
-      2. the MSVC performance of casting to same type is marginally better
+      1. the held shared_ptr<T> is stored inline alongside a pointer to a static table of 
+         per-type operations, rather than behind a virtual interface, so the empty state 
+         is constexpr and all-zero and has_value() is a null check.
+      2. a move is a bitwise copy, i.e. the held shared_ptr is relocated without 
+         running its move constructor and destructor.
+      3. the MSVC performance of casting to same type is marginally better
          due to avoiding a share_ptr copy.    
     */
     class any_shared_ptr
@@ -256,32 +660,42 @@ namespace xxx {
       //-----------------------------------------------------
       // Canonical "Rule of 5" ctors/dtor and copy operators
 
-      ~any_shared_ptr() { holder()->~IHolder(); }
+      ~any_shared_ptr() 
+      { 
+        if (my_ops != nullptr) {
+          my_ops->destroy(&my_inplace_storage);
+        }
+      }
 
-      any_shared_ptr(any_shared_ptr const & other) noexcept { other.holder()->clone(&my_inplace_storage); }
+      any_shared_ptr(any_shared_ptr const & other) noexcept 
+        : my_ops{ other.my_ops }
+      { 
+        if (my_ops != nullptr) {
+          my_ops->copy(&my_inplace_storage, &other.my_inplace_storage);
+        }
+      }
 
       any_shared_ptr& operator=(any_shared_ptr const& other) noexcept
       {
         if (this != &other) {
           this->~any_shared_ptr();
-          other.holder()->clone(&my_inplace_storage);
+          ::new (this) any_shared_ptr(other);
         }
         // else a self-copy - do nothing
         return *this;
       }
 
       any_shared_ptr(any_shared_ptr && other) noexcept
+        : my_ops{ std::exchange(other.my_ops, nullptr) }
+        , my_inplace_storage{ std::exchange(other.my_inplace_storage, storage_t{}) }
       {
-        my_inplace_storage = other.my_inplace_storage;
-        ::new (&other) any_shared_ptr();
       }
 
       any_shared_ptr& operator=(any_shared_ptr && other) noexcept
       {
         if (this != &other) {
           this->~any_shared_ptr();
-          my_inplace_storage = other.my_inplace_storage;
-          ::new (&other) any_shared_ptr();
+          ::new (this) any_shared_ptr(std::move(other));
         }
         // else a self-move - do nothing
         return *this;
@@ -290,141 +704,894 @@ namespace xxx {
       //-----------------------------------------------------
       // ctors
 
-      any_shared_ptr() noexcept { ::new (&my_inplace_storage) EmptyHolder(); }
+      constexpr any_shared_ptr() noexcept = default;
 
       template<typename T>
-      any_shared_ptr(std::shared_ptr<T> ptr) noexcept { ::new (&my_inplace_storage) Holder<T>(std::move(ptr));  }
+      any_shared_ptr(std::shared_ptr<T> ptr) noexcept 
+        : my_ops{ &ops_v<T> }
+      { 
+        ::new (&my_inplace_storage) std::shared_ptr<T>(std::move(ptr));  
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // swaps two any objects 
+      void swap(any_shared_ptr & other) noexcept { other = std::exchange(*this, std::move(other)); }
+
+      // reset to empty state 
+      void reset() noexcept 
+      { 
+        this->~any_shared_ptr();
+        ::new (this) any_shared_ptr();
+      }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // return true if not empty
+      bool has_value() const noexcept { return my_ops != nullptr; }
+
+      // Returns typeid(std::shared_ptr<T>) if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info & type() const noexcept { return *held().type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return held().type_id(); }
+
+      // returns the number of shared_ptr objects referring to the same managed object 
+      long  use_count() const noexcept { return my_ops != nullptr ? my_ops->use_count(&my_inplace_storage) : 0; }
+
+      // Returns an any_ptr that views the object without owning it, and so without changing the 
+      // reference count, whose casts are the same as any_shared_ptr_cast. It's only valid while 
+      // the object is owned.
+      any_ptr view() const noexcept { return detail::any_ptr_view(held(), my_ops != nullptr ? my_ops->get(&my_inplace_storage) : nullptr); }
+
+    private:
+
+      template<typename T>
+      using HeldType = std::shared_ptr<T>;
+
+      template<typename T>
+      static constexpr const detail::held_type & held_type_of() noexcept
+      {
+        return detail::held_type_v<T, HeldType<T>, HeldType<std::remove_cv_t<T>>>;
+      }
+
+      // The operations on the held shared_ptr<T> in my_inplace_storage, and its held_type
+      struct ops
+      {
+        const detail::held_type *   held;
+        void                        (*copy)(void * to, const void * from) noexcept;
+        void                        (*destroy)(void * ptr) noexcept;
+        long                        (*use_count)(const void * ptr) noexcept;
+        void *                      (*get)(const void * ptr) noexcept;
+        std::shared_ptr<void>       (*make_shared_ptr_alias)(const void * ptr, void * p) noexcept;
+        // Moves the held shared_ptr out, which leaves it empty
+        std::shared_ptr<const volatile void> (*release)(void * ptr) noexcept;
+      };
+
+      template<typename T>
+      static const HeldType<T> & held_ptr(const void * ptr) noexcept { return *static_cast<const HeldType<T>*>(ptr); }
+
+      template<typename T>
+      static HeldType<T> & held_ptr(void * ptr) noexcept { return *static_cast<HeldType<T>*>(ptr); }
+
+      template<typename T>
+      static void copy_held_ptr(void * to, const void * from) noexcept { ::new (to) HeldType<T>(held_ptr<T>(from)); }
+
+      template<typename T>
+      static void destroy_held_ptr(void * ptr) noexcept { static_cast<HeldType<T>*>(ptr)->~HeldType<T>(); }
+
+      template<typename T>
+      static long held_ptr_use_count(const void * ptr) noexcept { return held_ptr<T>(ptr).use_count(); }
+
+      template<typename T>
+      static void * get_held_ptr(const void * ptr) noexcept { return const_cast<std::remove_cv_t<T>*>(held_ptr<T>(ptr).get()); }
+
+      template<typename T>
+      static std::shared_ptr<void> make_held_ptr_alias(const void * ptr, void * p) noexcept { return std::shared_ptr<void>(held_ptr<T>(ptr), p); }
+
+      template<typename T>
+      static std::shared_ptr<const volatile void> release_held_ptr(void * ptr) noexcept { return std::move(held_ptr<T>(ptr)); }
+
+      // The static table of operations for a held shared_ptr<T>
+      template<typename T>
+      static constexpr ops ops_v{ &held_type_of<T>(), &copy_held_ptr<T>, &destroy_held_ptr<T>, &held_ptr_use_count<T>, &get_held_ptr<T>, &make_held_ptr_alias<T>, &release_held_ptr<T> };
+
+      const detail::held_type & held() const noexcept { return my_ops != nullptr ? *my_ops->held : detail::empty_held_type; }
+
+      // Borrows the held pointer as T* - see any_shared_ptr_get
+      template <typename T, typename... Site>
+      std::pair<T*, bool> borrow(Site&... site) const noexcept
+      {
+        return detail::borrowed_up_cast<T>(held(), held_type_of<T>(), my_ops != nullptr ? my_ops->get(&my_inplace_storage) : nullptr, site...);
+      }
+
+      // Returns the held shared_ptr cast to the first of Ts... - see any_shared_ptr_cast_first
+      template <typename... Ts>
+      std::variant<std::monostate, std::shared_ptr<Ts>...> cast_first() const noexcept
+      {
+        void * ptr = my_ops != nullptr ? my_ops->get(&my_inplace_storage) : nullptr;
+        const std::size_t index = detail::dynamic_up_cast_first<Ts...>(held(), ptr);
+        return detail::make_first_variant<std::variant<std::monostate, std::shared_ptr<Ts>...>>(index, 
+          [this, ptr](auto i) noexcept {
+            using T = detail::nth_type_t<decltype(i)::value, Ts...>;
+            if (detail::is_same_unqualified_type(held(), held_type_of<T>())) { // copy the held shared_ptr
+              return cv_promotion<T>(held().cv);
+            }
+            return detail::alias_shared_ptr(my_ops->make_shared_ptr_alias(&my_inplace_storage, ptr), static_cast<T*>(ptr));
+          }, 
+          std::index_sequence_for<Ts...>{});
+      }
+
+      template<typename... Ts>
+      friend std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept;
+
+      // As dynamic_up_cast() except the held shared_ptr is moved to the result, which resets 
+      // instance to the empty state, if the cast succeeds.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> move_up_cast(bool & cast_ok, Site&... site) noexcept
+      {
+        const std::pair<T*, bool> borrowed = borrow<T>(site...);
+        if (!borrowed.second) {
+          return nullptr;
+        }
+        cast_ok = true;
+        std::shared_ptr<T> result;
+        if (detail::is_same_unqualified_type(*my_ops->held, held_type_of<T>())) { 
+          result = move_cv_promotion<T>(my_ops->held->cv);
+        }
+        else {
+          result = detail::alias_shared_ptr(my_ops->release(&my_inplace_storage), borrowed.first);
+        }
+        reset();
+        return result;
+      }
+
+      // As cv_promotion() except the held shared_ptr is moved to the result, which is a 
+      // conversion to a more cv-qualified shared_ptr and so needs no aliasing ctor
+      template <typename T>
+      std::shared_ptr<T> move_cv_promotion(detail::cv_qualifiers cv) noexcept
+      {
+        using U = std::remove_cv_t<T>;
+        switch (cv) {
+        case detail::cv_none:
+          return std::move(held_ptr<U>(&my_inplace_storage));
+        case detail::cv_const:
+          if constexpr (std::is_const<T>::value) {
+            return std::move(held_ptr<const U>(&my_inplace_storage));
+          }
+          break;
+        case detail::cv_volatile:
+          if constexpr (std::is_volatile<T>::value) {
+            return std::move(held_ptr<volatile U>(&my_inplace_storage));
+          }
+          break;
+        default:
+          if constexpr (std::is_const<T>::value && std::is_volatile<T>::value) {
+            return std::move(held_ptr<const volatile U>(&my_inplace_storage));
+          }
+          break;
+        }
+        return nullptr; // unreachable as the cast doesn't drop cv-qualifiers
+      }
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr);
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept;
+#endif
+
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> dynamic_up_cast(bool & cast_ok, Site&... site) const noexcept
+      {
+        std::shared_ptr<T> result;
+        if (has_value()) {
+          const detail::held_type & held{ *my_ops->held };
+          if (detail::is_same_unqualified_type(held, held_type_of<T>())) { // is the same type up to cv-qualifiers
+            if (held.cv == detail::cv_qualifiers_of<T>()) {
+              result = held_ptr<T>(&my_inplace_storage);
+              cast_ok = true;
+            }
+            else if (held.is_cv_promotable_to(detail::cv_qualifiers_of<T>())) {
+              result = cv_promotion<T>(held.cv);
+              cast_ok = true;
+            }
+            // else the cast drops cv-qualifiers
+          }
+          else { // try an up cast
+            void * ptr = my_ops->get(&my_inplace_storage);
+            if (detail::dynamic_up_cast<T>(held, ptr, site...)) { // implicit up cast succeeded
+              result = std::static_pointer_cast<T>(my_ops->make_shared_ptr_alias(&my_inplace_storage, ptr));
+              cast_ok = true;
+            }
+          }
+        }
+        return result;
+      }
+
+      // As dynamic_up_cast() except a cast that isn't an up cast is resolved with the semantics of 
+      // dynamic_cast from the most derived object i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+      template <typename T>
+      std::shared_ptr<T> full_dynamic_cast(bool & cast_ok) const noexcept
+      {
+        std::shared_ptr<T> result = dynamic_up_cast<T>(cast_ok);
+        if (!cast_ok && has_value()) {
+          void * ptr = my_ops->get(&my_inplace_storage);
+          if (detail::dynamic_cross_cast<T>(*my_ops->held, ptr)) {
+            result = std::static_pointer_cast<T>(my_ops->make_shared_ptr_alias(&my_inplace_storage, ptr));
+            cast_ok = true;
+          }
+        }
+        return result;
+      }
+
+      // Returns the held shared_ptr with the cv-qualifiers of T where the held
+      // shared_ptr is to T with the cv-qualifiers 'cv' - see held_type::is_cv_promotable_to()
+      template <typename T>
+      std::shared_ptr<T> cv_promotion(detail::cv_qualifiers cv) const noexcept
+      {
+        using U = std::remove_cv_t<T>;
+        switch (cv) {
+        case detail::cv_none:
+          return std::const_pointer_cast<T>(held_ptr<U>(&my_inplace_storage));
+        case detail::cv_const:
+          return std::const_pointer_cast<T>(held_ptr<const U>(&my_inplace_storage));
+        case detail::cv_volatile:
+          return std::const_pointer_cast<T>(held_ptr<volatile U>(&my_inplace_storage));
+        default:
+          return std::const_pointer_cast<T>(held_ptr<const volatile U>(&my_inplace_storage));
+        }
+      }
+
+      static_assert(sizeof(HeldType<int>) == sizeof(HeldType<void>) && alignof(HeldType<int>) == alignof(HeldType<void>), 
+                    "Expected every shared_ptr<T> to have the same size and alignment");
+
+      using storage_t = typename std::aligned_storage<sizeof(HeldType<void>), std::alignment_of<HeldType<void>>::value>::type;
+
+      // Points to the operations on the held shared_ptr, otherwise nullptr to indicate an empty state.
+      const ops *             my_ops{ nullptr };
+      // Inplace storage to hold shared_ptr<T>, which is all-zero when empty
+      storage_t               my_inplace_storage{};
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr);
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
+#endif
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr);
+
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr);
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<T*> with std::pair<T*,bool>
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#endif
+
+    };
+
+    //-----------------------------------------------------------------------------------------------------
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      const std::shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      const std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+    template<typename T>
+    std::pair<std::shared_ptr<T>,bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      const std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok);
+      return std::make_pair(cast_result, std::move(is_cast_ok));
+    }
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As above except the up cast is cached in the call site's cache - see ANY_SHARED_PTR_CAST
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Borrows the held pointer as T* with the same cast as any_shared_ptr_cast but without a 
+    // shared_ptr<T> copy, and so no reference count traffic. The pointer is valid while the 
+    // any_shared_ptr, or a copy of it, holds the object.
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>(site);
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>(site);
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*,bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      return anySharedPtr->template borrow<T>();
+    }
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      return anySharedPtr->template borrow<T>(site);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_shared_ptr_cast except the held shared_ptr is moved to the result if the cast succeeds, 
+    // which leaves the any_shared_ptr empty, rather than copied. Otherwise the any_shared_ptr is unchanged.
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template move_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr && anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template move_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_move_cast(any_shared_ptr * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template move_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_shared_ptr_cast except a cast that isn't an up cast has the semantics of dynamic_cast 
+    // i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Returns the held shared_ptr cast to the first of Ts... that the cast succeeds for, or std::monostate 
+    // if there's none - see any_ptr_cast_first
+
+    template<typename... Ts>
+    std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept
+    {
+      return anySharedPtr.template cast_first<Ts...>();
+    }
+
+    // Constructs an any object containing an object of type shared_ptr<T>, 
+    // passing the provided arguments to std::make_shared<T>.
+    // Is equivalent to 
+    //    return any_shared_ptr{ std::make_shared<T>(std::forward<Args>(args)...) }
+    template<class T, class... Args>
+    inline   any_shared_ptr make_any_shared_ptr(Args&&... args)
+    {
+      return any_shared_ptr{ std::make_shared<T>(std::forward<Args>(args)...) };
+    }
+
+  } // namespace v2
+
+
+  namespace v3 {
+
+    /**
+    The class v3::any_shared_ptr is an any_shared_ptr that's the size of a single pointer.
+
+    The handle points to a control block that holds the atomic count of the handles, the 
+    held_type of the held shared_ptr<T> and the held shared_ptr itself. The shared_ptr keeps 
+    the object alive while there are handles or any shared_ptr returned by any_shared_ptr_cast.
+    Thus use_count() counts each handle as for v1::any_shared_ptr, whereas the use_count() of 
+    a shared_ptr returned by any_shared_ptr_cast counts all the handles as one.
+
+    v3::make_any_shared_ptr allocates the control block, the shared_ptr's control block and 
+    the object in a single allocation, whereas adopting an existing shared_ptr<T> costs an 
+    extra allocation for the control block.
+    */
+    class any_shared_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors/dtor and copy operators
+
+      ~any_shared_ptr() { release(my_block); }
+
+      any_shared_ptr(any_shared_ptr const & other) noexcept : my_block{ acquire(other.my_block) } {}
+
+      any_shared_ptr(any_shared_ptr && other) noexcept : my_block{ std::exchange(other.my_block, nullptr) } {}
+
+      any_shared_ptr& operator=(any_shared_ptr const& other) noexcept
+      {
+        any_shared_ptr{ other }.swap(*this);
+        return *this;
+      }
+
+      any_shared_ptr& operator=(any_shared_ptr && other) noexcept
+      {
+        any_shared_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // ctors
+
+      constexpr any_shared_ptr() noexcept = default;
+
+      // Adopts 'ptr', which allocates a control block
+      template<typename T>
+      any_shared_ptr(std::shared_ptr<T> ptr)
+        : my_block{ new control_block{ &held_type_of<T>(), std::const_pointer_cast<std::remove_cv_t<T>>(std::move(ptr)), true } }
+      {
+      }
 
       //-----------------------------------------------------
       // Modifiers
 
-      // swaps two any objects 
-      void swap(any_shared_ptr & other) noexcept { other = std::exchange(*this, std::move(other)); }
+      // swaps two any objects
+      void swap(any_shared_ptr & other) noexcept { std::swap(my_block, other.my_block); }
 
       // reset to empty state 
-      void reset() noexcept 
-      { 
-        this->~any_shared_ptr();
-        ::new (this) any_shared_ptr();
-      }
+      void reset() noexcept { any_shared_ptr{}.swap(*this); }
 
       //-----------------------------------------------------
       // Observers
 
       // return true if not empty
-      bool has_value() const noexcept { return holder()->has_value(); }
+      bool has_value() const noexcept { return my_block != nullptr; }
 
       // Returns typeid(std::shared_ptr<T>) if instance is non-empty,
       // otherwise typeid(void).
-      const std::type_info & type() const noexcept { return holder()->type(); }
+      const std::type_info & type() const noexcept { return *held().type; }
 
-      // returns the number of shared_ptr objects referring to the same managed object 
-      long  use_count() const noexcept { return holder()->use_count(); }
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return held().type_id(); }
+
+      // returns the number of shared_ptr objects referring to the same managed object, where
+      // each handle counts as one in the same way as a v1::any_shared_ptr
+      long  use_count() const noexcept 
+      { 
+        if (my_block == nullptr) {
+          return 0;
+        }
+        // The held shared_ptr is shared by all the handles 
+        return my_block->my_use_count.load(std::memory_order_relaxed) + my_block->my_shared_ptr.use_count() - 1;
+      }
+
+      // Returns an any_ptr that views the object without owning it, and so without changing the 
+      // reference count, whose casts are the same as any_shared_ptr_cast. It's only valid while 
+      // the object is owned.
+      any_ptr view() const noexcept { return detail::any_ptr_view(held(), my_block != nullptr ? my_block->my_shared_ptr.get() : nullptr); }
 
     private:
 
-      template<typename T>
-      using HeldType = std::shared_ptr<T>;
+      // The control block shared by the handles that refer to the same held shared_ptr
+      struct control_block
+      {
+        const detail::held_type *   my_held_type;
+        std::shared_ptr<void>       my_shared_ptr;
+        // True if the control block was allocated by adopting a shared_ptr, otherwise it's 
+        // allocated along with the held shared_ptr by make_any_shared_ptr.
+        bool                        my_is_adopted;
+        std::atomic<long>           my_use_count{ 1 };
+      };
 
-      template <typename T>
-      std::shared_ptr<T> dynamic_up_cast(bool & cast_ok) const noexcept
+      // The allocator that std::allocate_shared uses to place a control_block in front of its allocation
+      template<typename T>
+      struct control_block_allocator
       {
-        std::shared_ptr<T> result;
-        if (has_value()) {
-          const IHolder * pholder{ holder() };
-          if (type() == typeid(HeldType<T>)) {
-            // [[gsl::suppress(type.2)]] // warning C26491: Don't use static_cast downcasts. A cast from a polymorphic type should use dynamic_cast. (type.2)
-            result = static_cast<const Holder<T>*>(pholder)->my_ptr;
-            cast_ok = true;
+        using value_type = T;
+
+        // Set to the memory for the control_block by allocate()
+        control_block ** my_block;
+
+        explicit control_block_allocator(control_block ** block) noexcept : my_block{ block } {}
+
+        template<typename U>
+        control_block_allocator(control_block_allocator<U> const & other) noexcept : my_block{ other.my_block } {}
+
+        // The size of the memory in front of the allocation that holds the control_block
+        static constexpr std::size_t alignment = alignof(T) > alignof(control_block) ? alignof(T) : alignof(control_block);
+        static constexpr std::size_t prefix_size = (sizeof(control_block) + alignment - 1) / alignment * alignment;
+        static constexpr bool is_over_aligned = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        T* allocate(std::size_t n)
+        {
+          const std::size_t size = prefix_size + n * sizeof(T);
+          void * const memory = is_over_aligned ? ::operator new(size, std::align_val_t{ alignment }) : ::operator new(size);
+          *my_block = static_cast<control_block*>(memory);
+          return reinterpret_cast<T*>(static_cast<char*>(memory) + prefix_size);
+        }
+
+        void deallocate(T* ptr, std::size_t /*n*/) noexcept
+        {
+          void * const memory = reinterpret_cast<char*>(ptr) - prefix_size;
+          if (is_over_aligned) {
+            ::operator delete(memory, std::align_val_t{ alignment });
           }
-          else { // try an up cast by throwing an exception
-            try {
-              pholder->throw_held_pointer();
-            }
-            catch (T* p) { // implicit up cast succeeded
-              result = std::static_pointer_cast<T>(pholder->make_shared_ptr_alias(const_cast<std::remove_cv_t<T>*>(p)));
-              cast_ok = true;
-            }
-            catch (...) { // up cast failed
-            }
+          else {
+            ::operator delete(memory);
           }
         }
-        return result;
-      }
 
-      // Base class for the class holds shared_ptr
-      struct IHolder
-      {
-        virtual ~IHolder() = default;
+        template<typename U>
+        bool operator==(control_block_allocator<U> const & other) const noexcept { return my_block == other.my_block; }
 
-        virtual bool                    has_value() const noexcept = 0;
-        virtual const std::type_info&   type() const noexcept = 0;
-        virtual long                    use_count() const noexcept = 0;
-        virtual const IHolder *         clone(void* const inplaceMemory) const noexcept = 0;
-        virtual void                    throw_held_pointer() const = 0;
-        virtual std::shared_ptr<void>   make_shared_ptr_alias(void * ptr) const noexcept = 0;
+        template<typename U>
+        bool operator!=(control_block_allocator<U> const & other) const noexcept { return my_block != other.my_block; }
       };
 
-      template<typename T>
-      struct Holder final : public IHolder
+      // Points to the control_block, otherwise nullptr to indicate an empty state.
+      control_block *   my_block{ nullptr };
+
+      explicit any_shared_ptr(control_block * block) noexcept : my_block{ block } {}
+
+      static control_block * acquire(control_block * block) noexcept
       {
-        // The held shared_ptr
-        std::shared_ptr<T>  my_ptr;
+        if (block != nullptr) {
+          block->my_use_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return block;
+      }
 
-        Holder() = default;
-        Holder(std::shared_ptr<T> ptr) : my_ptr(std::move(ptr)) {}
+      static void release(control_block * block) noexcept
+      {
+        if (block != nullptr && block->my_use_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          // The held shared_ptr may own the memory of the control block so it's released last
+          const std::shared_ptr<void> ptr{ std::move(block->my_shared_ptr) };
+          if (block->my_is_adopted) {
+            delete block;
+          }
+          else {
+            block->~control_block();
+          }
+        }
+      }
 
-        bool                    has_value() const noexcept { return true; }
-        const std::type_info&   type() const noexcept { return typeid(HeldType<T>); }
-        long                    use_count() const noexcept final { return my_ptr.use_count(); }
-        const IHolder *         clone(void* const inplaceMemory) const noexcept final { return ::new (inplaceMemory) Holder(my_ptr); }
-        void                    throw_held_pointer() const final { throw my_ptr.get(); }
-        std::shared_ptr<void>   make_shared_ptr_alias(void* p) const noexcept final { return std::shared_ptr<void>(my_ptr, p); }
-      };
+      template<typename T>
+      using HeldType = std::shared_ptr<T>;
 
-      struct EmptyHolder final : public IHolder
+      template<typename T>
+      static constexpr const detail::held_type & held_type_of() noexcept
       {
-        // Not used - is required so that sizeof(Holder<void>) == sizeof(EmptyHolder)
-        std::shared_ptr<void>  my_ptr;
+        return detail::held_type_v<T, HeldType<T>, HeldType<std::remove_cv_t<T>>>;
+      }
 
-        EmptyHolder() = default;
+      const detail::held_type & held() const noexcept { return my_block != nullptr ? *my_block->my_held_type : detail::empty_held_type; }
 
-        bool                    has_value() const noexcept { return false; }
-        const std::type_info&   type() const noexcept { return typeid(void); }
-        long                    use_count() const noexcept final { return 0; }
-        const IHolder *         clone(void* const inplaceMemory) const noexcept final { return ::new (inplaceMemory) EmptyHolder(); }
-        void                    throw_held_pointer() const final {}
-        std::shared_ptr<void>   make_shared_ptr_alias(void* ) const noexcept final { return my_ptr; }
-      };
+      // Borrows the held pointer as T* - see any_shared_ptr_get
+      template <typename T, typename... Site>
+      std::pair<T*, bool> borrow(Site&... site) const noexcept
+      {
+        return detail::borrowed_up_cast<T>(held(), held_type_of<T>(), my_block != nullptr ? my_block->my_shared_ptr.get() : nullptr, site...);
+      }
 
-      static_assert(sizeof(Holder<void>) == sizeof(EmptyHolder), "It's not essential but sizeof(Holder<void>) == sizeof(EmptyHolder)"
-                                                                 " is better so that all bytes in my_inplace_storage are initialized");
+      // Returns the held shared_ptr cast to the first of Ts... - see any_shared_ptr_cast_first
+      template <typename... Ts>
+      std::variant<std::monostate, std::shared_ptr<Ts>...> cast_first() const noexcept
+      {
+        void * ptr = my_block != nullptr ? my_block->my_shared_ptr.get() : nullptr;
+        const std::size_t index = detail::dynamic_up_cast_first<Ts...>(held(), ptr);
+        return detail::make_first_variant<std::variant<std::monostate, std::shared_ptr<Ts>...>>(index, 
+          [this, ptr](auto i) noexcept {
+            using T = detail::nth_type_t<decltype(i)::value, Ts...>;
+            return std::shared_ptr<T>(my_block->my_shared_ptr, static_cast<T*>(ptr));
+          }, 
+          std::index_sequence_for<Ts...>{});
+      }
 
-      using storage_t = typename std::aligned_storage<sizeof(Holder<void>), std::alignment_of<Holder<void>>::value>::type;
+      template<typename... Ts>
+      friend std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept;
 
-      // Inplace storage to hold Holder<T>
-      storage_t               my_inplace_storage;
+      // Attempt a dynamic up cast to T to replicate an implicit up cast
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> dynamic_up_cast(bool & cast_ok, Site&... site) const noexcept
+      {
+        std::shared_ptr<T> result;
+        if (has_value()) {
+          const detail::held_type & held{ *my_block->my_held_type };
+          if (detail::is_same_unqualified_type(held, held_type_of<T>())) { // is the same type up to cv-qualifiers
+            if (held.is_cv_promotable_to(detail::cv_qualifiers_of<T>())) {
+              result = std::static_pointer_cast<T>(my_block->my_shared_ptr);
+              cast_ok = true;
+            }
+            // else the cast drops cv-qualifiers
+          }
+          else { // try an up-cast
+            void * ptr = my_block->my_shared_ptr.get();
+            if (detail::dynamic_up_cast<T>(held, ptr, site...)) { // up-cast succeeded
+              result = std::shared_ptr<T>(my_block->my_shared_ptr, static_cast<T*>(ptr));
+              cast_ok = true;
+            }
+          }
+        }
+        return result;
+      }
 
-      // Pointer to my_inplace_storage that holds Holder<T> 
-      const IHolder *  holder() const noexcept 
-      { 
-        // [[gsl::suppress(type.1)]]  // warning C26490 : Don't use reinterpret_cast. (type.1)
-        return reinterpret_cast<const IHolder *>(&my_inplace_storage); 
+      // As dynamic_up_cast() except a cast that isn't an up cast is resolved with the semantics of 
+      // dynamic_cast from the most derived object i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+      template <typename T>
+      std::shared_ptr<T> full_dynamic_cast(bool & cast_ok) const noexcept
+      {
+        std::shared_ptr<T> result = dynamic_up_cast<T>(cast_ok);
+        if (!cast_ok && has_value()) {
+          void * ptr = my_block->my_shared_ptr.get();
+          if (detail::dynamic_cross_cast<T>(*my_block->my_held_type, ptr)) {
+            result = std::shared_ptr<T>(my_block->my_shared_ptr, static_cast<T*>(ptr));
+            cast_ok = true;
+          }
+        }
+        return result;
       }
 
+      template<typename T, typename... Args>
+      friend any_shared_ptr make_any_shared_ptr(Args&&... args);
+
       template<typename T>
       friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr);
 
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
 #ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
       template<typename T>
       friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
 #else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
       template<typename T>
-      std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+      template<typename T>
+      friend std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept;
+#endif
+
+      template<typename T>
+      friend std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr);
+
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr);
+
+      template<typename T>
+      friend T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site);
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
+#else // replace std::optional<T*> with std::pair<T*,bool>
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept;
+      template<typename T>
+      friend std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept;
 #endif
 
     };
 
+    static_assert(sizeof(any_shared_ptr) == sizeof(void*), "v3::any_shared_ptr should be the size of a pointer");
+
     //-----------------------------------------------------------------------------------------------------
 
     template<typename T>
@@ -460,17 +1627,180 @@ namespace xxx {
     }
 #endif
 
+    //-----------------------------------------------------------------------------------------------------
+    // As above except the up cast is cached in the call site's cache - see ANY_SHARED_PTR_CAST
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_cast(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_cast(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template dynamic_up_cast<T>(is_cast_ok, site);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Borrows the held pointer as T* with the same cast as any_shared_ptr_cast but without a 
+    // shared_ptr<T> copy, and so no reference count traffic. The pointer is valid while the 
+    // any_shared_ptr, or a copy of it, holds the object.
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+    template<typename T>
+    T* any_shared_ptr_get(any_shared_ptr const & anySharedPtr, call_site_cache<T> & site)
+    {
+      const std::pair<T*, bool> result = anySharedPtr.template borrow<T>(site);
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+    template<typename T>
+    std::optional<T*> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = anySharedPtr->template borrow<T>(site);
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*,bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      return anySharedPtr->template borrow<T>();
+    }
+
+    template<typename T>
+    std::pair<T*, bool> any_shared_ptr_get(any_shared_ptr const * anySharedPtr, call_site_cache<T> & site) noexcept
+    {
+      return anySharedPtr->template borrow<T>(site);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // As any_shared_ptr_cast except a cast that isn't an up cast has the semantics of dynamic_cast 
+    // i.e. a down cast or a cross cast - see any_ptr_dynamic_cast
+
+    template<typename T>
+    std::shared_ptr<T> any_shared_ptr_dynamic_cast(any_shared_ptr const & anySharedPtr)
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> result = anySharedPtr.template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        return result;
+      }
+      throw bad_any_shared_ptr_cast();
+    }
+
+#ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<std::shared_ptr<T>> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      std::optional<std::shared_ptr<T>> result;
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      if (is_cast_ok) {
+        result = std::move(cast_result);
+      }
+      return result;
+    }
+
+#else // replace std::optional<std::shared_ptr<T>> with std::pair<std::shared_ptr<T>,bool>
+
+    template<typename T>
+    std::pair<std::shared_ptr<T>, bool> any_shared_ptr_dynamic_cast(any_shared_ptr const * anySharedPtr) noexcept
+    {
+      bool is_cast_ok{ false };
+      std::shared_ptr<T> cast_result = anySharedPtr->template full_dynamic_cast<T>(is_cast_ok);
+      return std::make_pair(std::move(cast_result), is_cast_ok);
+    }
+
+#endif
+
+    //-----------------------------------------------------------------------------------------------------
+    // Returns the held shared_ptr cast to the first of Ts... that the cast succeeds for, or std::monostate 
+    // if there's none - see any_ptr_cast_first
+
+    template<typename... Ts>
+    std::variant<std::monostate, std::shared_ptr<Ts>...> any_shared_ptr_cast_first(any_shared_ptr const & anySharedPtr) noexcept
+    {
+      return anySharedPtr.template cast_first<Ts...>();
+    }
+
     // Constructs an any object containing an object of type shared_ptr<T>, 
-    // passing the provided arguments to std::make_shared<T>.
-    // Is equivalent to 
-    //    return any_shared_ptr{ std::make_shared<T>(std::forward<Args>(args)...) }
-    template<class T, class... Args>
-    inline   any_shared_ptr make_any_shared_ptr(Args&&... args)
+    // passing the provided arguments to the constructor of T.
+    // The control block, the shared_ptr's control block and T are allocated in a single allocation.
+    template<typename T, typename... Args>
+    any_shared_ptr make_any_shared_ptr(Args&&... args)
     {
-      return any_shared_ptr{ std::make_shared<T>(std::forward<Args>(args)...) };
+      using block_allocator = any_shared_ptr::control_block_allocator<std::remove_cv_t<T>>;
+      any_shared_ptr::control_block * block{ nullptr };
+      std::shared_ptr<std::remove_cv_t<T>> ptr = std::allocate_shared<std::remove_cv_t<T>>(block_allocator{ &block }, std::forward<Args>(args)...);
+      return any_shared_ptr{ ::new (block) any_shared_ptr::control_block{ &any_shared_ptr::held_type_of<T>(), std::move(ptr), false } };
     }
 
-  } // namespace v2
+  } // namespace v3
+
+  // A pointer, or a pointer and a shared_ptr, that's relocated by copying its bytes - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<v1::any_shared_ptr> : std::true_type {};
+  template<> struct is_trivially_relocatable<v2::any_shared_ptr> : std::true_type {};
+  template<> struct is_trivially_relocatable<v3::any_shared_ptr> : std::true_type {};
 
 } // namespace xxx {
 
@@ -487,8 +1817,17 @@ namespace std {
     lhs.swap(rhs);
   }
 
+  inline void swap(xxx::v3::any_shared_ptr & lhs, xxx::v3::any_shared_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
 } // namespace std
 
 #ifdef ANY_SHARED_PTR_HAS_LIB_OPTIONAL 
 #undef ANY_SHARED_PTR_HAS_LIB_OPTIONAL 
-#endif
\ No newline at end of file
+#endif
+
+#ifdef ANY_SHARED_PTR_HAS_ALIASING_MOVE 
+#undef ANY_SHARED_PTR_HAS_ALIASING_MOVE 
+#endif
@@ -0,0 +1,330 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include "any_ptr.h"
+#include "trivially_relocatable.h"
+#ifdef _MSC_VER
+  #if _HAS_CXX17 != 0
+    #include <optional>
+    #define ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#else
+  #if __has_include(<optional>) // requires GCC 5 or greater
+    #include <optional>
+    #define ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL 
+  #else
+    #include <experimental/optional>
+    namespace std {
+      using std::experimental::optional;
+    } // namespace std
+    #define ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#endif
+
+namespace xxx {
+
+  inline namespace v1 {
+
+    /**
+      The class any_unique_ptr is a move-only container for any std::unique_ptr<T, D> that,
+      like any_ptr, supports cv-qualifier promotion and dynamic up cast when the owned 
+      pointer is borrowed:
+
+        xxx::any_unique_ptr a{ std::make_unique<Derived>() };
+        Base * p = xxx::any_ptr_cast<Base>( a ); // implicit up cast succeeds, 'a' still owns the Derived
+        std::unique_ptr<Base> u = a.release_as<Base>(); // ownership moves to 'u' as Base has a virtual dtor
+
+      The deleter D is type erased. An empty deleter that's default constructible, such as 
+      std::default_delete<T>, isn't stored so the any_unique_ptr is two pointers, i.e. the owned
+      pointer and a pointer to a static table of operations for unique_ptr<T, D>. Otherwise the 
+      pointer and the deleter are moved to the heap.
+    */
+    class any_unique_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors, dtor and copy operators
+
+      ~any_unique_ptr() 
+      { 
+        if (my_ops != nullptr) {
+          my_ops->destroy(my_data);
+        }
+      }
+
+      any_unique_ptr(any_unique_ptr const &) = delete;
+
+      any_unique_ptr& operator=(any_unique_ptr const &) = delete;
+
+      any_unique_ptr(any_unique_ptr && other) noexcept
+        : my_ops{ std::exchange(other.my_ops, nullptr) }
+        , my_data{ std::exchange(other.my_data, nullptr) }
+      {
+      }
+
+      any_unique_ptr& operator=(any_unique_ptr && other) noexcept
+      {
+        any_unique_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // Constructors
+
+      // set to empty state
+      constexpr any_unique_ptr() noexcept = default;
+
+      // Takes ownership of the pointer owned by 'ptr'. The deleter is moved to the heap unless 
+      // it's an empty default constructible type.
+      template<typename T, typename D>
+      any_unique_ptr(std::unique_ptr<T, D> && ptr)
+        : my_ops{ &ops_v<T, D> }
+        , my_data{ make_data(std::move(ptr)) }
+      {
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // Reset to empty state, which deletes the owned pointer 
+      void reset() noexcept
+      {
+        any_unique_ptr{}.swap(*this);
+      }
+
+      // Swaps two any_unique_ptr objects
+      void swap(any_unique_ptr & other) noexcept
+      {
+        std::swap(my_ops, other.my_ops);
+        std::swap(my_data, other.my_data);
+      }
+
+      // Moves the ownership of the owned pointer to a unique_ptr<T> if the owned pointer can be 
+      // cast to T* and it's deleted by std::default_delete, which requires that T has a virtual 
+      // destructor unless T is the owned type. Otherwise throws bad_any_ptr_cast and keeps ownership.
+      template<typename T>
+      std::unique_ptr<T> release_as()
+      {
+        if (my_ops == nullptr || !my_ops->is_default_delete) {
+          throw bad_any_ptr_cast();
+        }
+        const std::pair<T*, bool> result = dynamic_up_cast<T>();
+        if (!result.second) {
+          throw bad_any_ptr_cast();
+        }
+        if (!std::has_virtual_destructor<T>::value && !detail::is_same_unqualified_type(*my_ops->held, detail::held_type_v<T>)) {
+          throw bad_any_ptr_cast(); // only the owned type can delete it without a virtual destructor 
+        }
+        my_ops = nullptr;
+        my_data = nullptr;
+        return std::unique_ptr<T>{ result.first };
+      }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // Returns true if instance is non-empty.
+      bool has_value() const noexcept { return my_ops != nullptr; }
+
+      // Returns the typeid(T*) of the owned pointer T* if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info& type() const noexcept { return *held().type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return held().type_id(); }
+
+      // Returns the owned pointer as an any_ptr, which doesn't own it.
+      any_ptr get() const noexcept
+      {
+        any_ptr result;
+        if (my_ops != nullptr) {
+          result.my_held_type = my_ops->held;
+          result.my_ptr = my_ops->is_boxed ? static_cast<const box_base*>(my_data)->my_ptr : my_data;
+        }
+        return result;
+      }
+
+    private:
+
+      // The operations on the owned pointer of a unique_ptr<T, D>
+      struct ops
+      {
+        const detail::held_type *   held;
+        void                        (*destroy)(void * data) noexcept;
+        // True if 'data' points to a box<T, D> on the heap rather than to the owned T
+        bool                        is_boxed;
+        // True if D is std::default_delete<T>
+        bool                        is_default_delete;
+      };
+
+      // The owned pointer and a deleter that's moved to the heap
+      struct box_base
+      {
+        void *  my_ptr;
+      };
+
+      template<typename T, typename D>
+      struct box : box_base
+      {
+        D       my_deleter;
+
+        box(T * ptr, D && deleter) : box_base{ const_cast<std::remove_cv_t<T>*>(ptr) }, my_deleter{ std::move(deleter) } {}
+      };
+
+      template<typename D>
+      static constexpr bool is_boxed_v = !(std::is_empty<D>::value && std::is_default_constructible<D>::value);
+
+      template<typename T, typename D>
+      static void destroy(void * data) noexcept
+      {
+        if constexpr (is_boxed_v<D>) {
+          box<T, D> * const pbox = static_cast<box<T, D>*>(data);
+          if (pbox->my_ptr != nullptr) {
+            pbox->my_deleter(static_cast<T*>(pbox->my_ptr));
+          }
+          delete pbox;
+        }
+        else if (data != nullptr) {
+          D{}(static_cast<T*>(data));
+        }
+      }
+
+      template<typename T, typename D>
+      static void * make_data(std::unique_ptr<T, D> && ptr)
+      {
+        static_assert(!std::is_array<T>::value, "any_unique_ptr doesn't support arrays");
+        static_assert(!std::is_reference<D>::value, "any_unique_ptr doesn't support a reference to a deleter");
+        static_assert(std::is_same<typename std::unique_ptr<T, D>::pointer, T*>::value, "any_unique_ptr requires that the deleter's pointer type is T*");
+        if constexpr (is_boxed_v<D>) {
+          box<T, D> * const pbox = new box<T, D>{ ptr.get(), std::move(ptr.get_deleter()) };
+          ptr.release();
+          return pbox;
+        }
+        else {
+          return const_cast<std::remove_cv_t<T>*>(ptr.release());
+        }
+      }
+
+      // The static table of operations for a unique_ptr<T, D>
+      template<typename T, typename D>
+      static constexpr ops ops_v{ &detail::held_type_v<T>, &destroy<T, D>, is_boxed_v<D>, std::is_same<D, std::default_delete<T>>::value };
+
+      // Points to the operations on the owned pointer, otherwise nullptr to indicate an empty state.
+      const ops *   my_ops{ nullptr };
+      // The owned pointer, or else the box<T, D> that holds it if ops::is_boxed
+      void *        my_data{ nullptr };
+
+      const detail::held_type & held() const noexcept { return my_ops != nullptr ? *my_ops->held : detail::empty_held_type; }
+
+      // Attempt a dynamic up cast to T to replicate an implicit up cast - see any_ptr
+      template <typename T>
+      std::pair<T*, bool> dynamic_up_cast() const noexcept
+      {
+        return get().template dynamic_up_cast<T>();
+      }
+
+#ifdef ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL
+
+      template<typename T>
+      friend std::optional<T*> any_ptr_cast(any_unique_ptr const * any_ptr_) noexcept;
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+      template<typename T>
+      friend std::pair<T*, bool> any_ptr_cast(const any_unique_ptr * any_ptr_) noexcept;
+
+#endif
+
+      template<typename T>
+      friend T* any_ptr_cast(any_unique_ptr const & any_ptr_);
+    };
+
+    static_assert(sizeof(any_unique_ptr) == 2 * sizeof(void*), "any_unique_ptr should be the size of two pointers");
+
+    //-----------------------------------------------------------------------------------------------------
+    // Borrows the owned pointer i.e. the any_unique_ptr retains ownership
+
+
+#ifdef ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_ptr_cast(const any_unique_ptr * any_ptr_) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = any_ptr_->template dynamic_up_cast<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_ptr_cast(const any_unique_ptr * any_ptr_) noexcept
+    {
+      return any_ptr_->template dynamic_up_cast<T>();
+    }
+
+#endif
+
+    template<typename T>
+    T* any_ptr_cast(any_unique_ptr const & any_ptr_)
+    {
+      const std::pair<T*, bool> result = any_ptr_.template dynamic_up_cast<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_ptr_cast();
+    }
+
+    // Constructs an any_unique_ptr that owns a T, passing the provided arguments to std::make_unique<T>.
+    template<typename T, typename... Args>
+    any_unique_ptr make_any_unique_ptr(Args&&... args)
+    {
+      return any_unique_ptr{ std::make_unique<T>(std::forward<Args>(args)...) };
+    }
+
+  } // namespace v1
+
+  // The owned pointer, or the box that holds it, is relocated by copying its bits - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<any_unique_ptr> : std::true_type {};
+
+} // namespace xxx
+
+
+namespace std {
+
+  inline void swap(xxx::any_unique_ptr & lhs, xxx::any_unique_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+} // namespace std
+
+#ifdef ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL 
+#undef ANY_UNIQUE_PTR_HAS_LIB_OPTIONAL 
+#endif
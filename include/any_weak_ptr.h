@@ -0,0 +1,251 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include "any_shared_ptr.h"
+#include "call_site_cache.h"
+#include "dynamic_up_cast.h"
+#include "held_type.h"
+#include "trivially_relocatable.h"
+#include "weak_ptr_ops.h"
+
+namespace xxx {
+
+  inline namespace v1 {
+
+    /**
+      The class any_weak_ptr is a type-erased std::weak_ptr to the object owned by an 
+      any_shared_ptr i.e. it doesn't keep the object alive. The object is locked as 
+      a shared_ptr<T> with the same cv-qualifier promotion and dynamic up cast as
+      any_shared_ptr_cast:
+
+        xxx::any_shared_ptr a{ std::make_shared<Derived>() };
+        xxx::any_weak_ptr w{ a };
+        std::shared_ptr<const Base> p = w.lock_as<const Base>(); // cv-promotion and up cast succeed
+
+      lock_as<T>() locks the weak_ptr once and hands that reference to the returned 
+      shared_ptr<T>, rather than locking an any_shared_ptr and then copying the result of 
+      any_shared_ptr_cast. To do so without the C++20 shared_ptr aliasing ctor that moves 
+      from its source, a weak_ptr<T> to the object of a shared_ptr<T> is stored as is, 
+      alongside a pointer to a static table of operations on it, so a cast to T up to 
+      cv-qualifiers is a plain weak_ptr<T>::lock(). The table for the type-erased shared_ptr 
+      of an any_shared_ptr is found via its held_type (see held_type::weak_ops).
+    */
+    class any_weak_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors/dtor and copy operators
+
+      ~any_weak_ptr() 
+      { 
+        if (my_ops != nullptr) {
+          my_ops->destroy(&my_inplace_storage);
+        }
+      }
+
+      any_weak_ptr(any_weak_ptr const & other) noexcept
+        : my_held_type{ other.my_held_type }
+        , my_ops{ other.my_ops }
+      {
+        if (my_ops != nullptr) {
+          my_ops->copy(&my_inplace_storage, &other.my_inplace_storage);
+        }
+      }
+
+      any_weak_ptr(any_weak_ptr && other) noexcept
+        : my_held_type{ std::exchange(other.my_held_type, &detail::empty_held_type) }
+        , my_ops{ std::exchange(other.my_ops, nullptr) }
+        , my_inplace_storage{ std::exchange(other.my_inplace_storage, storage_t{}) }
+      {
+      }
+
+      any_weak_ptr& operator=(any_weak_ptr const& other) noexcept
+      {
+        any_weak_ptr{ other }.swap(*this);
+        return *this;
+      }
+
+      any_weak_ptr& operator=(any_weak_ptr && other) noexcept
+      {
+        any_weak_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // ctors
+
+      // set to empty state
+      any_weak_ptr() noexcept = default;
+
+      // Observes the object owned by 'ptr' 
+      any_weak_ptr(any_shared_ptr const & ptr) noexcept
+        : my_held_type{ ptr.my_held_type }
+      {
+        if (ptr.has_value()) {
+          my_ops = ptr.my_held_type->weak_ops;
+          my_ops->observe(&my_inplace_storage, ptr.my_shared_ptr);
+        }
+      }
+
+      // Observes the object owned by 'ptr' 
+      template<typename T>
+      any_weak_ptr(std::shared_ptr<T> const & ptr) noexcept
+        : my_held_type{ &any_shared_ptr::held_type_of<T>() }
+        , my_ops{ &detail::weak_ptr_ops_v<std::remove_cv_t<T>> }
+      {
+        ::new (&my_inplace_storage) std::weak_ptr<std::remove_cv_t<T>>(std::const_pointer_cast<std::remove_cv_t<T>>(ptr));
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // swaps two any_weak_ptr objects, which are relocated by copying their bits
+      void swap(any_weak_ptr & other) noexcept 
+      { 
+        std::swap(my_held_type, other.my_held_type);
+        std::swap(my_ops, other.my_ops);
+        std::swap(my_inplace_storage, other.my_inplace_storage);
+      }
+
+      // reset to empty state 
+      void reset() noexcept { any_weak_ptr{}.swap(*this); }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // Returns true if not empty i.e. it was constructed from a non-empty any_shared_ptr,
+      // which is regardless of whether the object has since expired.
+      bool has_value() const noexcept { return my_ops != nullptr; }
+
+      // Returns typeid(std::shared_ptr<T>) if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info & type() const noexcept { return *my_held_type->type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return my_held_type->type_id(); }
+
+      // Returns the number of shared_ptr objects that own the object
+      long use_count() const noexcept { return my_ops != nullptr ? my_ops->use_count(&my_inplace_storage) : 0; }
+
+      // Returns true if the object has been deleted, or if instance is empty. Unlike 
+      // lock_as() it only loads the reference count.
+      bool expired() const noexcept { return my_ops == nullptr || my_ops->expired(&my_inplace_storage); }
+
+      //-----------------------------------------------------
+      // Locking
+
+      // Returns an any_shared_ptr that owns the object, otherwise an empty any_shared_ptr
+      // if the object has expired.
+      any_shared_ptr lock() const noexcept
+      {
+        any_shared_ptr result;
+        if (my_ops != nullptr) {
+          std::shared_ptr<void> locked = my_ops->lock(&my_inplace_storage);
+          if (locked != nullptr) {
+            result.my_held_type = my_held_type;
+            result.my_shared_ptr = std::move(locked);
+          }
+        }
+        return result;
+      }
+
+      // Returns a shared_ptr<T> that owns the object if the object hasn't expired and the  
+      // held pointer can be cast to T* - see any_shared_ptr_cast. Otherwise returns an empty shared_ptr<T>.
+      template<typename T>
+      std::shared_ptr<T> lock_as() const noexcept
+      {
+        return lock_as_impl<T>();
+      }
+
+      // As above except the up cast is cached in the call site's cache - see ANY_SHARED_PTR_CAST
+      template<typename T>
+      std::shared_ptr<T> lock_as(call_site_cache<T> & site) const noexcept
+      {
+        return lock_as_impl<T>(site);
+      }
+
+    private:
+
+      // The operations on the held weak_ptr<T> in my_inplace_storage 
+      using ops = detail::weak_ptr_ops;
+
+      static_assert(sizeof(std::weak_ptr<int>) == sizeof(std::weak_ptr<void>) && alignof(std::weak_ptr<int>) == alignof(std::weak_ptr<void>), 
+                    "Expected every weak_ptr<T> to have the same size and alignment");
+
+      using storage_t = typename std::aligned_storage<sizeof(std::weak_ptr<void>), std::alignment_of<std::weak_ptr<void>>::value>::type;
+
+      // Describes typeid(shared_ptr<T>) if instance is not empty, 
+      // otherwise set to typeid(void) to indicate an empty state - see any_shared_ptr.
+      const detail::held_type *   my_held_type{ &detail::empty_held_type };
+      // Points to the operations on the held weak_ptr, otherwise nullptr to indicate an empty state.
+      const ops *                 my_ops{ nullptr };
+      // Inplace storage to hold weak_ptr<T>, which is all-zero when empty
+      storage_t                   my_inplace_storage{};
+
+      // Lock and then attempt a dynamic up cast to T to replicate an implicit up cast
+      // The optional 'site' is the call_site_cache of the caller.
+      template <typename T, typename... Site>
+      std::shared_ptr<T> lock_as_impl(Site&... site) const noexcept
+      {
+        if (my_ops == nullptr) {
+          return nullptr;
+        }
+        if (detail::is_same_unqualified_type(*my_held_type, any_shared_ptr::held_type_of<T>())) { // is the same type up to cv-qualifiers
+          if (!my_held_type->is_cv_promotable_to(detail::cv_qualifiers_of<T>())) {
+            return nullptr; // the cast drops cv-qualifiers
+          }
+          // holds weak_ptr<T> up to cv-qualifiers - see held_type::weak_ops
+          return detail::held_weak_ptr<std::remove_cv_t<T>>(&my_inplace_storage).lock();
+        }
+        // The object must be locked before the up cast as a virtual base is found via the object
+        std::shared_ptr<void> locked = my_ops->lock(&my_inplace_storage);
+        void * ptr = locked.get();
+        if (ptr == nullptr || !detail::dynamic_up_cast<T>(*my_held_type, ptr, site...)) {
+          return nullptr;
+        }
+        return detail::alias_shared_ptr(std::move(locked), static_cast<T*>(ptr));
+      }
+    };
+
+    static_assert(sizeof(any_weak_ptr) == 2 * sizeof(void*) + sizeof(std::weak_ptr<void>), "any_weak_ptr should be two pointers and a weak_ptr");
+
+  } // namespace v1
+
+  // The held weak_ptr is relocated by copying its bits - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<any_weak_ptr> : std::true_type {};
+
+} // namespace xxx
+
+
+namespace std {
+
+  inline void swap(xxx::any_weak_ptr & lhs, xxx::any_weak_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+} // namespace std
@@ -0,0 +1,287 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <typeinfo>
+#include "any_ptr.h"
+#include "trivially_relocatable.h"
+#ifdef _MSC_VER
+  #if _HAS_CXX17 != 0
+    #include <optional>
+    #define CACHING_ANY_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#else
+  #if __has_include(<optional>) // requires GCC 5 or greater
+    #include <optional>
+    #define CACHING_ANY_PTR_HAS_LIB_OPTIONAL 
+  #else
+    #include <experimental/optional>
+    namespace std {
+      using std::experimental::optional;
+    } // namespace std
+    #define CACHING_ANY_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#endif
+
+namespace xxx {
+
+  inline namespace v1 {
+
+    /**
+      The class caching_any_ptr is an any_ptr that remembers the most recent target type it was
+      successfully up cast to, along with the adjusted pointer, i.e. a monomorphic inline cache.
+      A repeated cast to the same target costs a pointer compare and a check of the sequence.
+
+      It's intended for long-lived instances that are repeatedly cast to the same base:
+
+        xxx::caching_any_ptr session{ new Session };
+        xxx::any_ptr_cast<Base>( session ); // dynamic up cast, result is cached in 'session'
+        xxx::any_ptr_cast<Base>( session ); // cache hit
+
+      The trade-offs compared to any_ptr are:
+      - sizeof(caching_any_ptr) is 40 bytes rather than 16 bytes (on a 64-bit platform).
+      - It's not trivially copyable as the cache is atomic. A copy carries the cache with it.
+      - Concurrent casts of the same instance are safe. The cache is a seqlock, so a cast to 
+        another target is a cache miss that falls back to any_ptr's dynamic up cast and then 
+        overwrites the cache, unless another thread is writing it. The cache is only reset by 
+        a modifier (e.g. assignment), which like any_ptr requires exclusive access.
+    */
+    class caching_any_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors, dtor and copy operators
+
+      ~caching_any_ptr() = default;
+
+      caching_any_ptr(caching_any_ptr const & other) noexcept
+        : my_any_ptr{ other.my_any_ptr }
+      {
+        copy_cache(other);
+      }
+
+      caching_any_ptr(caching_any_ptr && other) noexcept
+        : my_any_ptr{ other.my_any_ptr }
+      {
+        copy_cache(other);
+      }
+
+      caching_any_ptr& operator=(caching_any_ptr const& other) noexcept
+      {
+        my_any_ptr = other.my_any_ptr;
+        copy_cache(other);
+        return *this;
+      }
+
+      caching_any_ptr& operator=(caching_any_ptr && other) noexcept
+      {
+        return *this = other;
+      }
+
+      //-----------------------------------------------------
+      // Constructors
+
+      // set to empty state
+      caching_any_ptr() noexcept = default;
+
+      template<typename T>
+      caching_any_ptr(T* ptr) noexcept
+        : my_any_ptr{ ptr }
+      {
+      }
+
+      explicit caching_any_ptr(any_ptr const & ptr) noexcept
+        : my_any_ptr{ ptr }
+      {
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // Reset to empty state 
+      void reset() noexcept
+      {
+        *this = caching_any_ptr();
+      }
+
+      // Swaps two caching_any_ptr objects
+      void swap(caching_any_ptr & other) noexcept
+      {
+        other = std::exchange(*this, std::move(other));
+      }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // Returns true if instance is non-empty.
+      bool has_value() const noexcept { return my_any_ptr.has_value(); }
+
+      // Returns the typeid(T*) of the contained pointer T* if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info& type() const noexcept { return my_any_ptr.type(); }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return my_any_ptr.type_id(); }
+
+      // Returns the held pointer as an any_ptr.
+      const any_ptr& get() const noexcept { return my_any_ptr; }
+
+    private:
+
+      any_ptr                                   my_any_ptr;
+      // The sequence of the seqlock that guards the cache, which is odd while a thread is writing it
+      mutable std::atomic<std::size_t>          my_sequence{ 0 };
+      // The typeid(T*) of the cached cast target, nullptr if the cache is empty
+      mutable std::atomic<const std::type_info*> my_cached_type{ nullptr };
+      // The adjusted pointer of the cached cast
+      mutable std::atomic<void*>                my_cached_ptr{ nullptr };
+
+      // Returns true if the cache was read without a concurrent write, where 'cached_type' 
+      // and 'cached_ptr' are the pair that was read
+      bool read_cache(const std::type_info *& cached_type, void *& cached_ptr) const noexcept
+      {
+        const std::size_t sequence = my_sequence.load(std::memory_order_acquire);
+        cached_type = my_cached_type.load(std::memory_order_relaxed);
+        cached_ptr = my_cached_ptr.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (sequence & 1) == 0 && my_sequence.load(std::memory_order_relaxed) == sequence;
+      }
+
+      // Overwrites the cache unless another thread is writing it
+      void write_cache(const std::type_info * cached_type, void * cached_ptr) const noexcept
+      {
+        std::size_t sequence = my_sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) == 0 && my_sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+          std::atomic_thread_fence(std::memory_order_release);
+          my_cached_type.store(cached_type, std::memory_order_relaxed);
+          my_cached_ptr.store(cached_ptr, std::memory_order_relaxed);
+          my_sequence.store(sequence + 2, std::memory_order_release);
+        }
+      }
+
+      // The copy requires exclusive access to the instance, as for any modifier
+      void copy_cache(caching_any_ptr const & other) noexcept
+      {
+        const std::type_info * cached_type{ nullptr };
+        void * cached_ptr{ nullptr };
+        if (!other.read_cache(cached_type, cached_ptr)) {
+          cached_type = nullptr;
+          cached_ptr = nullptr;
+        }
+        my_cached_type.store(cached_type, std::memory_order_relaxed);
+        my_cached_ptr.store(cached_ptr, std::memory_order_relaxed);
+        my_sequence.store(0, std::memory_order_release);
+      }
+
+      // Returns the cached cast to T if it's in the cache otherwise 
+      // attempts a dynamic up cast and caches a successful result. 
+      template <typename T>
+      std::pair<T*, bool> dynamic_up_cast() const noexcept
+      {
+        const std::type_info * const target = &typeid(T*);
+        const std::type_info * cached_type{ nullptr };
+        void * cached_ptr{ nullptr };
+        if (read_cache(cached_type, cached_ptr) && cached_type == target) { // cache hit
+          return { static_cast<T*>(cached_ptr), true };
+        }
+        const std::pair<T*, bool> result = my_any_ptr.template dynamic_up_cast<T>();
+        // A cast to the held type is as cheap as a cache hit so leave the cache for an up cast
+        if (result.second && type() != *target) {
+          write_cache(target, const_cast<void*>(static_cast<const volatile void*>(result.first)));
+        }
+        return result;
+      }
+
+#ifdef CACHING_ANY_PTR_HAS_LIB_OPTIONAL
+
+      template<typename T>
+      friend std::optional<T*> any_ptr_cast(caching_any_ptr const * any_ptr_) noexcept;
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+      template<typename T>
+      friend std::pair<T*, bool> any_ptr_cast(const caching_any_ptr * any_ptr_) noexcept;
+
+#endif
+
+      template<typename T>
+      friend T* any_ptr_cast(caching_any_ptr const & any_ptr_);
+    };
+
+    //-----------------------------------------------------------------------------------------------------
+
+
+#ifdef CACHING_ANY_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_ptr_cast(const caching_any_ptr * any_ptr_) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = any_ptr_->template dynamic_up_cast<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_ptr_cast(const caching_any_ptr * any_ptr_) noexcept
+    {
+      return any_ptr_->template dynamic_up_cast<T>();
+    }
+
+#endif
+
+    template<typename T>
+    T* any_ptr_cast(caching_any_ptr const & any_ptr_)
+    {
+      const std::pair<T*, bool> result = any_ptr_.template dynamic_up_cast<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_ptr_cast();
+    }
+
+  } // namespace v1
+
+  // The cache is relocated along with the any_ptr by copying its bytes - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<caching_any_ptr> : std::true_type {};
+
+} // namespace xxx
+
+
+namespace std {
+
+  inline void swap(xxx::caching_any_ptr & lhs, xxx::caching_any_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+} // namespace std
+
+#ifdef CACHING_ANY_PTR_HAS_LIB_OPTIONAL 
+#undef CACHING_ANY_PTR_HAS_LIB_OPTIONAL 
+#endif
@@ -0,0 +1,143 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <typeinfo>
+#include "up_cast_cache.h"
+
+namespace xxx {
+
+  /**
+    The class call_site_cache is a small inline cache of the outcome of the up casts to T 
+    performed at a single call site, keyed by the held type. Most call sites only ever see 
+    one or two held types, so a warmed up call site resolves the cast without consulting 
+    the process-wide up_cast_cache. The ANY_PTR_CAST and ANY_SHARED_PTR_CAST macros 
+    declare a cache for each call site, e.g.
+
+      Base * base = ANY_PTR_CAST(Base, any);
+
+    which is equivalent to
+
+      static xxx::call_site_cache<Base> our_cache;
+      Base * base = xxx::any_ptr_cast<Base>(any, our_cache);
+
+    The cache holds up to 'entries' held types. An entry is filled once and never evicted,
+    so a megamorphic call site, i.e. one that sees more held types, falls back to the 
+    process-wide up_cast_cache for the others. Lookups are lock-free.
+  */
+  template<typename T>
+  class call_site_cache
+  {
+  public:
+
+    static constexpr std::size_t entries = 4;
+
+    constexpr call_site_cache() noexcept = default;
+
+    call_site_cache(call_site_cache const &) = delete;
+    call_site_cache& operator=(call_site_cache const &) = delete;
+
+    // Returns the cached outcome of casting the held type to T where 'offset' is
+    // set to the pointer offset of a static_offset outcome, 
+    // otherwise returns up_cast_result::unknown.
+    up_cast_result find(const std::type_info & held, std::ptrdiff_t & offset) const noexcept
+    {
+      for (const entry & e : my_entries) {
+        const std::type_info * const entry_held = e.held.load(std::memory_order_acquire);
+        if (entry_held == &held) {
+          offset = e.offset;
+          return e.result;
+        }
+        if (entry_held == nullptr) { // the entries are filled in order
+          break;
+        }
+      }
+      return up_cast_result::unknown;
+    }
+
+    // Records the outcome of casting the held type to T in the first empty entry.
+    // The update is skipped if the cache is full.
+    void insert(const std::type_info & held, up_cast_result result, std::ptrdiff_t offset) noexcept
+    {
+      for (entry & e : my_entries) {
+        const std::type_info * entry_held = e.held.load(std::memory_order_relaxed);
+        if (entry_held == nullptr && e.held.compare_exchange_strong(entry_held, filling_entry(), std::memory_order_relaxed)) {
+          e.result = result;
+          e.offset = offset;
+          e.held.store(&held, std::memory_order_release);
+          return;
+        }
+        if (entry_held == &held) { // another thread cached the outcome
+          return;
+        }
+      }
+    }
+
+  private:
+
+    // An entry is written by the thread that claims it and then published by the 
+    // release store of 'held' so that the other members needn't be atomic.
+    struct entry
+    {
+      std::atomic<const std::type_info*>  held{ nullptr };
+      up_cast_result                      result{ up_cast_result::unknown };
+      std::ptrdiff_t                      offset{ 0 };
+    };
+
+    entry my_entries[entries];
+
+    // Marks an entry that's being filled - it's never the typeid of a held type
+    static const std::type_info * filling_entry() noexcept { return &typeid(call_site_cache); }
+  };
+
+} // namespace xxx
+
+// Casts an any_ptr (or a pointer to one) to T using a cache that's local to the call site.
+// The cast is unqualified so that it also finds the casts of the same name in namespace v2.
+// Note the macro expands to a lambda and so can't be used in an unevaluated operand 
+// e.g. sizeof(), decltype() or the 1st argument of gtest's ASSERT_EQ.
+#define ANY_PTR_CAST(T, any) \
+  [](auto const & any_) -> decltype(auto) { \
+    using cast_type = T; \
+    static ::xxx::call_site_cache<cast_type> our_cache; \
+    using namespace ::xxx; \
+    return any_ptr_cast<cast_type>(any_, our_cache); \
+  }(any)
+
+// Casts an any_shared_ptr (or a pointer to one) to std::shared_ptr<T> using a cache that's local to the call site
+#define ANY_SHARED_PTR_CAST(T, any) \
+  [](auto const & any_) -> decltype(auto) { \
+    using cast_type = T; \
+    static ::xxx::call_site_cache<cast_type> our_cache; \
+    using namespace ::xxx; \
+    return any_shared_ptr_cast<cast_type>(any_, our_cache); \
+  }(any)
+
+// Borrows the held pointer of an any_shared_ptr (or a pointer to one) as T* using a cache that's local to the call site
+#define ANY_SHARED_PTR_GET(T, any) \
+  [](auto const & any_) -> decltype(auto) { \
+    using cast_type = T; \
+    static ::xxx::call_site_cache<cast_type> our_cache; \
+    using namespace ::xxx; \
+    return any_shared_ptr_get<cast_type>(any_, our_cache); \
+  }(any)
@@ -0,0 +1,387 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <cstddef>
+#include <typeinfo>
+#include <utility>
+#include "up_cast_cache.h"
+#include "call_site_cache.h"
+#include "held_type.h"
+#include "itanium_rtti.h"
+
+namespace xxx {
+
+  namespace detail {
+
+    // Replicate a dynamic up cast by using the try/catch mechanism.
+    // The portable engine that's used when the RTTI layout is unknown.
+    // A successful cast is reported as dynamic_offset as the path to the target is unknown.
+    template<typename U>
+    up_cast_result throw_up_cast(up_cast_func * throw_func, void*& ptr) noexcept
+    {
+      try {
+        throw_func(ptr, typeid(U*));
+      }
+      catch (U* const p) { // up cast succeeded
+        ptr = const_cast<void*>(static_cast<const volatile void*>(p));
+        return up_cast_result::dynamic_offset;
+      }
+      catch (...) { // up cast failed
+      }
+      return up_cast_result::failed;
+    }
+
+    // Run the up cast engine i.e. walk the RTTI or else throw the held pointer.
+    template<typename U>
+    up_cast_result run_up_cast(up_cast_func * up_cast, void*& ptr) noexcept
+    {
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+      return up_cast(ptr, typeid(U*));
+#else
+      return throw_up_cast<U>(up_cast, ptr);
+#endif
+    }
+
+    // Attempt a dynamic up cast to U* of the held pointer 'ptr' where 'held' identifies 
+    // the held type and 'up_cast' is the function returned by up_cast_function<T>().
+    // The outcome is looked up in, or else recorded in, the process-wide up_cast_cache.
+    template<typename U>
+    up_cast_result cached_up_cast(const std::type_info & held, up_cast_func * up_cast, void*& ptr) noexcept
+    {
+      up_cast_cache & cache = up_cast_cache::instance();
+      const std::type_info & target = typeid(U*);
+      std::ptrdiff_t offset{ 0 };
+      const up_cast_result cached = cache.find(held, target, offset);
+      if (cached == up_cast_result::failed) {
+        return cached;
+      }
+      if (cached == up_cast_result::static_offset) {
+        if (ptr != nullptr) {
+          ptr = static_cast<char*>(ptr) + offset;
+        }
+        return cached;
+      }
+      void * const held_ptr = ptr;
+      const up_cast_result result = run_up_cast<U>(up_cast, ptr);
+      // The offset is unknown when casting a nullptr 
+      if (cached == up_cast_result::unknown && (result != up_cast_result::static_offset || held_ptr != nullptr)) {
+        if (result == up_cast_result::static_offset) {
+          offset = static_cast<char*>(ptr) - static_cast<char*>(held_ptr);
+        }
+        cache.insert(held, target, result, offset);
+      }
+      return result;
+    }
+
+    // Attempt an up cast to U* of the held pointer 'ptr' by the held type's table of ancestors (see base_table_function).
+    // Returns unknown if the table can't resolve the up cast.
+    template<typename U>
+    up_cast_result registered_up_cast([[maybe_unused]] const held_type & held, [[maybe_unused]] void*& ptr) noexcept
+    {
+      if constexpr (is_complete_class<std::remove_cv_t<U>>::value) { // only classes are ancestors
+        const ancestor * const base = held.bases().find(typeid(std::remove_cv_t<U>), type_fingerprint_v<std::remove_cv_t<U>>);
+        if (base == nullptr) {
+          return up_cast_result::unknown;
+        }
+        if (!held.is_cv_promotable_to(cv_qualifiers_of<U>())) {
+          return up_cast_result::failed;
+        }
+        return base->up_cast(ptr);
+      }
+      else {
+        return up_cast_result::unknown;
+      }
+    }
+
+    // Returns true if the up cast succeeded. An up cast to an ancestor is resolved by the held 
+    // type's table (see base_table_function), otherwise see cached_up_cast().
+    template<typename U>
+    bool dynamic_up_cast(const held_type & held, void*& ptr) noexcept
+    {
+      if (held.bases != nullptr) {
+        const up_cast_result result = registered_up_cast<U>(held, ptr);
+        if (result != up_cast_result::unknown) {
+          return result != up_cast_result::failed;
+        }
+      }
+      return cached_up_cast<U>(*held.type, held.up_cast, ptr) != up_cast_result::failed;
+    }
+
+    // As above except the outcome is first looked up in, or else recorded in, the call site's cache.
+    template<typename U>
+    bool dynamic_up_cast(const held_type & held, void*& ptr, call_site_cache<U> & site) noexcept
+    {
+      if (held.bases != nullptr) {
+        const up_cast_result result = registered_up_cast<U>(held, ptr);
+        if (result != up_cast_result::unknown) {
+          return result != up_cast_result::failed;
+        }
+      }
+      std::ptrdiff_t offset{ 0 };
+      switch (site.find(*held.type, offset)) {
+      case up_cast_result::failed:
+        return false;
+      case up_cast_result::static_offset:
+        if (ptr != nullptr) {
+          ptr = static_cast<char*>(ptr) + offset;
+        }
+        return true;
+      case up_cast_result::dynamic_offset:
+        return run_up_cast<U>(held.up_cast, ptr) != up_cast_result::failed;
+      default:
+        break;
+      }
+      void * const held_ptr = ptr;
+      const up_cast_result result = cached_up_cast<U>(*held.type, held.up_cast, ptr);
+      // The offset is unknown when casting a nullptr 
+      if (result != up_cast_result::static_offset || held_ptr != nullptr) {
+        site.insert(*held.type, result, static_cast<char*>(ptr) - static_cast<char*>(held_ptr));
+      }
+      return result != up_cast_result::failed;
+    }
+
+    // As dynamic_up_cast() except the held pointer may be the same type as U up to cv-qualifiers and 
+    // the outcome is returned, thus a successful cast is static_offset if the adjustment of 'ptr' only 
+    // depends on the types, otherwise dynamic_offset.
+    template<typename U>
+    up_cast_result resolve_up_cast(const held_type & held, void*& ptr) noexcept
+    {
+      if (held.up_cast == nullptr) { // empty
+        return up_cast_result::failed;
+      }
+      if (is_same_unqualified_type(*held.pointer, held_type_v<U>)) { // same type up to cv-qualifiers
+        return held.is_cv_promotable_to(cv_qualifiers_of<U>()) ? up_cast_result::static_offset : up_cast_result::failed;
+      }
+      if (held.bases != nullptr) {
+        const up_cast_result result = registered_up_cast<U>(held, ptr);
+        if (result != up_cast_result::unknown) {
+          return result;
+        }
+      }
+      return cached_up_cast<U>(*held.type, held.up_cast, ptr);
+    }
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+    // Returns the outcome of an up cast of the most derived object 'most_derived', whose typeid is 'dynamic_type',
+    // to its base 'base' where 'offset' is set to the pointer offset of a static_offset outcome. 
+    // The outcome only depends on the types so it's looked up in, or else recorded in, the up_cast_cache.
+    inline up_cast_result most_derived_up_cast(const std::type_info & dynamic_type, const std::type_info & base, void * most_derived, std::ptrdiff_t & offset) noexcept
+    {
+      up_cast_cache & cache = up_cast_cache::instance();
+      up_cast_result result = cache.find(dynamic_type, base, offset);
+      if (result == up_cast_result::unknown) {
+        void * base_ptr = most_derived;
+        result = itanium::catch_matches(base, dynamic_type, base_ptr, 0);
+        offset = static_cast<char*>(base_ptr) - static_cast<char*>(most_derived);
+        cache.insert(dynamic_type, base, result, offset);
+      }
+      return result;
+    }
+#endif
+
+    // Returns true if the held pointer 'ptr' can be cast to U* with the semantics of dynamic_cast, where 
+    // the held pointer is to a polymorphic class i.e. a down cast, or a cross cast, as [expr.dynamic.cast]/8.
+    // As for dynamic_cast a nullptr is cast to a nullptr.
+    // When the held subobject is an unambiguous public base of the most derived object, and so is U, the 
+    // outcome only depends on the dynamic type and U is found at its offset from the most derived object, 
+    // which is cached in the up_cast_cache. Otherwise, e.g. a private or ambiguous held subobject, or a down 
+    // cast to a U that's ambiguous in the most derived object, the outcome depends on the held subobject 
+    // and so it's resolved by the C++ runtime's __dynamic_cast on every cast.
+    // Requires the RTTI layout (see ANY_PTR_HAS_ITANIUM_RTTI) to resolve a non-null cast otherwise it fails.
+    template<typename U>
+    bool dynamic_cross_cast(const held_type & held, [[maybe_unused]] void*& ptr) noexcept
+    {
+      if constexpr (std::is_class<std::remove_cv_t<U>>::value) {
+        if (held.most_derived == nullptr || !held.is_cv_promotable_to(cv_qualifiers_of<U>())) {
+          return false;
+        }
+        if (ptr == nullptr) {
+          return true;
+        }
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+        const std::type_info * dynamic_type{ nullptr };
+        const std::type_info * static_type{ nullptr };
+        void * const most_derived = held.most_derived(ptr, dynamic_type, static_type);
+        const std::type_info & target = typeid(std::remove_cv_t<U>);
+        std::ptrdiff_t offset{ 0 };
+        if (most_derived_up_cast(*dynamic_type, *static_type, most_derived, offset) != up_cast_result::failed
+          && most_derived_up_cast(*dynamic_type, target, most_derived, offset) == up_cast_result::static_offset) {
+          ptr = static_cast<char*>(most_derived) + offset;
+          return true;
+        }
+        const itanium::class_type_info * const source_class = dynamic_cast<const itanium::class_type_info*>(static_type);
+        const itanium::class_type_info * const target_class = dynamic_cast<const itanium::class_type_info*>(&target);
+        if (source_class == nullptr || target_class == nullptr) {
+          return false;
+        }
+        void * const result = abi::__dynamic_cast(ptr, source_class, target_class, -1); // -1 as there's no hint
+        if (result == nullptr) {
+          return false;
+        }
+        ptr = result;
+        return true;
+#else
+        return false;
+#endif
+      }
+      else {
+        return false;
+      }
+    }
+
+    // The I'th type of Ts...
+    template<std::size_t I, typename T, typename... Ts>
+    struct nth_type { using type = typename nth_type<I - 1, Ts...>::type; };
+
+    template<typename T, typename... Ts>
+    struct nth_type<0, T, Ts...> { using type = T; };
+
+    template<std::size_t I, typename... Ts>
+    using nth_type_t = typename nth_type<I, Ts...>::type;
+
+    // The catch clauses of throw_up_cast_first() where each level catches the target Us[I]* and 
+    // the nested level catches Us[I - 1]*, thus the innermost level, which catches Us[0]*, is tried first.
+    template<std::size_t I, typename... Us>
+    std::size_t catch_up_cast_first(up_cast_func * throw_func, void*& ptr)
+    {
+      using U = nth_type_t<I, Us...>;
+      try {
+        if constexpr (I == 0) {
+          throw_func(ptr, typeid(U*));
+        }
+        else {
+          return catch_up_cast_first<I - 1, Us...>(throw_func, ptr);
+        }
+      }
+      catch (U* const p) { // up cast to Us[I] succeeded
+        ptr = const_cast<void*>(static_cast<const volatile void*>(p));
+        return I;
+      }
+      return sizeof...(Us); // unreachable as throw_func always throws
+    }
+
+    // As throw_up_cast() except the held pointer is thrown once and caught by the first of the 
+    // targets Us... that it can be up cast to. Returns the index of the target, or sizeof...(Us) if there's none.
+    template<typename... Us>
+    std::size_t throw_up_cast_first(up_cast_func * throw_func, void*& ptr) noexcept
+    {
+      try {
+        return catch_up_cast_first<sizeof...(Us) - 1, Us...>(throw_func, ptr);
+      }
+      catch (...) { // up cast failed for every target
+      }
+      return sizeof...(Us);
+    }
+
+    // Run the up cast engine for the targets Us... from the index 'first' onwards. Returns the index of 
+    // the first target that the up cast succeeds for, with its outcome in 'result', or sizeof...(Us) if there's none.
+    template<typename... Us>
+    std::size_t run_up_cast_first(up_cast_func * up_cast, [[maybe_unused]] std::size_t first, void*& ptr, up_cast_result & result) noexcept
+    {
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+      const std::type_info * const targets[] = { &typeid(Us*)... };
+      for (std::size_t i = first; i < sizeof...(Us); ++i) {
+        void * target_ptr = ptr;
+        result = up_cast(target_ptr, *targets[i]);
+        if (result != up_cast_result::failed) {
+          ptr = target_ptr;
+          return i;
+        }
+      }
+      return sizeof...(Us);
+#else // the targets before 'first' are known to fail so a single throw can try them all 
+      result = up_cast_result::dynamic_offset;
+      return throw_up_cast_first<Us...>(up_cast, ptr);
+#endif
+    }
+
+    // Returns the index of the first of the targets Us... that the held pointer 'ptr' can be cast to, with 
+    // 'ptr' adjusted to point to it, or sizeof...(Us) if there's none. The targets are tried in turn by the 
+    // same type test, the held type's table (see base_table_function) and the up_cast_cache, and only the 
+    // remainder from the first target that these can't resolve is passed to a single run of the up cast engine, 
+    // whose outcomes are then recorded in the up_cast_cache. 
+    template<typename... Us>
+    std::size_t dynamic_up_cast_first(const held_type & held, void*& ptr) noexcept
+    {
+      constexpr std::size_t count = sizeof...(Us);
+      if (held.up_cast == nullptr) { // empty
+        return count;
+      }
+      const held_type * const target_types[] = { &held_type_v<Us>... };
+      const std::type_info * const targets[] = { &typeid(Us*)... };
+      up_cast_result(*const registered[])(const held_type &, void*&) noexcept = { &registered_up_cast<Us>... };
+
+      up_cast_cache & cache = up_cast_cache::instance();
+      up_cast_result cached{ up_cast_result::unknown };
+      std::size_t first = 0;
+      for (; first < count; ++first) {
+        if (is_same_unqualified_type(*held.pointer, *target_types[first])) { // same type up to cv-qualifiers
+          if (held.is_cv_promotable_to(target_types[first]->cv)) {
+            return first;
+          }
+          continue; // the cast drops cv-qualifiers
+        }
+        if (held.bases != nullptr) {
+          void * base_ptr = ptr;
+          const up_cast_result result = registered[first](held, base_ptr);
+          if (result == up_cast_result::failed) {
+            continue;
+          }
+          if (result != up_cast_result::unknown) {
+            ptr = base_ptr;
+            return first;
+          }
+        }
+        std::ptrdiff_t offset{ 0 };
+        cached = cache.find(*held.type, *targets[first], offset);
+        if (cached == up_cast_result::failed) {
+          continue;
+        }
+        if (cached == up_cast_result::static_offset) {
+          if (ptr != nullptr) {
+            ptr = static_cast<char*>(ptr) + offset;
+          }
+          return first;
+        }
+        break; // unknown or dynamic_offset thus run the engine
+      }
+      if (first == count) {
+        return count;
+      }
+      void * const held_ptr = ptr;
+      up_cast_result result{ up_cast_result::failed };
+      const std::size_t index = run_up_cast_first<Us...>(held.up_cast, first, ptr, result);
+      if (cached == up_cast_result::unknown) { // record the targets that failed and the one that succeeded
+        for (std::size_t i = first; i < index; ++i) {
+          cache.insert(*held.type, *targets[i], up_cast_result::failed, 0);
+        }
+        // The offset is unknown when casting a nullptr 
+        if (index < count && (result != up_cast_result::static_offset || held_ptr != nullptr)) {
+          cache.insert(*held.type, *targets[index], result, static_cast<char*>(ptr) - static_cast<char*>(held_ptr));
+        }
+      }
+      return index;
+    }
+
+  } // namespace detail
+
+} // namespace xxx
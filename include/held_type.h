@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <typeinfo>
+#include <type_traits>
+#include "any_ptr_bases.h"
+#include "itanium_rtti.h"
+#include "type_fingerprint.h"
+#include "type_registry.h"
+#include "weak_ptr_ops.h"
+
+namespace xxx {
+
+  namespace detail {
+
+    // The cv-qualifiers of a pointee type as a bit mask
+    enum cv_qualifiers : unsigned char
+    {
+      cv_none = 0,
+      cv_const = 1,
+      cv_volatile = 2,
+      cv_const_volatile = cv_const | cv_volatile
+    };
+
+    template<typename T>
+    constexpr cv_qualifiers cv_qualifiers_of() noexcept
+    {
+      return static_cast<cv_qualifiers>((std::is_const<T>::value ? cv_const : cv_none) | (std::is_volatile<T>::value ? cv_volatile : cv_none));
+    }
+
+    // Signature of the per-type function that implements a dynamic up cast of a
+    // held T* to the pointer type 'to' i.e. typeid(U*). On success the adjusted
+    // pointer is returned in 'ptr'.
+    using up_cast_func = up_cast_result(void*& ptr, const std::type_info& to);
+
+    // Throw the held pointer as a T* so that a catch(U*) clause can replicate an
+    // implicit up cast - see throw_up_cast().
+    template<typename T>
+    up_cast_result throw_pointer(void*& ptr, const std::type_info& /*to*/)
+    {
+      throw static_cast<T*>(ptr);
+    }
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+
+    // Resolve the up cast of the pointer 'ptr' of type 'from' i.e. typeid(T*)
+    // to the pointer type 'to' i.e. typeid(U*) by walking the RTTI.
+    // Gives identical results to throwing a T* and catching it as U*.
+    inline up_cast_result rtti_up_cast(const std::type_info & from, const std::type_info & to, void*& ptr) noexcept
+    {
+      return itanium::catch_matches(to, from, ptr, 1);
+    }
+
+    template<typename T>
+    up_cast_result rtti_up_cast_function(void*& ptr, const std::type_info & to) noexcept
+    {
+      return rtti_up_cast(typeid(T*), to, ptr);
+    }
+
+#endif // ANY_PTR_HAS_ITANIUM_RTTI
+
+    // Returns the function that implements a dynamic up cast of a held T*
+    template<typename T>
+    constexpr up_cast_func * up_cast_function() noexcept
+    {
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+      return &rtti_up_cast_function<T>;
+#else
+      return &throw_pointer<T>;
+#endif
+    }
+
+    // Signature of the per-type function that returns the address of the most derived object of a 
+    // held non-null T*, where T is a polymorphic class, and sets 'dynamic_type' to its typeid and 
+    // 'static_type' to typeid(T) without cv-qualifiers.
+    using most_derived_func = void*(void* ptr, const std::type_info *& dynamic_type, const std::type_info *& static_type) noexcept;
+
+    template<typename T>
+    void* held_most_derived(void* ptr, const std::type_info *& dynamic_type, const std::type_info *& static_type) noexcept
+    {
+      T * const p = static_cast<T*>(ptr);
+      dynamic_type = &typeid(*p);
+      static_type = &typeid(std::remove_cv_t<T>);
+      return const_cast<void*>(dynamic_cast<const volatile void*>(p));
+    }
+
+    // Returns the function that locates the most derived object of a held T*, or 
+    // nullptr if T isn't a polymorphic class, or is incomplete
+    template<typename T>
+    constexpr most_derived_func * most_derived_function() noexcept
+    {
+      if constexpr (is_complete_class<std::remove_cv_t<T>>::value) {
+        if constexpr (std::is_polymorphic<T>::value) {
+          return &held_most_derived<T>;
+        }
+      }
+      return nullptr;
+    }
+
+    // Describes the type of a held pointer to T, where 'type' is the typeid of the held pointer 
+    // e.g. typeid(const Derived*) and 'unqualified_type' is the typeid of the held pointer 
+    // after the cv-qualifiers of T are removed e.g. typeid(Derived*).
+    // Thus a cv-qualifier promotion, or a cast that drops cv-qualifiers, is decided by comparing 
+    // the unqualified types and then the cv-qualifiers without resorting to a dynamic up cast.
+    // 'bases' returns the ancestors of T (see base_table_function), or is nullptr if there are none.
+    // 'fingerprint' is the type_fingerprint_v of 'unqualified_type' and 'id' is the type_id_storage_v of 'type'.
+    // 'up_cast' is the function returned by up_cast_function<T>(), or is nullptr for an empty instance.
+    // There's a single static held_type per held pointer type so a handle only needs a pointer to it.
+    struct held_type
+    {
+      const std::type_info *                      type;
+      const std::type_info *                      unqualified_type;
+      cv_qualifiers                               cv;
+      base_table_func *                           bases;
+      const std::uint64_t *                       fingerprint;
+      std::atomic<type_registry::id_type> *       id;
+      up_cast_func *                              up_cast;
+      // The held_type of the pointer T* to the object of the held pointer, e.g. of T* for a 
+      // shared_ptr<T>, which is itself if the held pointer is T*
+      const held_type *                           pointer;
+      // The function returned by most_derived_function<T>() - see dynamic_cross_cast()
+      most_derived_func *                         most_derived;
+      // The operations on a weak_ptr<T> to the object if the held pointer is a shared_ptr<T>, 
+      // otherwise nullptr - see any_weak_ptr
+      const weak_ptr_ops *                        weak_ops;
+
+      // Returns the type_registry ID of 'type', or type_registry::invalid_id if it can't be registered
+      type_registry::id_type type_id() const noexcept
+      {
+        return registered_type_id(*id, *type);
+      }
+
+      // Returns true if the cv-qualifiers of T are a subset of 'target_cv' i.e. a cast 
+      // to the held pointer type with the cv-qualifiers 'target_cv' doesn't drop any.
+      bool is_cv_promotable_to(cv_qualifiers target_cv) const noexcept
+      {
+        return (cv & ~target_cv) == 0;
+      }
+    };
+
+    // The held_type of the held pointer 'Held' to T, where 'Unqualified' is the 
+    // held pointer to std::remove_cv_t<T> e.g. held_type_v<T, std::shared_ptr<T>, std::shared_ptr<std::remove_cv_t<T>>>
+    template<typename T, typename Held = T*, typename Unqualified = std::remove_cv_t<T>*>
+    inline constexpr held_type held_type_v{ &typeid(Held), &typeid(Unqualified), cv_qualifiers_of<T>(), base_table_function<T>(), &type_fingerprint_v<Unqualified>, &type_id_storage_v<Held>, up_cast_function<T>(), &held_type_v<T>, most_derived_function<T>(), weak_ptr_ops_of<Held>::value };
+
+    // The held_type of an empty instance
+    inline constexpr held_type empty_held_type{ &typeid(void), &typeid(void), cv_none, nullptr, &type_fingerprint_v<void>, &type_id_storage_v<void>, nullptr, &empty_held_type, nullptr, nullptr };
+
+    // Returns true if 'held' and 'target' are the same type up to cv-qualifiers. The type_info objects are only 
+    // compared if their addresses and the fingerprints differ e.g. when the same type has a type_info 
+    // in more than one shared library.
+    inline bool is_same_unqualified_type(const held_type & held, const held_type & target) noexcept
+    {
+      return held.unqualified_type == target.unqualified_type ||
+        (!is_different_fingerprint(*held.fingerprint, *target.fingerprint) && *held.unqualified_type == *target.unqualified_type);
+    }
+
+  } // namespace detail
+
+} // namespace xxx
@@ -0,0 +1,238 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <cstddef>
+#include <typeinfo>
+#include "up_cast_cache.h"
+
+// The Itanium C++ ABI (used by GCC and Clang on Linux, macOS, BSD, etc) specifies
+// the layout of the RTTI objects returned by typeid() and thus a dynamic up cast
+// can be resolved by walking the RTTI directly instead of throwing an exception.
+// The RTTI classes are declared by the <cxxabi.h> of libstdc++ (the one of libc++abi only declares 
+// the functions). Define ANY_PTR_DISABLE_RTTI_UP_CAST to always use the portable try/catch engine.
+#if !defined(ANY_PTR_DISABLE_RTTI_UP_CAST) && defined(__GXX_ABI_VERSION) && !defined(_MSC_VER) && defined(__GLIBCXX__)
+  #define ANY_PTR_HAS_ITANIUM_RTTI
+#endif
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+
+#include <cxxabi.h>
+
+namespace xxx {
+
+  namespace detail {
+
+    namespace itanium {
+
+      // The RTTI classes specified by the Itanium C++ ABI, section 2.9.5 "RTTI Layout", as declared by 
+      // the C++ runtime. The class of an RTTI object is found by a dynamic_cast of the type_info.
+      using class_type_info = abi::__class_type_info;
+      using si_class_type_info = abi::__si_class_type_info;
+      using vmi_class_type_info = abi::__vmi_class_type_info;
+      using base_class_type_info = abi::__base_class_type_info;
+      using pbase_type_info = abi::__pbase_type_info;
+      using pointer_to_member_type_info = abi::__pointer_to_member_type_info;
+      using function_type_info = abi::__function_type_info;
+
+      // The state of a search for the subobjects of type 'target'
+      struct up_cast_search
+      {
+        const std::type_info *  target;
+        // A subobject is identified by the nearest virtual base on its path (if any)
+        // and its offset from that virtual base, or else from the most derived object.
+        const std::type_info *  vbase{ nullptr };
+        std::ptrdiff_t          offset{ 0 };
+        // The address of the subobject, nullptr if searching from a nullptr
+        char *                  ptr{ nullptr };
+        bool                    found{ false };
+        bool                    is_public{ false };
+        bool                    is_ambiguous{ false };
+
+        explicit up_cast_search(const std::type_info & target_) noexcept : target{ &target_ } {}
+
+        bool is_same_subobject(const std::type_info * vbase_, std::ptrdiff_t offset_) const noexcept
+        {
+          if (offset != offset_) {
+            return false;
+          }
+          if (vbase == nullptr || vbase_ == nullptr) {
+            return vbase == vbase_;
+          }
+          return *vbase == *vbase_;
+        }
+      };
+
+      // Depth first search of the class 'type' located at 'obj' for subobjects of the target type
+      inline void search_bases(const std::type_info & type, char * const obj, const std::type_info * const vbase,
+                               const std::ptrdiff_t offset, const bool is_public, up_cast_search & search) noexcept
+      {
+        if (type == *search.target) {
+          if (!search.found) {
+            search.found = true;
+            search.vbase = vbase;
+            search.offset = offset;
+            search.ptr = obj;
+            search.is_public = is_public;
+          }
+          else if (search.is_same_subobject(vbase, offset)) { // e.g. a virtual base reached by another path
+            search.is_public = search.is_public || is_public;
+          }
+          else {
+            search.is_ambiguous = true;
+          }
+          return;
+        }
+        if (const si_class_type_info * const si = dynamic_cast<const si_class_type_info*>(&type)) { // a public non-virtual base at offset 0
+          search_bases(*si->__base_type, obj, vbase, offset, is_public, search);
+        }
+        else if (const vmi_class_type_info * const vmi = dynamic_cast<const vmi_class_type_info*>(&type)) {
+          for (unsigned int i = 0; i < vmi->__base_count && !search.is_ambiguous; ++i) {
+            const base_class_type_info & base = vmi->__base_info[i];
+            const bool is_public_base = is_public && base.__is_public_p();
+            if (base.__is_virtual_p()) {
+              char * base_obj = nullptr;
+              if (obj != nullptr) { // the offset of a virtual base is stored in the vtable
+                const char * const vtable = *reinterpret_cast<const char* const*>(obj);
+                base_obj = obj + *reinterpret_cast<const std::ptrdiff_t*>(vtable + base.__offset());
+              }
+              search_bases(*base.__base_type, base_obj, base.__base_type, 0, is_public_base, search);
+            }
+            else {
+              char * const base_obj = obj != nullptr ? obj + base.__offset() : nullptr;
+              search_bases(*base.__base_type, base_obj, vbase, offset + base.__offset(), is_public_base, search);
+            }
+          }
+        }
+        // else no bases
+      }
+
+      // Returns whether a catch clause of type 'target' would catch a thrown 'thrown'
+      // where 'ptr' is the thrown pointer that's adjusted for a derived to base conversion.
+      // Replicates the matching rules of [except.handle] implemented by the C++ runtime
+      // where bit 0 of 'outer' is set if all outer pointers are const qualified and
+      // the remaining bits count the pointer levels (in steps of 2).
+      inline up_cast_result catch_matches(const std::type_info & target, const std::type_info & thrown, void*& ptr, unsigned outer) noexcept
+      {
+        if (target == thrown) {
+          return up_cast_result::static_offset;
+        }
+        if (const pbase_type_info * const target_ptr = dynamic_cast<const pbase_type_info*>(&target)) { // a pointer or pointer to member
+          const pbase_type_info * const thrown_ptr = dynamic_cast<const pbase_type_info*>(&thrown);
+          const pointer_to_member_type_info * const target_ptm = dynamic_cast<const pointer_to_member_type_info*>(target_ptr);
+          const pointer_to_member_type_info * const thrown_ptm = dynamic_cast<const pointer_to_member_type_info*>(thrown_ptr);
+          if (thrown_ptr == nullptr || (target_ptm == nullptr) != (thrown_ptm == nullptr)) { // not the same kind
+            return up_cast_result::failed;
+          }
+          if ((outer & 1) == 0) { // an outer pointer isn't const so the types must be identical
+            return up_cast_result::failed;
+          }
+          unsigned int thrown_flags = thrown_ptr->__flags;
+          const unsigned int fqual_mask = pbase_type_info::__transaction_safe_mask | pbase_type_info::__noexcept_mask;
+          const unsigned int thrown_fqual = thrown_flags & fqual_mask;
+          const unsigned int target_fqual = target_ptr->__flags & fqual_mask;
+          if (thrown_fqual & ~target_fqual) { // a function pointer conversion can drop noexcept
+            thrown_flags &= target_fqual;
+          }
+          if (target_fqual & ~thrown_fqual) { // but can't add it
+            return up_cast_result::failed;
+          }
+          if (thrown_flags & ~target_ptr->__flags) { // can't drop cv-qualifiers
+            return up_cast_result::failed;
+          }
+          if ((target_ptr->__flags & pbase_type_info::__const_mask) == 0) {
+            outer &= ~1u;
+          }
+          if (target_ptm != nullptr) {
+            if (*target_ptm->__context != *thrown_ptm->__context) {
+              return up_cast_result::failed;
+            }
+          }
+          else if (outer < 2 && *target_ptr->__pointee == typeid(void)) { // any object pointer converts to void*
+            return dynamic_cast<const function_type_info*>(thrown_ptr->__pointee) == nullptr ? up_cast_result::static_offset : up_cast_result::failed;
+          }
+          return catch_matches(*target_ptr->__pointee, *thrown_ptr->__pointee, ptr, outer + 2);
+        }
+        if (dynamic_cast<const class_type_info*>(&target) != nullptr) {
+          if (outer >= 4) { // a derived to base conversion is only allowed for the pointee of T*
+            return up_cast_result::failed;
+          }
+          up_cast_search search(target);
+          search_bases(thrown, static_cast<char*>(ptr), nullptr, 0, true, search);
+          if (!search.found || search.is_ambiguous || !search.is_public) {
+            return up_cast_result::failed;
+          }
+          ptr = search.ptr;
+          return search.vbase == nullptr ? up_cast_result::static_offset : up_cast_result::dynamic_offset;
+        }
+        return up_cast_result::failed;
+      }
+
+      // The path from the most derived object to a base class subobject where the subobject is identified as in 
+      // up_cast_search and 'is_public' is true if each base on the path is public. If 'vbase' is the only virtual base 
+      // on the path then its offset is stored at 'vtable_offset' in the vtable of the subobject at 'vbase_path', 
+      // i.e. its derived class, otherwise 'vtable_offset' is 0.
+      struct base_path
+      {
+        const std::type_info *  vbase{ nullptr };
+        std::ptrdiff_t          offset{ 0 };
+        bool                    is_public{ true };
+        std::ptrdiff_t          vbase_path{ 0 };
+        std::ptrdiff_t          vtable_offset{ 0 };
+      };
+
+      // Calls 'visit(base, path)' for each base class subobject of the class 'type' at 'path' in depth first order
+      template<typename Visit>
+      void for_each_base(const std::type_info & type, const base_path & path, Visit & visit)
+      {
+        if (const si_class_type_info * const si = dynamic_cast<const si_class_type_info*>(&type)) {
+          const std::type_info & base = *si->__base_type;
+          visit(base, path);
+          for_each_base(base, path, visit);
+        }
+        else if (const vmi_class_type_info * const vmi = dynamic_cast<const vmi_class_type_info*>(&type)) {
+          for (unsigned int i = 0; i < vmi->__base_count; ++i) {
+            const base_class_type_info & base = vmi->__base_info[i];
+            base_path base_path_{ path };
+            base_path_.is_public = path.is_public && base.__is_public_p();
+            if (base.__is_virtual_p()) {
+              base_path_.vbase = base.__base_type;
+              base_path_.offset = 0;
+              base_path_.vbase_path = path.offset;
+              base_path_.vtable_offset = path.vbase == nullptr ? base.__offset() : 0;
+            }
+            else {
+              base_path_.offset = path.offset + base.__offset();
+            }
+            visit(*base.__base_type, base_path_);
+            for_each_base(*base.__base_type, base_path_, visit);
+          }
+        }
+        // else no bases
+      }
+
+    } // namespace itanium
+
+  } // namespace detail
+
+} // namespace xxx
+
+#endif // ANY_PTR_HAS_ITANIUM_RTTI
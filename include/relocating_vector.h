@@ -0,0 +1,261 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+#include "any_shared_ptr.h"
+#include "trivially_relocatable.h"
+
+namespace xxx {
+
+  /**
+    The class relocating_vector is a minimal std::vector for trivially relocatable types 
+    (see is_trivially_relocatable) that relocates its elements with memcpy/memmove when it 
+    grows, or when an element is erased, rather than running a move constructor (or a move 
+    assignment) and a destructor per element.
+
+    E.g. growing a std::vector<v2::any_shared_ptr> moves each handle to the new storage and 
+    then destroys the moved from handle, whereas a relocating_vector<v2::any_shared_ptr> 
+    copies the bytes of all the handles with a single memcpy.
+
+    It provides the basic guarantee if the copy constructor of T throws.
+  */
+  template<typename T>
+  class relocating_vector
+  {
+    static_assert(is_trivially_relocatable<T>::value, "relocating_vector requires a trivially relocatable type - see is_trivially_relocatable");
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "relocating_vector doesn't support over-aligned types");
+
+  public:
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    //-----------------------------------------------------
+    // Canonical "Rule of 5" ctors, dtor and copy operators
+
+    ~relocating_vector() 
+    { 
+      clear();
+      ::operator delete(my_begin);
+    }
+
+    // Delegates to the default constructor so that the destructor releases the copies 
+    // made so far if the copy constructor of T throws
+    relocating_vector(relocating_vector const & other)
+      : relocating_vector()
+    {
+      reserve(other.size());
+      for (const T & value : other) {
+        emplace_back(value);
+      }
+    }
+
+    relocating_vector(relocating_vector && other) noexcept
+      : my_begin{ std::exchange(other.my_begin, nullptr) }
+      , my_end{ std::exchange(other.my_end, nullptr) }
+      , my_capacity{ std::exchange(other.my_capacity, nullptr) }
+    {
+    }
+
+    relocating_vector& operator=(relocating_vector const & other)
+    {
+      relocating_vector{ other }.swap(*this);
+      return *this;
+    }
+
+    relocating_vector& operator=(relocating_vector && other) noexcept
+    {
+      relocating_vector{ std::move(other) }.swap(*this);
+      return *this;
+    }
+
+    //-----------------------------------------------------
+    // Constructors
+
+    relocating_vector() noexcept = default;
+
+    //-----------------------------------------------------
+    // Element access
+
+    T & operator[](size_type index) noexcept { assert(index < size()); return my_begin[index]; }
+    const T & operator[](size_type index) const noexcept { assert(index < size()); return my_begin[index]; }
+
+    T & front() noexcept { return (*this)[0]; }
+    const T & front() const noexcept { return (*this)[0]; }
+
+    T & back() noexcept { return (*this)[size() - 1]; }
+    const T & back() const noexcept { return (*this)[size() - 1]; }
+
+    T * data() noexcept { return my_begin; }
+    const T * data() const noexcept { return my_begin; }
+
+    //-----------------------------------------------------
+    // Iterators
+
+    iterator begin() noexcept { return my_begin; }
+    const_iterator begin() const noexcept { return my_begin; }
+    iterator end() noexcept { return my_end; }
+    const_iterator end() const noexcept { return my_end; }
+
+    //-----------------------------------------------------
+    // Capacity
+
+    bool empty() const noexcept { return my_begin == my_end; }
+    size_type size() const noexcept { return static_cast<size_type>(my_end - my_begin); }
+    size_type capacity() const noexcept { return static_cast<size_type>(my_capacity - my_begin); }
+
+    // Increases the capacity to at least 'new_capacity' by relocating the elements
+    void reserve(size_type new_capacity)
+    {
+      if (new_capacity > capacity()) {
+        T * const new_begin = allocate(new_capacity);
+        relocate(new_begin, new_capacity);
+      }
+    }
+
+    //-----------------------------------------------------
+    // Modifiers
+
+    template<typename... Args>
+    T & emplace_back(Args&&... args)
+    {
+      if (my_end == my_capacity) {
+        // The new element is constructed before the elements are relocated as 'args' may refer to an element
+        const size_type new_capacity = std::max<size_type>(2 * capacity(), 1);
+        T * const new_begin = allocate(new_capacity);
+        try {
+          ::new (static_cast<void*>(new_begin + size())) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+          ::operator delete(new_begin);
+          throw;
+        }
+        relocate(new_begin, new_capacity);
+      }
+      else {
+        ::new (static_cast<void*>(my_end)) T(std::forward<Args>(args)...);
+      }
+      return *my_end++;
+    }
+
+    void push_back(T const & value) { emplace_back(value); }
+
+    void push_back(T && value) { emplace_back(std::move(value)); }
+
+    void pop_back() noexcept
+    {
+      assert(!empty());
+      (--my_end)->~T();
+    }
+
+    // Erases the elements in [first, last) and relocates the elements after them
+    iterator erase(const_iterator first, const_iterator last) noexcept
+    {
+      T * const begin = const_cast<T*>(first);
+      T * const end = const_cast<T*>(last);
+      if (begin == end) {
+        return begin;
+      }
+      for (T * p = begin; p != end; ++p) {
+        p->~T();
+      }
+      std::memmove(static_cast<void*>(begin), static_cast<const void*>(end), static_cast<size_type>(my_end - end) * sizeof(T));
+      my_end -= end - begin;
+      return begin;
+    }
+
+    iterator erase(const_iterator position) noexcept { return erase(position, position + 1); }
+
+    void clear() noexcept
+    {
+      for (T * p = my_begin; p != my_end; ++p) {
+        p->~T();
+      }
+      my_end = my_begin;
+    }
+
+    void swap(relocating_vector & other) noexcept
+    {
+      std::swap(my_begin, other.my_begin);
+      std::swap(my_end, other.my_end);
+      std::swap(my_capacity, other.my_capacity);
+    }
+
+  private:
+
+    T *   my_begin{ nullptr };
+    T *   my_end{ nullptr };
+    T *   my_capacity{ nullptr };
+
+    static T * allocate(size_type capacity)
+    {
+      return static_cast<T*>(::operator new(capacity * sizeof(T)));
+    }
+
+    // Relocates the elements to 'new_begin' that has a capacity of 'new_capacity' elements
+    void relocate(T * new_begin, size_type new_capacity) noexcept
+    {
+      const size_type count = size();
+      if (count != 0) {
+        std::memcpy(static_cast<void*>(new_begin), static_cast<const void*>(my_begin), count * sizeof(T));
+      }
+      ::operator delete(my_begin);
+      my_begin = new_begin;
+      my_end = new_begin + count;
+      my_capacity = new_begin + new_capacity;
+    }
+  };
+
+  inline namespace v1 {
+
+    // A vector of any_shared_ptr that relocates the handles with memcpy
+    using any_shared_ptr_vector = relocating_vector<any_shared_ptr>;
+
+  } // namespace v1
+
+  namespace v2 {
+
+    // A vector of any_shared_ptr that relocates the handles with memcpy
+    using any_shared_ptr_vector = relocating_vector<any_shared_ptr>;
+
+  } // namespace v2
+
+  namespace v3 {
+
+    // A vector of any_shared_ptr that relocates the handles with memcpy
+    using any_shared_ptr_vector = relocating_vector<any_shared_ptr>;
+
+  } // namespace v3
+
+} // namespace xxx
@@ -0,0 +1,411 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <typeinfo>
+#include "any_ptr.h"
+#include "trivially_relocatable.h"
+#ifdef _MSC_VER
+  #if _HAS_CXX17 != 0
+    #include <optional>
+    #define TAGGED_ANY_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#else
+  #if __has_include(<optional>) // requires GCC 5 or greater
+    #include <optional>
+    #define TAGGED_ANY_PTR_HAS_LIB_OPTIONAL 
+  #else
+    #include <experimental/optional>
+    namespace std {
+      using std::experimental::optional;
+    } // namespace std
+    #define TAGGED_ANY_PTR_HAS_LIB_OPTIONAL 
+  #endif
+#endif
+
+namespace xxx {
+
+  // Thrown when the heap address of a boxed tagged_any_ptr doesn't fit in the bits that a 
+  // tagged_any_ptr packs a pointer into e.g. a heap with hardware memory tags or 5-level paging
+  class bad_tagged_any_ptr_box : public std::bad_alloc
+  {
+  public:
+    virtual const char* what() const noexcept override { return "tagged_any_ptr box doesn't fit in 48 bits"; }
+  };
+
+  namespace detail {
+
+    /**
+      The class tagged_type_table maps the 16-bit tags of tagged_any_ptr to held types.
+      The tag of a held type is its type_registry ID plus 1 so that a tag of 0 is an 
+      empty instance, and the tag boxed_tag is an instance that holds an any_ptr on the heap.
+      Tags are lock-free to look up and assign.
+    */
+    class tagged_type_table
+    {
+    public:
+
+      using tag_type = std::uint16_t;
+
+      // The tag of an instance whose held type has no tag or whose pointer doesn't fit in tag_shift bits
+      static constexpr tag_type boxed_tag = 0xFFFF;
+
+      // The number of low bits that hold the pointer, i.e. a canonical x86-64 or AArch64 user space address
+      static constexpr unsigned tag_shift = 48;
+
+      tagged_type_table(tagged_type_table const &) = delete;
+      tagged_type_table& operator=(tagged_type_table const &) = delete;
+
+      // Returns true if the type with the type_registry ID 'id' has a tag i.e. the tags 
+      // aren't exhausted and it isn't type_registry::invalid_id
+      static constexpr bool has_tag(type_registry::id_type id) noexcept
+      {
+        return id < boxed_tag - 1u;
+      }
+
+      // Returns the tag of 'held', or boxed_tag if the tags are exhausted
+      static tag_type tag_of(const held_type & held) noexcept
+      {
+        const type_registry::id_type id = held.type_id();
+        if (!has_tag(id)) {
+          return boxed_tag;
+        }
+        std::atomic<const held_type*> & slot = instance().slot_of(id);
+        if (slot.load(std::memory_order_acquire) == nullptr) {
+          // The first held_type of a type wins - any other is the same type e.g. from another shared library
+          const held_type * expected{ nullptr };
+          slot.compare_exchange_strong(expected, &held, std::memory_order_release, std::memory_order_acquire);
+        }
+        return static_cast<tag_type>(id + 1);
+      }
+
+      // Returns the bits of an instance that holds the any_ptr on the heap at 'box', or throws 
+      // bad_tagged_any_ptr_box if the address doesn't fit in tag_shift bits
+      static std::uint64_t boxed_bits(const void * box)
+      {
+        const std::uint64_t bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(box));
+        if ((bits >> tag_shift) != 0) {
+          throw bad_tagged_any_ptr_box();
+        }
+        return (std::uint64_t{ boxed_tag } << tag_shift) | bits;
+      }
+
+      // Returns the held type of the tag 'tag' that's been returned by tag_of()
+      static const held_type & held_type_of(tag_type tag) noexcept
+      {
+        const type_registry::id_type id = tag - 1u;
+        return *instance().my_chunks[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size].load(std::memory_order_acquire);
+      }
+
+    private:
+
+      static constexpr std::size_t chunk_size = 1024;
+
+      // The held types are stored in chunks that are allocated on demand and never moved
+      std::atomic<std::atomic<const held_type*>*>   my_chunks[(boxed_tag + chunk_size - 1) / chunk_size]{};
+
+      tagged_type_table() = default;
+
+      // Returns the instance that's never destroyed so that it's safe to use during static destruction
+      static tagged_type_table & instance() noexcept
+      {
+        static tagged_type_table * const our_instance = new tagged_type_table;
+        return *our_instance;
+      }
+
+      std::atomic<const held_type*> & slot_of(type_registry::id_type id) noexcept
+      {
+        std::atomic<std::atomic<const held_type*>*> & chunk = my_chunks[id / chunk_size];
+        std::atomic<const held_type*> * slots = chunk.load(std::memory_order_acquire);
+        if (slots == nullptr) {
+          std::atomic<const held_type*> * const new_slots = new std::atomic<const held_type*>[chunk_size]{};
+          if (chunk.compare_exchange_strong(slots, new_slots, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            slots = new_slots;
+          }
+          else { // another thread allocated the chunk
+            delete[] new_slots;
+          }
+        }
+        return slots[id % chunk_size];
+      }
+    };
+
+  } // namespace detail
+
+  inline namespace v1 {
+
+    /**
+      The class tagged_any_ptr is an any_ptr that's the size of a single 64-bit word, for
+      very large arrays of heterogeneous pointers. The held type is packed as a 16-bit tag 
+      into the upper bits of the held pointer, which are unused by canonical x86-64 and 
+      AArch64 user space addresses. It supports the same casts as any_ptr, i.e. a cast to the 
+      held type, cv-qualifier promotion and dynamic up cast:
+
+        std::vector<xxx::tagged_any_ptr> index;
+        index.emplace_back( new Derived );
+        xxx::any_ptr_cast<Base>( index.back() ); // implicit up cast succeeds
+
+      It falls back to holding an any_ptr on the heap when the held pointer doesn't fit in 
+      48 bits, e.g. a pointer with a hardware memory tag, or when more than 65534 types are 
+      registered with the type_registry. Thus, unlike any_ptr, it's not trivially copyable.
+      The address of the heap any_ptr must itself fit in 48 bits, otherwise a constructor or 
+      copy that boxes throws bad_tagged_any_ptr_box.
+    */
+    class tagged_any_ptr
+    {
+    public:
+      //-----------------------------------------------------
+      // Canonical "Rule of 5" ctors, dtor and copy operators
+
+      ~tagged_any_ptr()
+      {
+        if (is_boxed()) {
+          delete box();
+        }
+      }
+
+      tagged_any_ptr(tagged_any_ptr const & other)
+        : my_bits{ other.is_boxed() ? make_boxed_bits(*other.box()) : other.my_bits }
+      {
+      }
+
+      tagged_any_ptr(tagged_any_ptr && other) noexcept
+        : my_bits{ std::exchange(other.my_bits, 0) }
+      {
+      }
+
+      tagged_any_ptr& operator=(tagged_any_ptr const & other)
+      {
+        tagged_any_ptr{ other }.swap(*this);
+        return *this;
+      }
+
+      tagged_any_ptr& operator=(tagged_any_ptr && other) noexcept
+      {
+        tagged_any_ptr{ std::move(other) }.swap(*this);
+        return *this;
+      }
+
+      //-----------------------------------------------------
+      // Constructors
+
+      // set to empty state
+      tagged_any_ptr() noexcept = default;
+
+      template<typename T>
+      tagged_any_ptr(T* ptr)
+        : my_bits{ make_bits(detail::held_type_v<T>, const_cast<std::remove_cv_t<T>*>(ptr)) }
+      {
+      }
+
+      explicit tagged_any_ptr(any_ptr const & ptr)
+        : my_bits{ ptr.has_value() ? make_bits(*ptr.my_held_type, ptr.my_ptr) : 0 }
+      {
+      }
+
+      //-----------------------------------------------------
+      // Modifiers
+
+      // Reset to empty state 
+      void reset() noexcept
+      {
+        *this = tagged_any_ptr();
+      }
+
+      // Swaps two tagged_any_ptr objects
+      void swap(tagged_any_ptr & other) noexcept
+      {
+        std::swap(my_bits, other.my_bits);
+      }
+
+      //-----------------------------------------------------
+      // Observers
+
+      // Returns true if instance is non-empty.
+      bool has_value() const noexcept { return my_bits != 0; }
+
+      // Returns the typeid(T*) of the contained pointer T* if instance is non-empty,
+      // otherwise typeid(void).
+      const std::type_info& type() const noexcept { return *held().type; }
+
+      // Returns the type_registry ID of type()
+      type_registry::id_type type_id() const noexcept { return held().type_id(); }
+
+      // Returns the held pointer as an any_ptr.
+      any_ptr get() const noexcept
+      {
+        if (is_boxed()) {
+          return *box();
+        }
+        any_ptr result;
+        result.my_held_type = &held();
+        result.my_ptr = pointer();
+        return result;
+      }
+
+    private:
+
+      using tag_type = detail::tagged_type_table::tag_type;
+
+      static constexpr unsigned      tag_shift = detail::tagged_type_table::tag_shift;
+      static constexpr std::uint64_t pointer_mask = (std::uint64_t{ 1 } << tag_shift) - 1;
+
+      // The tag of the held type in the upper 16 bits (see tagged_type_table) and 
+      // the held pointer in the lower 48 bits, or else 0 to indicate an empty state.
+      // If the tag is boxed_tag then the lower bits point to an any_ptr on the heap.
+      std::uint64_t   my_bits{ 0 };
+
+      static std::uint64_t bits_of(const void * ptr) noexcept
+      {
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ptr));
+      }
+
+      // Throws bad_tagged_any_ptr_box if the box's address doesn't fit in tag_shift bits
+      static std::uint64_t make_boxed_bits(const any_ptr & ptr)
+      {
+        std::unique_ptr<any_ptr> boxed{ new any_ptr{ ptr } };
+        const std::uint64_t bits = detail::tagged_type_table::boxed_bits(boxed.get());
+        boxed.release();
+        return bits;
+      }
+
+      static std::uint64_t make_bits(const detail::held_type & held, void * ptr)
+      {
+        const tag_type tag = detail::tagged_type_table::tag_of(held);
+        if (tag == detail::tagged_type_table::boxed_tag || (bits_of(ptr) & ~pointer_mask) != 0) {
+          any_ptr boxed;
+          boxed.my_held_type = &held;
+          boxed.my_ptr = ptr;
+          return make_boxed_bits(boxed);
+        }
+        return (std::uint64_t{ tag } << tag_shift) | bits_of(ptr);
+      }
+
+      tag_type tag() const noexcept { return static_cast<tag_type>(my_bits >> tag_shift); }
+
+      bool is_boxed() const noexcept { return tag() == detail::tagged_type_table::boxed_tag; }
+
+      void * pointer() const noexcept { return reinterpret_cast<void*>(static_cast<std::uintptr_t>(my_bits & pointer_mask)); }
+
+      const any_ptr * box() const noexcept { return static_cast<const any_ptr*>(pointer()); }
+
+      const detail::held_type & held() const noexcept
+      {
+        if (!has_value()) {
+          return detail::empty_held_type;
+        }
+        return is_boxed() ? *box()->my_held_type : detail::tagged_type_table::held_type_of(tag());
+      }
+
+      // Attempt a dynamic up cast to T to replicate an implicit up cast. 
+      // If the cast is successful then return { ptr , true } where ptr is the casted pointer
+      // otherwise return { nullptr , false }.
+      template <typename T>
+      std::pair<T*, bool> dynamic_up_cast() const noexcept
+      {
+        // The tag of T if it has one, which can't be the tag of an empty or boxed instance
+        const type_registry::id_type target_id = detail::held_type_v<T>.type_id();
+        if (detail::tagged_type_table::has_tag(target_id) && tag() == target_id + 1u) { // the held type
+          return { static_cast<T*>(pointer()), true };
+        }
+        return get().template dynamic_up_cast<T>();
+      }
+
+#ifdef TAGGED_ANY_PTR_HAS_LIB_OPTIONAL
+
+      template<typename T>
+      friend std::optional<T*> any_ptr_cast(tagged_any_ptr const * any_ptr_) noexcept;
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+      template<typename T>
+      friend std::pair<T*, bool> any_ptr_cast(const tagged_any_ptr * any_ptr_) noexcept;
+
+#endif
+
+      template<typename T>
+      friend T* any_ptr_cast(tagged_any_ptr const & any_ptr_);
+    };
+
+    static_assert(sizeof(tagged_any_ptr) == 8, "tagged_any_ptr should be the size of a 64-bit word");
+
+    //-----------------------------------------------------------------------------------------------------
+
+
+#ifdef TAGGED_ANY_PTR_HAS_LIB_OPTIONAL
+
+    template<typename T>
+    std::optional<T*> any_ptr_cast(const tagged_any_ptr * any_ptr_) noexcept
+    {
+      std::optional<T*> result;
+      const std::pair<T*, bool> cast_result = any_ptr_->template dynamic_up_cast<T>();
+      if (cast_result.second) {
+        result = cast_result.first;
+      }
+      return result;
+    }
+
+#else // replace std::optional<T*> with std::pair<T*, bool>
+
+    template<typename T>
+    std::pair<T*, bool> any_ptr_cast(const tagged_any_ptr * any_ptr_) noexcept
+    {
+      return any_ptr_->template dynamic_up_cast<T>();
+    }
+
+#endif
+
+    template<typename T>
+    T* any_ptr_cast(tagged_any_ptr const & any_ptr_)
+    {
+      const std::pair<T*, bool> result = any_ptr_.template dynamic_up_cast<T>();
+      if (result.second) {
+        return result.first;
+      }
+      throw bad_any_ptr_cast();
+    }
+
+  } // namespace v1
+
+  // A boxed any_ptr is owned through a pointer, so it's relocated by copying the bits - see is_trivially_relocatable
+  template<> struct is_trivially_relocatable<tagged_any_ptr> : std::true_type {};
+
+} // namespace xxx
+
+
+namespace std {
+
+  inline void swap(xxx::tagged_any_ptr & lhs, xxx::tagged_any_ptr & rhs)
+  {
+    lhs.swap(rhs);
+  }
+
+} // namespace std
+
+#ifdef TAGGED_ANY_PTR_HAS_LIB_OPTIONAL 
+#undef TAGGED_ANY_PTR_HAS_LIB_OPTIONAL 
+#endif
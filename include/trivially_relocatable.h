@@ -0,0 +1,45 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <type_traits>
+
+namespace xxx {
+
+  /**
+    The trait is_trivially_relocatable<T> is true if an object of type T can be relocated, i.e. 
+    moved to a new address and the original destroyed, by copying its bytes with memcpy and 
+    not running the destructor of the original. So a container of T can grow, or erase, 
+    without running a move constructor and a destructor per element - see relocating_vector.
+
+    It's true for trivially copyable types and is specialised for the handle types of the 
+    library, i.e. caching_any_ptr, tagged_any_ptr and every version of any_shared_ptr, none 
+    of which holds a pointer into itself. A user type can also specialise it, e.g. 
+
+      template<> struct xxx::is_trivially_relocatable<Widget> : std::true_type {};
+  */
+  template<typename T>
+  struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+  template<typename T>
+  inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+} // namespace xxx
@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <cstdint>
+#include <typeinfo>
+
+namespace xxx {
+
+  namespace detail {
+
+    // Returns the 64-bit FNV-1a hash of the name of 'type' e.g. its mangled name on the Itanium C++ ABI. 
+    // The hash is never 0 so that 0 can stand for a fingerprint that's unknown.
+    inline std::uint64_t fingerprint_of(const std::type_info & type) noexcept
+    {
+      std::uint64_t hash{ 14695981039346656037ull };
+      for (const char * name = type.name(); *name != '\0'; ++name) {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+      }
+      return hash != 0 ? hash : 1;
+    }
+
+    // The fingerprint of T that's computed once per type. Unlike the address of typeid(T) it's the same 
+    // in every shared library, so different fingerprints imply different types without comparing the 
+    // type_info objects, e.g. by strcmp of the mangled names when their addresses differ. The same 
+    // fingerprint doesn't imply the same type. It's 0 until initialised, so beware of static initialisation order.
+    template<typename T>
+    inline const std::uint64_t type_fingerprint_v = fingerprint_of(typeid(T));
+
+    // Returns true if the fingerprints 'lhs' and 'rhs' are of different types
+    constexpr bool is_different_fingerprint(std::uint64_t lhs, std::uint64_t rhs) noexcept
+    {
+      return lhs != rhs && lhs != 0 && rhs != 0;
+    }
+
+  } // namespace detail
+
+} // namespace xxx
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <typeinfo>
+#include <unordered_map>
+#include "type_fingerprint.h"
+
+namespace xxx {
+
+  /**
+    The class type_registry assigns each type a dense ID, i.e. 0, 1, 2, ... in the order that 
+    the types are first used, that's stable for the lifetime of the process. So a table 
+    that's indexed by type can be a flat array rather than a hash table keyed by type_info.
+
+    A type has the same ID in every shared library, even if it has more than one type_info object.
+    Distinct types have distinct IDs.
+
+    The ID of a type known at compile time is returned by type_id<T>(), which after the first 
+    call is a relaxed atomic load. The registry is safe to use during static initialisation 
+    and destruction. The noexcept lookups return invalid_id for a type that can't be 
+    registered i.e. when the registry is full or out of memory.
+  */
+  class type_registry
+  {
+  public:
+
+    using id_type = std::uint32_t;
+
+    // The maximum number of types
+    static constexpr std::size_t max_size = std::size_t{ 1 } << 20;
+
+    // The ID returned by try_id_of() for a type that can't be registered, which is never assigned
+    static constexpr id_type invalid_id = std::numeric_limits<id_type>::max();
+
+    type_registry(type_registry const &) = delete;
+    type_registry& operator=(type_registry const &) = delete;
+
+    // Returns the ID of 'type', assigning the next ID on its first use.
+    // Throws std::length_error if more than max_size types are registered.
+    static id_type id_of(const std::type_info & type)
+    {
+      return instance().register_type(type);
+    }
+
+    // As id_of() except it returns invalid_id if 'type' can't be registered
+    static id_type try_id_of(const std::type_info & type) noexcept
+    {
+      try {
+        return id_of(type);
+      }
+      catch (...) { // the registry is full or out of memory
+        return invalid_id;
+      }
+    }
+
+    // Returns the number of IDs that are assigned
+    static std::size_t size() noexcept
+    {
+      return instance().my_size.load(std::memory_order_acquire);
+    }
+
+    // Returns the type with the ID 'id', or nullptr if 'id' isn't assigned
+    static const std::type_info * type_of(id_type id) noexcept
+    {
+      const type_registry & registry = instance();
+      if (id >= registry.my_size.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      return registry.my_chunks[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size];
+    }
+
+  private:
+
+    static constexpr std::size_t chunk_size = 1024;
+
+    // The types are stored in chunks that are never moved so that type_of() is lock-free
+    std::atomic<const std::type_info**>                 my_chunks[max_size / chunk_size]{};
+    std::atomic<std::size_t>                            my_size{ 0 };
+    // The IDs of the registered types keyed by their fingerprints
+    std::unordered_multimap<std::uint64_t, id_type>     my_ids;
+    std::mutex                                          my_mutex;
+
+    type_registry() = default;
+
+    // Returns the instance that's never destroyed so that it's safe to use during static destruction
+    static type_registry & instance() noexcept
+    {
+      static type_registry * const our_instance = new type_registry;
+      return *our_instance;
+    }
+
+    id_type register_type(const std::type_info & type)
+    {
+      const std::uint64_t fingerprint = detail::fingerprint_of(type);
+      const std::lock_guard<std::mutex> lock{ my_mutex };
+      const auto range = my_ids.equal_range(fingerprint);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (*type_of(it->second) == type) {
+          return it->second;
+        }
+      }
+      const std::size_t id = my_size.load(std::memory_order_relaxed);
+      if (id == max_size) {
+        throw std::length_error("type_registry is full");
+      }
+      // A chunk that's allocated by a registration that then failed is reused
+      if (id % chunk_size == 0 && my_chunks[id / chunk_size].load(std::memory_order_relaxed) == nullptr) {
+        my_chunks[id / chunk_size].store(new const std::type_info*[chunk_size], std::memory_order_release);
+      }
+      my_chunks[id / chunk_size].load(std::memory_order_relaxed)[id % chunk_size] = &type;
+      my_ids.emplace(fingerprint, static_cast<id_type>(id));
+      my_size.store(id + 1, std::memory_order_release);
+      return static_cast<id_type>(id);
+    }
+  };
+
+  namespace detail {
+
+    // The ID of T plus 1, or 0 if it's yet to be assigned. It's constant initialised 
+    // so it's safe to use during static initialisation.
+    template<typename T>
+    inline std::atomic<type_registry::id_type> type_id_storage_v{ 0 };
+
+    // Returns the ID of 'type' where 'storage' is its type_id_storage_v, or type_registry::invalid_id 
+    // if it can't be registered, in which case the registration is tried again by the next call
+    inline type_registry::id_type registered_type_id(std::atomic<type_registry::id_type> & storage, const std::type_info & type) noexcept
+    {
+      const type_registry::id_type id = storage.load(std::memory_order_relaxed);
+      if (id != 0) {
+        return id - 1;
+      }
+      const type_registry::id_type new_id = type_registry::try_id_of(type);
+      if (new_id != type_registry::invalid_id) {
+        storage.store(new_id + 1, std::memory_order_relaxed);
+      }
+      return new_id;
+    }
+
+  } // namespace detail
+
+  // Returns the ID of T assigned by the type_registry, or type_registry::invalid_id if it can't be registered
+  template<typename T>
+  type_registry::id_type type_id() noexcept
+  {
+    return detail::registered_type_id(detail::type_id_storage_v<T>, typeid(T));
+  }
+
+} // namespace xxx
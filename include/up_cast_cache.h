@@ -0,0 +1,330 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+
+namespace xxx {
+
+  // The outcome of a dynamic up cast from a held pointer type to a target pointer type
+  enum class up_cast_result : unsigned char
+  {
+    unknown,        // not resolved e.g. not found in the cache
+    failed,         // the target isn't an unambiguous public base or the cv-qualifiers are dropped
+    static_offset,  // succeeded and the pointer is adjusted by an offset that only depends on the types
+    dynamic_offset  // succeeded but the adjustment depends on the object e.g. the path contains a virtual base
+  };
+
+  /**
+    The class up_cast_cache is a concurrent cache of the outcome of the dynamic up casts
+    performed by any_ptr and any_shared_ptr that's keyed by the (held type, target type) pair.
+    The process-wide instance is shared by all threads.
+
+    An entry records either that the cast fails or that it succeeds with a constant
+    pointer offset so that a repeated cast doesn't walk the RTTI or throw an exception.
+    An up cast through a virtual base is recorded as dynamic_offset as the offset depends
+    on the most derived object and thus can't be cached.
+
+    Lookups are wait-free - a lookup that races with an update of the same entry 
+    is counted as a miss rather than waiting for the update to complete. 
+    The hits and misses are counted per thread, so a lookup only writes to a 
+    cache line of its own thread, and are summed by stats().
+    The cache is a fixed size set-associative table that's bounded by max_bytes 
+    where a full set evicts an entry at random.
+  */
+  class up_cast_cache
+  {
+  public:
+
+    struct statistics
+    {
+      std::uint64_t hits;
+      std::uint64_t misses;
+      std::uint64_t evictions;
+      // The number of entries
+      std::size_t   capacity;
+      // The memory used by the entries
+      std::size_t   size_in_bytes;
+    };
+
+    static constexpr std::size_t default_max_bytes = 32 * 1024;
+
+    //-----------------------------------------------------
+    // ctors/dtor
+
+    explicit up_cast_cache(std::size_t max_bytes = default_max_bytes)
+      : my_capacity{ capacity_for(max_bytes) }
+      , my_entries{ new entry[my_capacity] }
+    {
+    }
+
+    ~up_cast_cache()
+    {
+      for (counters * c = my_counters.load(std::memory_order_acquire); c != nullptr; ) {
+        delete std::exchange(c, c->next);
+      }
+    }
+
+    up_cast_cache(up_cast_cache const &) = delete;
+    up_cast_cache& operator=(up_cast_cache const &) = delete;
+
+    //-----------------------------------------------------
+    // Process-wide instance
+
+    // Returns the instance shared by any_ptr and any_shared_ptr.
+    // It's never destroyed so that it's safe to use during static destruction.
+    static up_cast_cache & instance() noexcept
+    {
+      static up_cast_cache * const our_instance = new up_cast_cache{ (is_instantiated().store(true), max_bytes_config().load()) };
+      return *our_instance;
+    }
+
+    // Sets the memory bound of the process-wide instance.
+    // Returns false if the instance is already in use and therefore has a fixed size.
+    static bool set_max_bytes(std::size_t max_bytes) noexcept
+    {
+      if (is_instantiated().load()) {
+        return false;
+      }
+      max_bytes_config().store(max_bytes);
+      return !is_instantiated().load();
+    }
+
+    //-----------------------------------------------------
+    // Lookup and update
+
+    // Returns the cached outcome of casting the held type to the target type where 
+    // 'offset' is set to the pointer offset of a static_offset outcome, 
+    // otherwise returns up_cast_result::unknown. 
+    up_cast_result find(const std::type_info & held, const std::type_info & target, std::ptrdiff_t & offset) noexcept
+    {
+      entry * const set = set_of(held, target);
+      for (std::size_t i = 0; i < set_size; ++i) {
+        const up_cast_result result = set[i].read(held, target, offset);
+        if (result != up_cast_result::unknown) {
+          increment(local_counters().hits);
+          return result;
+        }
+      }
+      increment(local_counters().misses);
+      return up_cast_result::unknown;
+    }
+
+    // Records the outcome of casting the held type to the target type.
+    // The update is skipped if it races with another update of the same entry.
+    void insert(const std::type_info & held, const std::type_info & target, up_cast_result result, std::ptrdiff_t offset) noexcept
+    {
+      entry * const set = set_of(held, target);
+      entry * victim = nullptr;
+      for (std::size_t i = 0; i < set_size && victim == nullptr; ++i) {
+        const std::type_info * const entry_held = set[i].held.load(std::memory_order_relaxed);
+        if (entry_held == nullptr || (entry_held == &held && set[i].target.load(std::memory_order_relaxed) == &target)) {
+          victim = &set[i];
+        }
+      }
+      const bool is_eviction = victim == nullptr;
+      if (is_eviction) { // the sequence numbers change on every update so are a cheap source of randomness
+        victim = &set[(set[0].sequence.load(std::memory_order_relaxed) >> 1) % set_size];
+      }
+      if (victim->write(&held, &target, result, offset) && is_eviction) {
+        increment(local_counters().evictions);
+      }
+    }
+
+    // Removes all entries
+    void clear() noexcept
+    {
+      for (std::size_t i = 0; i < my_capacity; ++i) {
+        my_entries[i].write(nullptr, nullptr, up_cast_result::unknown, 0);
+      }
+    }
+
+    //-----------------------------------------------------
+    // Observers
+
+    statistics stats() const noexcept
+    {
+      statistics stats{ 0, 0, 0, my_capacity, my_capacity * sizeof(entry) };
+      const auto add = [&stats](const counters & c) noexcept {
+        stats.hits += c.hits.load(std::memory_order_relaxed);
+        stats.misses += c.misses.load(std::memory_order_relaxed);
+        stats.evictions += c.evictions.load(std::memory_order_relaxed);
+      };
+      for (const counters * c = my_counters.load(std::memory_order_acquire); c != nullptr; c = c->next) {
+        add(*c);
+      }
+      add(my_shared_counters);
+      return stats;
+    }
+
+  private:
+
+    // An entry is updated with a sequence lock where the sequence number is odd
+    // while the entry is being updated. All members are atomic so that a reader
+    // that races with an update reads a torn entry without undefined behaviour, 
+    // then discards it as the sequence number has changed.
+    struct entry
+    {
+      std::atomic<std::uint32_t>          sequence{ 0 };
+      std::atomic<up_cast_result>         result{ up_cast_result::unknown };
+      std::atomic<const std::type_info*>  held{ nullptr };
+      std::atomic<const std::type_info*>  target{ nullptr };
+      std::atomic<std::ptrdiff_t>         offset{ 0 };
+
+      up_cast_result read(const std::type_info & held_, const std::type_info & target_, std::ptrdiff_t & offset_) const noexcept
+      {
+        const std::uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+          return up_cast_result::unknown;
+        }
+        const std::type_info * const entry_held = held.load(std::memory_order_relaxed);
+        const std::type_info * const entry_target = target.load(std::memory_order_relaxed);
+        const up_cast_result entry_result = result.load(std::memory_order_relaxed);
+        const std::ptrdiff_t entry_offset = offset.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before || entry_held != &held_ || entry_target != &target_) {
+          return up_cast_result::unknown;
+        }
+        offset_ = entry_offset;
+        return entry_result;
+      }
+
+      bool write(const std::type_info * held_, const std::type_info * target_, up_cast_result result_, std::ptrdiff_t offset_) noexcept
+      {
+        std::uint32_t before = sequence.load(std::memory_order_relaxed);
+        if ((before & 1) || !sequence.compare_exchange_strong(before, before + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+          return false; // another thread is updating the entry
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        held.store(held_, std::memory_order_relaxed);
+        target.store(target_, std::memory_order_relaxed);
+        result.store(result_, std::memory_order_relaxed);
+        offset.store(offset_, std::memory_order_relaxed);
+        sequence.store(before + 2, std::memory_order_release);
+        return true;
+      }
+    };
+
+    // The counters of a thread, which are only written by that thread so an increment is a 
+    // load and a store to a cache line of its own. They're atomic so that stats() can read them.
+    // The counters of a thread that's exited are taken over by the next thread with the same ID.
+    struct alignas(64) counters
+    {
+      std::atomic<std::uint64_t>  hits{ 0 };
+      std::atomic<std::uint64_t>  misses{ 0 };
+      std::atomic<std::uint64_t>  evictions{ 0 };
+      std::thread::id             owner;
+      counters *                  next{ nullptr };
+    };
+
+    // The number of entries a key can be stored in
+    static constexpr std::size_t set_size = 4;
+
+    const std::size_t         my_capacity;
+    std::unique_ptr<entry[]>  my_entries;
+    // The list of the counters of each thread that's used the instance
+    std::atomic<counters*>    my_counters{ nullptr };
+    // The counters of a thread whose counters couldn't be allocated, which may lose counts
+    counters                  my_shared_counters;
+    // Identifies the instance to a thread's cached counters, unlike its address which may be reused
+    const std::uint64_t       my_generation{ next_generation() };
+
+    static std::size_t capacity_for(std::size_t max_bytes) noexcept
+    {
+      // round down to a power of 2 that's at least 1 set
+      std::size_t capacity = set_size;
+      while (capacity * 2 * sizeof(entry) <= max_bytes) {
+        capacity *= 2;
+      }
+      return capacity;
+    }
+
+    entry * set_of(const std::type_info & held, const std::type_info & target) const noexcept
+    {
+      std::uint64_t hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(&held)) * 0x9E3779B97F4A7C15ull;
+      hash ^= static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(&target)) * 0xC2B2AE3D27D4EB4Full;
+      hash ^= hash >> 29;
+      return &my_entries[static_cast<std::size_t>(hash) & (my_capacity - set_size)];
+    }
+
+    static void increment(std::atomic<std::uint64_t> & counter) noexcept
+    {
+      counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Returns the counters of the calling thread, which are cached per thread for the last instance used
+    counters & local_counters() noexcept
+    {
+      thread_local std::uint64_t our_generation{ 0 };
+      thread_local counters * our_counters{ nullptr };
+      if (our_generation != my_generation) {
+        our_counters = find_or_add_counters(std::this_thread::get_id());
+        our_generation = my_generation;
+      }
+      return *our_counters;
+    }
+
+    counters * find_or_add_counters(std::thread::id owner) noexcept
+    {
+      counters * head = my_counters.load(std::memory_order_acquire);
+      for (counters * c = head; c != nullptr; c = c->next) {
+        if (c->owner == owner) {
+          return c;
+        }
+      }
+      counters * const added = new (std::nothrow) counters;
+      if (added == nullptr) {
+        return &my_shared_counters;
+      }
+      added->owner = owner;
+      added->next = head;
+      while (!my_counters.compare_exchange_weak(added->next, added, std::memory_order_release, std::memory_order_acquire)) {
+      }
+      return added;
+    }
+
+    static std::uint64_t next_generation() noexcept
+    {
+      static std::atomic<std::uint64_t> our_next_generation{ 1 };
+      return our_next_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static std::atomic<std::size_t> & max_bytes_config() noexcept
+    {
+      static std::atomic<std::size_t> our_max_bytes{ default_max_bytes };
+      return our_max_bytes;
+    }
+
+    static std::atomic<bool> & is_instantiated() noexcept
+    {
+      static std::atomic<bool> our_is_instantiated{ false };
+      return our_is_instantiated;
+    }
+  };
+
+} // namespace xxx
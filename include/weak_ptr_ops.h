@@ -0,0 +1,84 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace xxx {
+
+  namespace detail {
+
+    // The operations on a type-erased weak_ptr<T> that's held in place, where T is unqualified or void.
+    // 'observe' constructs the weak_ptr<T> that observes the object of a shared_ptr<T> that's been 
+    // type-erased to a shared_ptr<void> e.g. the held shared_ptr of an any_shared_ptr.
+    struct weak_ptr_ops
+    {
+      void                        (*observe)(void * to, const std::shared_ptr<void> & from) noexcept;
+      void                        (*copy)(void * to, const void * from) noexcept;
+      void                        (*destroy)(void * ptr) noexcept;
+      long                        (*use_count)(const void * ptr) noexcept;
+      bool                        (*expired)(const void * ptr) noexcept;
+      std::shared_ptr<void>       (*lock)(const void * ptr) noexcept;
+    };
+
+    template<typename T>
+    const std::weak_ptr<T> & held_weak_ptr(const void * ptr) noexcept { return *static_cast<const std::weak_ptr<T>*>(ptr); }
+
+    template<typename T>
+    void observe_weak_ptr(void * to, const std::shared_ptr<void> & from) noexcept { ::new (to) std::weak_ptr<T>(std::static_pointer_cast<T>(from)); }
+
+    template<typename T>
+    void copy_weak_ptr(void * to, const void * from) noexcept { ::new (to) std::weak_ptr<T>(held_weak_ptr<T>(from)); }
+
+    template<typename T>
+    void destroy_weak_ptr(void * ptr) noexcept { static_cast<std::weak_ptr<T>*>(ptr)->~weak_ptr<T>(); }
+
+    template<typename T>
+    long weak_ptr_use_count(const void * ptr) noexcept { return held_weak_ptr<T>(ptr).use_count(); }
+
+    template<typename T>
+    bool weak_ptr_expired(const void * ptr) noexcept { return held_weak_ptr<T>(ptr).expired(); }
+
+    template<typename T>
+    std::shared_ptr<void> lock_weak_ptr(const void * ptr) noexcept { return held_weak_ptr<T>(ptr).lock(); }
+
+    // The static table of operations for a held weak_ptr<T>, where T is unqualified or void
+    template<typename T>
+    inline constexpr weak_ptr_ops weak_ptr_ops_v{ &observe_weak_ptr<T>, &copy_weak_ptr<T>, &destroy_weak_ptr<T>, &weak_ptr_use_count<T>, &weak_ptr_expired<T>, &lock_weak_ptr<T> };
+
+    template<typename Held>
+    struct weak_ptr_ops_of
+    {
+      static constexpr const weak_ptr_ops * value = nullptr;
+    };
+
+    // The operations on a weak_ptr to the object of a held shared_ptr<T>
+    template<typename T>
+    struct weak_ptr_ops_of<std::shared_ptr<T>>
+    {
+      static constexpr const weak_ptr_ops * value = &weak_ptr_ops_v<std::remove_cv_t<T>>;
+    };
+
+  } // namespace detail
+
+} // namespace xxx
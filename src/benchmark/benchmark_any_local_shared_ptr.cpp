@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_local_shared_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// A copy-heavy workload i.e. copies of the handles, and casts of them, 
+// that are confined to one thread. 
+
+namespace {
+
+  // libstdc++ uses a non-atomic count for a shared_ptr until the process starts a 2nd thread
+  // (see __libc_single_threaded), whereas a server that confines objects to a thread has many.
+  // Note the process remains multi-threaded for the benchmarks that run afterwards.
+  void start_a_thread() {
+    static const bool our_is_started = (std::thread([] {}).join(), true);
+    benchmark::DoNotOptimize(our_is_started);
+  }
+
+  struct Base { int value{ 42 }; };
+  struct Derived : public Base {};
+
+  constexpr int our_count = 1000;
+
+  template<typename AnySharedPtr>
+  void copy(benchmark::State& state, const AnySharedPtr & any) {
+    start_a_thread();
+    std::vector<AnySharedPtr> copies;
+    copies.reserve(our_count);
+    while (state.KeepRunning()) {
+      for (int i = 0; i < our_count; ++i) {
+        copies.push_back(any);
+      }
+      benchmark::DoNotOptimize(copies.data());
+      copies.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * our_count);
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void cast(benchmark::State& state, const AnySharedPtr & any) {
+    start_a_thread();
+    long sum{ 0 };
+    while (state.KeepRunning()) {
+      for (int i = 0; i < our_count; ++i) {
+        using xxx::any_shared_ptr_cast; // finds the casts of the same name in namespace v2 
+        const auto ptr = any_shared_ptr_cast<T>(any);
+        sum += ptr->value;
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * our_count);
+  }
+
+  const xxx::v1::any_shared_ptr our_v1{ std::make_shared<Derived>() };
+  const xxx::v2::any_shared_ptr our_v2{ std::make_shared<Derived>() };
+  const xxx::any_local_shared_ptr our_local = xxx::make_any_local_shared_ptr<Derived>();
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_copy(benchmark::State& state) { copy(state, our_v1); }
+static void BM_v2_copy(benchmark::State& state) { copy(state, our_v2); }
+static void BM_local_copy(benchmark::State& state) { copy(state, our_local); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr 1000 x copy", BM_v1_copy);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr 1000 x copy", BM_v2_copy);
+BENCHMARK_WITH_NAME("any_local_shared_ptr 1000 x copy", BM_local_copy);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_cast(benchmark::State& state) { cast<Derived>(state, our_v1); }
+static void BM_v2_cast(benchmark::State& state) { cast<Derived>(state, our_v2); }
+static void BM_local_cast(benchmark::State& state) { cast<Derived>(state, our_local); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr 1000 x any_shared_ptr_cast< Derived > - cast to same type", BM_v1_cast);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr 1000 x any_shared_ptr_cast< Derived > - cast to same type", BM_v2_cast);
+BENCHMARK_WITH_NAME("any_local_shared_ptr 1000 x any_shared_ptr_cast< Derived > - cast to same type", BM_local_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_up_cast(benchmark::State& state) { cast<Base>(state, our_v1); }
+static void BM_v2_up_cast(benchmark::State& state) { cast<Base>(state, our_v2); }
+static void BM_local_up_cast(benchmark::State& state) { cast<Base>(state, our_local); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr 1000 x any_shared_ptr_cast< Base > - implicit up cast", BM_v1_up_cast);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr 1000 x any_shared_ptr_cast< Base > - implicit up cast", BM_v2_up_cast);
+BENCHMARK_WITH_NAME("any_local_shared_ptr 1000 x any_shared_ptr_cast< Base > - implicit up cast", BM_local_up_cast);
+
+//-----------------------------------------------------------------------------
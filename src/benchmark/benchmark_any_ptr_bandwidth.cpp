@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  struct Base { int value{ 1 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+  // The number of elements, which is chosen so that the vectors don't fit in the cache
+  constexpr std::size_t our_size = std::size_t{ 1 } << 22;
+
+  // The previous any_ptr layout i.e. the held pointer, its held_type and 
+  // the function that implements a dynamic up cast, stored side by side.
+  struct wide_any_ptr
+  {
+    const xxx::detail::held_type *  my_held_type;
+    void *                          my_ptr;
+    xxx::detail::up_cast_func *     my_up_cast_func;
+  };
+
+  template<typename T>
+  T* wide_any_ptr_cast(const wide_any_ptr & any_ptr_) noexcept
+  {
+    return xxx::detail::is_same_unqualified_type(*any_ptr_.my_held_type, xxx::detail::held_type_v<T>) ? static_cast<T*>(any_ptr_.my_ptr) : nullptr;
+  }
+
+  std::unique_ptr<Derived> our_derived = std::make_unique<Derived>();
+
+  std::vector<xxx::any_ptr> make_any_ptrs() {
+    return std::vector<xxx::any_ptr>(our_size, xxx::any_ptr{ our_derived.get() });
+  }
+
+  std::vector<wide_any_ptr> make_wide_any_ptrs() {
+    const wide_any_ptr wide{ &xxx::detail::held_type_v<Derived>, our_derived.get(), xxx::detail::held_type_v<Derived>.up_cast };
+    return std::vector<wide_any_ptr>(our_size, wide);
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_bandwidth(benchmark::State& state) {
+  const std::vector<xxx::any_ptr> any_ptrs = make_any_ptrs();
+  int sum{ 0 };
+  while (state.KeepRunning()) {
+    for (const xxx::any_ptr & any : any_ptrs) {
+      sum += xxx::any_ptr_cast<Derived>(any)->value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(our_size * sizeof(xxx::any_ptr)));
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(our_size));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any) - vector<any_ptr> of 4M elements", BM_any_ptr_bandwidth);
+
+//-----------------------------------------------------------------------------
+
+static void BM_wide_any_ptr_bandwidth(benchmark::State& state) {
+  const std::vector<wide_any_ptr> any_ptrs = make_wide_any_ptrs();
+  int sum{ 0 };
+  while (state.KeepRunning()) {
+    for (const wide_any_ptr & any : any_ptrs) {
+      sum += wide_any_ptr_cast<Derived>(any)->value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(our_size * sizeof(wide_any_ptr)));
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(our_size));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any) - vector of 4M three pointer any_ptr", BM_wide_any_ptr_bandwidth);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,183 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr_bases.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <sstream>
+#include <memory>
+#include <utility>
+
+namespace {
+
+  struct Top { virtual ~Top() = default; };
+  struct Base1 : public Top {};
+  struct Base2 { virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  // The same hierarchy without registered bases, which are discovered when ANY_PTR_HAS_DIRECT_BASES is defined
+  struct UnregisteredTop { virtual ~UnregisteredTop() = default; };
+  struct UnregisteredBase1 : public UnregisteredTop {};
+  struct UnregisteredBase2 { virtual ~UnregisteredBase2() = default; };
+  struct UnregisteredDerived : public UnregisteredBase1, public UnregisteredBase2 {};
+
+  // A deep hierarchy where Widget<N> derives from Widget<N-1> and the mixin Mixin<N>
+  template<int N>
+  struct Mixin { int m{ N }; virtual ~Mixin() = default; };
+
+  template<int N>
+  struct Widget : public Widget<N - 1>, public Mixin<N> {};
+
+  template<>
+  struct Widget<0> : public Mixin<0> {};
+
+} // namespace
+
+ANY_PTR_BASES(Base1, Top);
+ANY_PTR_BASES(Derived, Base1, Base2);
+
+namespace {
+
+  std::unique_ptr<Derived> our_derived = std::make_unique<Derived>();
+  std::unique_ptr<UnregisteredDerived> our_unregistered_derived = std::make_unique<UnregisteredDerived>();
+  xxx::any_ptr our_any_ptr(our_derived.get());
+  xxx::any_ptr our_unregistered_any_ptr(our_unregistered_derived.get());
+  xxx::any_shared_ptr our_any_shared_ptr(std::make_shared<Derived>());
+
+  bool any_ptr_registered_up_cast() {
+    return xxx::any_ptr_cast<Base2>(our_any_ptr) != nullptr;
+  }
+
+  bool any_ptr_registered_transitive_up_cast() {
+    return xxx::any_ptr_cast<Top>(our_any_ptr) != nullptr;
+  }
+
+  bool any_ptr_unregistered_up_cast() {
+    return xxx::any_ptr_cast<UnregisteredBase2>(our_unregistered_any_ptr) != nullptr;
+  }
+
+  std::unique_ptr<Widget<7>> our_widget = std::make_unique<Widget<7>>();
+  xxx::any_ptr our_widget_any_ptr(our_widget.get());
+
+  // Up cast the held Widget<7> to each of its 16 ancestors in turn
+  template<int... N>
+  bool any_ptr_deep_up_casts(std::integer_sequence<int, N...>) {
+    return ((xxx::any_ptr_cast<Mixin<N>>(our_widget_any_ptr) != nullptr) && ...) &&
+           ((xxx::any_ptr_cast<Widget<N>>(our_widget_any_ptr) != nullptr) && ...);
+  }
+
+  bool any_shared_ptr_registered_up_cast() {
+    return xxx::any_shared_ptr_cast<Base2>(our_any_shared_ptr) != nullptr;
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_registered_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_registered_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Base2 >(any) - registered base", BM_any_ptr_registered_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_registered_transitive_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_registered_transitive_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Top >(any) - registered transitive base", BM_any_ptr_registered_transitive_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_unregistered_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_unregistered_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+#ifdef ANY_PTR_HAS_DIRECT_BASES
+BENCHMARK_WITH_NAME("any_ptr_cast< Base2 >(any) - discovered base", BM_any_ptr_unregistered_up_cast);
+#else
+BENCHMARK_WITH_NAME("any_ptr_cast< Base2 >(any) - unregistered base", BM_any_ptr_unregistered_up_cast);
+#endif
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_shared_ptr_registered_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_shared_ptr_registered_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_shared_ptr_cast< Base2 >(any) - registered base", BM_any_shared_ptr_registered_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_deep_up_casts(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_deep_up_casts(std::make_integer_sequence<int, 8>{});
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Ancestor >(any) - 16 ancestors of a deep hierarchy", BM_any_ptr_deep_up_casts);
+
+//-----------------------------------------------------------------------------
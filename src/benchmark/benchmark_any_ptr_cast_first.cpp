@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+#include <variant>
+
+// A message handler that tries 2, 4 or 8 candidate types in turn where only the last, or none, 
+// matches - any_ptr_cast_first<Ts...> compared with trying any_ptr_cast<T> for each candidate. 
+// The "engine" benchmarks bypass the up_cast_cache to compare a throw per candidate of the 
+// portable engine with the single throw of throw_up_cast_first.
+
+namespace {
+
+  struct Base { int value{ 42 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+  template<int N>
+  struct Unrelated { virtual ~Unrelated() = default; };
+
+  const std::shared_ptr<Derived> our_ptr = std::make_shared<Derived>();
+  const xxx::any_ptr our_any_ptr{ our_ptr.get() };
+  const xxx::v1::any_shared_ptr our_v1{ our_ptr };
+
+  // Returns true if one of the candidates matches by any_ptr_cast<T> for each in turn
+  template<typename... Ts>
+  bool cast_each(const xxx::any_ptr & any) {
+    return ((xxx::any_ptr_cast<Ts>(&any).has_value()) || ...);
+  }
+
+  template<typename... Ts>
+  bool cast_first(const xxx::any_ptr & any) {
+    return !std::holds_alternative<std::monostate>(xxx::any_ptr_cast_first<Ts...>(any));
+  }
+
+  template<typename... Ts>
+  bool shared_cast_each(const xxx::v1::any_shared_ptr & any) {
+    return ((xxx::any_shared_ptr_cast<Ts>(&any).has_value()) || ...);
+  }
+
+  template<typename... Ts>
+  bool shared_cast_first(const xxx::v1::any_shared_ptr & any) {
+    return !std::holds_alternative<std::monostate>(xxx::any_shared_ptr_cast_first<Ts...>(any));
+  }
+
+  template<typename... Ts>
+  bool throw_each(Derived * p) {
+    bool result{ false };
+    ((result = result || [p] { void * ptr = p; return xxx::detail::throw_up_cast<Ts>(&xxx::detail::throw_pointer<Derived>, ptr) != xxx::up_cast_result::failed; }()), ...);
+    return result;
+  }
+
+  template<typename... Ts>
+  bool throw_first(Derived * p) {
+    void * ptr = p;
+    return xxx::detail::throw_up_cast_first<Ts...>(&xxx::detail::throw_pointer<Derived>, ptr) != sizeof...(Ts);
+  }
+
+  template<bool(*Cast)(const xxx::any_ptr &)>
+  void run(benchmark::State& state) {
+    bool result{ false };
+    while (state.KeepRunning()) {
+      result = Cast(our_any_ptr);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<bool(*Cast)(const xxx::v1::any_shared_ptr &)>
+  void run_shared(benchmark::State& state) {
+    bool result{ false };
+    while (state.KeepRunning()) {
+      result = Cast(our_v1);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<bool(*Cast)(Derived *)>
+  void run_engine(benchmark::State& state) {
+    bool result{ false };
+    while (state.KeepRunning()) {
+      result = Cast(our_ptr.get());
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_cast_each_2(benchmark::State& state) { run<&cast_each<Unrelated<0>, Base>>(state); }
+static void BM_cast_first_2(benchmark::State& state) { run<&cast_first<Unrelated<0>, Base>>(state); }
+static void BM_cast_each_4(benchmark::State& state) { run<&cast_each<Unrelated<0>, Unrelated<1>, Unrelated<2>, Base>>(state); }
+static void BM_cast_first_4(benchmark::State& state) { run<&cast_first<Unrelated<0>, Unrelated<1>, Unrelated<2>, Base>>(state); }
+static void BM_cast_each_8(benchmark::State& state) { run<&cast_each<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>, Unrelated<4>, Unrelated<5>, Unrelated<6>, Base>>(state); }
+static void BM_cast_first_8(benchmark::State& state) { run<&cast_first<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>, Unrelated<4>, Unrelated<5>, Unrelated<6>, Base>>(state); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) for each of 2 candidates - last matches", BM_cast_each_2);
+BENCHMARK_WITH_NAME("any_ptr_cast_first< 2 candidates >(any_ptr) - last matches", BM_cast_first_2);
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) for each of 4 candidates - last matches", BM_cast_each_4);
+BENCHMARK_WITH_NAME("any_ptr_cast_first< 4 candidates >(any_ptr) - last matches", BM_cast_first_4);
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) for each of 8 candidates - last matches", BM_cast_each_8);
+BENCHMARK_WITH_NAME("any_ptr_cast_first< 8 candidates >(any_ptr) - last matches", BM_cast_first_8);
+
+//-----------------------------------------------------------------------------
+
+static void BM_shared_cast_each_4(benchmark::State& state) { run_shared<&shared_cast_each<Unrelated<0>, Unrelated<1>, Unrelated<2>, Base>>(state); }
+static void BM_shared_cast_first_4(benchmark::State& state) { run_shared<&shared_cast_first<Unrelated<0>, Unrelated<1>, Unrelated<2>, Base>>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr any_shared_ptr_cast< T >(&any) for each of 4 candidates - last matches", BM_shared_cast_each_4);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr any_shared_ptr_cast_first< 4 candidates >(any) - last matches", BM_shared_cast_first_4);
+
+//-----------------------------------------------------------------------------
+
+static void BM_throw_each_2(benchmark::State& state) { run_engine<&throw_each<Unrelated<0>, Unrelated<1>>>(state); }
+static void BM_throw_first_2(benchmark::State& state) { run_engine<&throw_first<Unrelated<0>, Unrelated<1>>>(state); }
+static void BM_throw_each_4(benchmark::State& state) { run_engine<&throw_each<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>>>(state); }
+static void BM_throw_first_4(benchmark::State& state) { run_engine<&throw_first<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>>>(state); }
+static void BM_throw_each_8(benchmark::State& state) { run_engine<&throw_each<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>, Unrelated<4>, Unrelated<5>, Unrelated<6>, Unrelated<7>>>(state); }
+static void BM_throw_first_8(benchmark::State& state) { run_engine<&throw_first<Unrelated<0>, Unrelated<1>, Unrelated<2>, Unrelated<3>, Unrelated<4>, Unrelated<5>, Unrelated<6>, Unrelated<7>>>(state); }
+
+BENCHMARK_WITH_NAME("engine throw_up_cast< T > for each of 2 candidates - none matches", BM_throw_each_2);
+BENCHMARK_WITH_NAME("engine throw_up_cast_first< 2 candidates > - none matches", BM_throw_first_2);
+BENCHMARK_WITH_NAME("engine throw_up_cast< T > for each of 4 candidates - none matches", BM_throw_each_4);
+BENCHMARK_WITH_NAME("engine throw_up_cast_first< 4 candidates > - none matches", BM_throw_first_4);
+BENCHMARK_WITH_NAME("engine throw_up_cast< T > for each of 8 candidates - none matches", BM_throw_each_8);
+BENCHMARK_WITH_NAME("engine throw_up_cast_first< 8 candidates > - none matches", BM_throw_first_8);
+
+//-----------------------------------------------------------------------------
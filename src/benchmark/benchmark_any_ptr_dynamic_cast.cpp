@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+// Down casts and cross casts by any_ptr_dynamic_cast<T>, which are resolved from the most derived 
+// object and cached per (dynamic type, target), compared with the built-in dynamic_cast and with 
+// the workaround of an any_ptr_cast to a known polymorphic base followed by a dynamic_cast.
+// A cast through a virtual base isn't cached so it walks the RTTI each time.
+
+namespace {
+
+  struct Shape { int s{ 1 }; virtual ~Shape() = default; };
+  struct Named { int n{ 2 }; virtual ~Named() = default; };
+  struct Circle : public Shape, public Named { int c{ 3 }; };
+
+  struct Left : public virtual Shape {};
+  struct Right : public virtual Shape {};
+  struct Diamond : public Left, public Right {};
+
+  const std::shared_ptr<Shape> our_circle = std::make_shared<Circle>();
+  const xxx::any_ptr our_any_circle{ our_circle.get() };
+  const xxx::v1::any_shared_ptr our_v1_circle{ our_circle };
+
+  const std::shared_ptr<Left> our_diamond = std::make_shared<Diamond>();
+  const xxx::any_ptr our_any_diamond{ our_diamond.get() };
+
+  template<typename T>
+  T* any_dynamic_cast(const xxx::any_ptr & any) {
+    return *xxx::any_ptr_dynamic_cast<T>(&any);
+  }
+
+  // The workaround when the held type is unknown but a polymorphic base of it is known
+  template<typename Known, typename T>
+  T* any_cast_then_dynamic_cast(const xxx::any_ptr & any) {
+    return dynamic_cast<T*>(*xxx::any_ptr_cast<Known>(&any));
+  }
+
+  template<typename T, T*(*Cast)(const xxx::any_ptr &)>
+  void run(benchmark::State& state, const xxx::any_ptr & any) {
+    T * result{ nullptr };
+    while (state.KeepRunning()) {
+      result = Cast(any);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<typename From, typename T>
+  void run_builtin(benchmark::State& state, From * ptr) {
+    T * result{ nullptr };
+    while (state.KeepRunning()) {
+      benchmark::DoNotOptimize(ptr);
+      result = dynamic_cast<T*>(ptr);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_builtin_cross_cast(benchmark::State& state) { run_builtin<Shape, Named>(state, our_circle.get()); }
+static void BM_any_ptr_cross_cast(benchmark::State& state) { run<Named, &any_dynamic_cast<Named>>(state, our_any_circle); }
+static void BM_workaround_cross_cast(benchmark::State& state) { run<Named, &any_cast_then_dynamic_cast<Shape, Named>>(state, our_any_circle); }
+static void BM_builtin_down_cast(benchmark::State& state) { run_builtin<Shape, Circle>(state, our_circle.get()); }
+static void BM_any_ptr_down_cast(benchmark::State& state) { run<Circle, &any_dynamic_cast<Circle>>(state, our_any_circle); }
+static void BM_workaround_down_cast(benchmark::State& state) { run<Circle, &any_cast_then_dynamic_cast<Shape, Circle>>(state, our_any_circle); }
+
+BENCHMARK_WITH_NAME("dynamic_cast< Named* >(Shape*) - cross cast", BM_builtin_cross_cast);
+BENCHMARK_WITH_NAME("any_ptr_dynamic_cast< Named >(&any_ptr) - cross cast", BM_any_ptr_cross_cast);
+BENCHMARK_WITH_NAME("dynamic_cast< Named* >(any_ptr_cast< Shape >(&any_ptr)) - cross cast", BM_workaround_cross_cast);
+BENCHMARK_WITH_NAME("dynamic_cast< Circle* >(Shape*) - down cast", BM_builtin_down_cast);
+BENCHMARK_WITH_NAME("any_ptr_dynamic_cast< Circle >(&any_ptr) - down cast", BM_any_ptr_down_cast);
+BENCHMARK_WITH_NAME("dynamic_cast< Circle* >(any_ptr_cast< Shape >(&any_ptr)) - down cast", BM_workaround_down_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_builtin_virtual_cross_cast(benchmark::State& state) { run_builtin<Left, Right>(state, our_diamond.get()); }
+static void BM_any_ptr_virtual_cross_cast(benchmark::State& state) { run<Right, &any_dynamic_cast<Right>>(state, our_any_diamond); }
+
+BENCHMARK_WITH_NAME("dynamic_cast< Right* >(Left*) - cross cast through a virtual base", BM_builtin_virtual_cross_cast);
+BENCHMARK_WITH_NAME("any_ptr_dynamic_cast< Right >(&any_ptr) - cross cast through a virtual base", BM_any_ptr_virtual_cross_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_builtin_shared_cross_cast(benchmark::State& state) {
+  std::shared_ptr<Named> result;
+  while (state.KeepRunning()) {
+    result = std::dynamic_pointer_cast<Named>(our_circle);
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+static void BM_v1_shared_cross_cast(benchmark::State& state) {
+  std::shared_ptr<Named> result;
+  while (state.KeepRunning()) {
+    result = xxx::any_shared_ptr_dynamic_cast<Named>(our_v1_circle);
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("dynamic_pointer_cast< Named >(shared_ptr< Shape >) - cross cast", BM_builtin_shared_cross_cast);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr any_shared_ptr_dynamic_cast< Named >(any) - cross cast", BM_v1_shared_cross_cast);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_ptr_visit.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// An event loop that dispatches events of 4, 16 or 64 types, each derived from a common base, 
+// where any_ptr_visit is compared with an if/else chain of any_ptr_cast for each type in turn.
+
+namespace {
+
+  struct Event { int value{ 1 }; virtual ~Event() = default; };
+
+  template<int N>
+  struct Alternative : public Event {};
+
+  // The visitor has an overload per alternative
+  struct visitor
+  {
+    template<int N>
+    int operator()(Alternative<N> & event) const { return event.value + N; }
+  };
+
+  // The events of each alternative in turn
+  template<int... N>
+  std::vector<xxx::any_ptr> make_events(std::integer_sequence<int, N...>) {
+    static std::unique_ptr<Event> our_owned[] = { std::make_unique<Alternative<N>>()... };
+    return { xxx::any_ptr{ static_cast<Alternative<N>*>(our_owned[N].get()) }... };
+  }
+
+  // Tries any_ptr_cast for each alternative in turn 
+  template<int... N>
+  int cast_chain(const xxx::any_ptr & any, std::integer_sequence<int, N...>) {
+    int result{ 0 };
+    const bool is_visited = (([&] {
+      const auto event = xxx::any_ptr_cast<Alternative<N>>(&any);
+      if (event) {
+        result = visitor{}(**event);
+      }
+      return event.has_value();
+    }()) || ...);
+    return is_visited ? result : -1;
+  }
+
+  template<int... N>
+  int visit(const xxx::any_ptr & any, std::integer_sequence<int, N...>) {
+    return xxx::any_ptr_visit<Alternative<N>...>(any, visitor{});
+  }
+
+  template<int Count>
+  void chain(benchmark::State& state) {
+    const std::vector<xxx::any_ptr> events = make_events(std::make_integer_sequence<int, Count>{});
+    int sum{ 0 };
+    while (state.KeepRunning()) {
+      for (const xxx::any_ptr & event : events) {
+        sum += cast_chain(event, std::make_integer_sequence<int, Count>{});
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * Count);
+  }
+
+  template<int Count>
+  void visit(benchmark::State& state) {
+    const std::vector<xxx::any_ptr> events = make_events(std::make_integer_sequence<int, Count>{});
+    int sum{ 0 };
+    while (state.KeepRunning()) {
+      for (const xxx::any_ptr & event : events) {
+        sum += visit(event, std::make_integer_sequence<int, Count>{});
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * Count);
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_chain_4(benchmark::State& state) { chain<4>(state); }
+static void BM_visit_4(benchmark::State& state) { visit<4>(state); }
+static void BM_chain_16(benchmark::State& state) { chain<16>(state); }
+static void BM_visit_16(benchmark::State& state) { visit<16>(state); }
+static void BM_chain_64(benchmark::State& state) { chain<64>(state); }
+static void BM_visit_64(benchmark::State& state) { visit<64>(state); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) chain of 4 alternatives - each event type in turn", BM_chain_4);
+BENCHMARK_WITH_NAME("any_ptr_visit< 4 alternatives >(any_ptr) - each event type in turn", BM_visit_4);
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) chain of 16 alternatives - each event type in turn", BM_chain_16);
+BENCHMARK_WITH_NAME("any_ptr_visit< 16 alternatives >(any_ptr) - each event type in turn", BM_visit_16);
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) chain of 64 alternatives - each event type in turn", BM_chain_64);
+BENCHMARK_WITH_NAME("any_ptr_visit< 64 alternatives >(any_ptr) - each event type in turn", BM_visit_64);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_ptr_visit.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Collision-style double dispatch on every pair of 32 body types, each derived from one of 
+// 4 groups, where the 16 handlers are for a pair of groups. any_ptr_visit2 is compared with 
+// nested any_ptr_cast attempts i.e. each group in turn for the first body and then for the second.
+
+namespace {
+
+  struct Body { int value{ 1 }; virtual ~Body() = default; };
+
+  template<int G>
+  struct Group : public Body {};
+
+  template<int N>
+  struct Kind : public Group<N % 4> {};
+
+  constexpr int our_groups = 4;
+  constexpr int our_kinds = 32;
+
+  template<int I, int J>
+  struct handler
+  {
+    int operator()(Group<I> & first, Group<J> & second) const { return first.value + second.value + I * our_groups + J; }
+  };
+
+  template<int... N>
+  std::vector<xxx::any_ptr> make_bodies(std::integer_sequence<int, N...>) {
+    static std::unique_ptr<Body> our_owned[] = { std::make_unique<Kind<N>>()... };
+    return { xxx::any_ptr{ static_cast<Kind<N>*>(our_owned[N].get()) }... };
+  }
+
+  template<int I, int... J>
+  int cast_second(Group<I> & first, const xxx::any_ptr & second, std::integer_sequence<int, J...>) {
+    int result{ -1 };
+    (void)(([&] {
+      const auto group = xxx::any_ptr_cast<Group<J>>(&second);
+      if (group) {
+        result = handler<I, J>{}(first, **group);
+      }
+      return group.has_value();
+    }()) || ...);
+    return result;
+  }
+
+  template<int... I>
+  int cast_nested(const xxx::any_ptr & first, const xxx::any_ptr & second, std::integer_sequence<int, I...>) {
+    int result{ -1 };
+    (void)(([&] {
+      const auto group = xxx::any_ptr_cast<Group<I>>(&first);
+      if (group) {
+        result = cast_second(**group, second, std::make_integer_sequence<int, our_groups>{});
+      }
+      return group.has_value();
+    }()) || ...);
+    return result;
+  }
+
+  template<int... H>
+  int visit2(const xxx::any_ptr & first, const xxx::any_ptr & second, std::integer_sequence<int, H...>) {
+    return xxx::any_ptr_visit2(first, second, handler<H / our_groups, H % our_groups>{}...);
+  }
+
+  void nested(benchmark::State& state) {
+    const std::vector<xxx::any_ptr> bodies = make_bodies(std::make_integer_sequence<int, our_kinds>{});
+    int sum{ 0 };
+    while (state.KeepRunning()) {
+      for (const xxx::any_ptr & first : bodies) {
+        for (const xxx::any_ptr & second : bodies) {
+          sum += cast_nested(first, second, std::make_integer_sequence<int, our_groups>{});
+        }
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * our_kinds * our_kinds);
+  }
+
+  void visit2(benchmark::State& state) {
+    const std::vector<xxx::any_ptr> bodies = make_bodies(std::make_integer_sequence<int, our_kinds>{});
+    int sum{ 0 };
+    while (state.KeepRunning()) {
+      for (const xxx::any_ptr & first : bodies) {
+        for (const xxx::any_ptr & second : bodies) {
+          sum += visit2(first, second, std::make_integer_sequence<int, our_groups * our_groups>{});
+        }
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * our_kinds * our_kinds);
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_nested(benchmark::State& state) { nested(state); }
+static void BM_visit2(benchmark::State& state) { visit2(state); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< T >(&any_ptr) nested - 32 x 32 body types, 16 handlers", BM_nested);
+BENCHMARK_WITH_NAME("any_ptr_visit2(any_ptr, any_ptr) - 32 x 32 body types, 16 handlers", BM_visit2);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_shared_ptr.h>
+#include <memory>
+#include <utility>
+
+namespace {
+
+  struct Derived { int value{ 42 }; };
+
+  const std::shared_ptr<Derived> our_ptr = std::make_shared<Derived>();
+
+  template<typename AnySharedPtr>
+  void copy(benchmark::State& state) {
+    const AnySharedPtr any{ our_ptr };
+    while (state.KeepRunning()) {
+      AnySharedPtr copy{ any };
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+
+  template<typename AnySharedPtr>
+  void move(benchmark::State& state) {
+    AnySharedPtr any{ our_ptr };
+    while (state.KeepRunning()) {
+      AnySharedPtr moved{ std::move(any) };
+      benchmark::DoNotOptimize(moved);
+      any = std::move(moved);
+    }
+  }
+
+  template<typename AnySharedPtr>
+  void assign(benchmark::State& state) {
+    const AnySharedPtr any{ our_ptr };
+    AnySharedPtr other{ std::make_shared<int>(42) };
+    const AnySharedPtr other_copy{ other };
+    while (state.KeepRunning()) {
+      other = any;
+      benchmark::DoNotOptimize(other);
+      other = other_copy;
+    }
+  }
+
+  template<typename AnySharedPtr>
+  void reset(benchmark::State& state) {
+    AnySharedPtr any;
+    while (state.KeepRunning()) {
+      any.reset();
+      benchmark::DoNotOptimize(any);
+    }
+  }
+
+  template<typename AnySharedPtr>
+  void has_value(benchmark::State& state) {
+    const AnySharedPtr any{ our_ptr };
+    bool result{ false };
+    while (state.KeepRunning()) {
+      benchmark::DoNotOptimize(any);
+      result = any.has_value();
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_copy(benchmark::State& state) { copy<xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_copy(benchmark::State& state) { copy<xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr copy", BM_v1_copy);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr copy", BM_v2_copy);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_move(benchmark::State& state) { move<xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_move(benchmark::State& state) { move<xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr move ctor + move assignment", BM_v1_move);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr move ctor + move assignment", BM_v2_move);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_assign(benchmark::State& state) { assign<xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_assign(benchmark::State& state) { assign<xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr 2 x copy assignment", BM_v1_assign);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr 2 x copy assignment", BM_v2_assign);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_reset(benchmark::State& state) { reset<xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_reset(benchmark::State& state) { reset<xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr reset of an empty instance", BM_v1_reset);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr reset of an empty instance", BM_v2_reset);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_has_value(benchmark::State& state) { has_value<xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_has_value(benchmark::State& state) { has_value<xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr has_value", BM_v1_has_value);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr has_value", BM_v2_has_value);
+
+//-----------------------------------------------------------------------------
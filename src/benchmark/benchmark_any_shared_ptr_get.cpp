@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+// Borrowing the held pointer by any_shared_ptr_get<T>, or by casting an any_shared_ptr's view(),  
+// compared with any_ptr_cast<T> and any_shared_ptr_cast<T>, which copies a shared_ptr<T> 
+
+namespace {
+
+  struct Base { int value{ 42 }; };
+  struct Derived : public Base {};
+
+  const std::shared_ptr<Derived> our_ptr = std::make_shared<Derived>();
+
+  const xxx::any_ptr our_any_ptr{ our_ptr.get() };
+  const xxx::v1::any_shared_ptr our_v1{ our_ptr };
+  const xxx::v2::any_shared_ptr our_v2{ our_ptr };
+  const xxx::v3::any_shared_ptr our_v3{ our_ptr };
+
+  template<typename T>
+  void any_ptr_cast(benchmark::State& state) {
+    while (state.KeepRunning()) {
+      T * result = xxx::any_ptr_cast<T>(our_any_ptr);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void any_shared_ptr_get(benchmark::State& state, const AnySharedPtr & any) {
+    using xxx::any_shared_ptr_get; // finds the casts of the same name in namespace v2 and v3 
+    while (state.KeepRunning()) {
+      T * result = any_shared_ptr_get<T>(any);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void any_ptr_cast_of_view(benchmark::State& state, const AnySharedPtr & any) {
+    while (state.KeepRunning()) {
+      benchmark::DoNotOptimize(any);
+      T * result = xxx::any_ptr_cast<T>(any.view());
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void any_shared_ptr_cast(benchmark::State& state, const AnySharedPtr & any) {
+    using xxx::any_shared_ptr_cast; // finds the casts of the same name in namespace v2 and v3 
+    while (state.KeepRunning()) {
+      std::shared_ptr<T> result = any_shared_ptr_cast<T>(any);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast(benchmark::State& state) { any_ptr_cast<Derived>(state); }
+static void BM_v1_get(benchmark::State& state) { any_shared_ptr_get<Derived>(state, our_v1); }
+static void BM_v1_view(benchmark::State& state) { any_ptr_cast_of_view<Derived>(state, our_v1); }
+static void BM_v2_get(benchmark::State& state) { any_shared_ptr_get<Derived>(state, our_v2); }
+static void BM_v3_get(benchmark::State& state) { any_shared_ptr_get<Derived>(state, our_v3); }
+static void BM_v1_cast(benchmark::State& state) { any_shared_ptr_cast<Derived>(state, our_v1); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any) - same type", BM_any_ptr_cast);
+BENCHMARK_WITH_NAME("any_shared_ptr_get< Derived >(any) - same type", BM_v1_get);
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any.view()) - same type", BM_v1_view);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_get< Derived >(any) - same type", BM_v2_get);
+BENCHMARK_WITH_NAME("v3::any_shared_ptr_get< Derived >(any) - same type", BM_v3_get);
+BENCHMARK_WITH_NAME("any_shared_ptr_cast< Derived >(any) - same type", BM_v1_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast_cv_promotion(benchmark::State& state) { any_ptr_cast<const Derived>(state); }
+static void BM_v1_get_cv_promotion(benchmark::State& state) { any_shared_ptr_get<const Derived>(state, our_v1); }
+static void BM_v1_view_cv_promotion(benchmark::State& state) { any_ptr_cast_of_view<const Derived>(state, our_v1); }
+static void BM_v2_get_cv_promotion(benchmark::State& state) { any_shared_ptr_get<const Derived>(state, our_v2); }
+static void BM_v3_get_cv_promotion(benchmark::State& state) { any_shared_ptr_get<const Derived>(state, our_v3); }
+static void BM_v1_cast_cv_promotion(benchmark::State& state) { any_shared_ptr_cast<const Derived>(state, our_v1); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< const Derived >(any) - cv-qualifier promotion", BM_any_ptr_cast_cv_promotion);
+BENCHMARK_WITH_NAME("any_shared_ptr_get< const Derived >(any) - cv-qualifier promotion", BM_v1_get_cv_promotion);
+BENCHMARK_WITH_NAME("any_ptr_cast< const Derived >(any.view()) - cv-qualifier promotion", BM_v1_view_cv_promotion);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_get< const Derived >(any) - cv-qualifier promotion", BM_v2_get_cv_promotion);
+BENCHMARK_WITH_NAME("v3::any_shared_ptr_get< const Derived >(any) - cv-qualifier promotion", BM_v3_get_cv_promotion);
+BENCHMARK_WITH_NAME("any_shared_ptr_cast< const Derived >(any) - cv-qualifier promotion", BM_v1_cast_cv_promotion);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_up_cast(benchmark::State& state) { any_ptr_cast<Base>(state); }
+static void BM_v1_get_up_cast(benchmark::State& state) { any_shared_ptr_get<Base>(state, our_v1); }
+static void BM_v1_view_up_cast(benchmark::State& state) { any_ptr_cast_of_view<Base>(state, our_v1); }
+static void BM_v2_get_up_cast(benchmark::State& state) { any_shared_ptr_get<Base>(state, our_v2); }
+static void BM_v3_get_up_cast(benchmark::State& state) { any_shared_ptr_get<Base>(state, our_v3); }
+static void BM_v1_up_cast(benchmark::State& state) { any_shared_ptr_cast<Base>(state, our_v1); }
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Base >(any) - up cast", BM_any_ptr_up_cast);
+BENCHMARK_WITH_NAME("any_shared_ptr_get< Base >(any) - up cast", BM_v1_get_up_cast);
+BENCHMARK_WITH_NAME("any_ptr_cast< Base >(any.view()) - up cast", BM_v1_view_up_cast);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_get< Base >(any) - up cast", BM_v2_get_up_cast);
+BENCHMARK_WITH_NAME("v3::any_shared_ptr_get< Base >(any) - up cast", BM_v3_get_up_cast);
+BENCHMARK_WITH_NAME("any_shared_ptr_cast< Base >(any) - up cast", BM_v1_up_cast);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_shared_ptr.h>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A consume-style pipeline i.e. a stage hands a queue of any_shared_ptr to the next stage which 
+// casts each one to the shared_ptr<T> that it keeps, and then drops the queue. The copying cast 
+// adds a reference that's dropped with the queue whereas the moving cast takes over the reference.
+
+namespace {
+
+  // libstdc++ uses a non-atomic count for a shared_ptr until the process starts a 2nd thread
+  // (see __libc_single_threaded), whereas a pipeline's stages run on different threads.
+  void start_a_thread() {
+    static const bool our_is_started = (std::thread([] {}).join(), true);
+    benchmark::DoNotOptimize(our_is_started);
+  }
+
+  struct Base { int value{ 42 }; };
+  struct Derived : public Base {};
+
+  constexpr int our_count = 1000;
+
+  template<typename AnySharedPtr>
+  std::vector<AnySharedPtr> make_queue() {
+    std::vector<AnySharedPtr> queue;
+    queue.reserve(our_count);
+    for (int i = 0; i < our_count; ++i) {
+      queue.emplace_back(std::make_shared<Derived>());
+    }
+    return queue;
+  }
+
+  // Refills the queue from what the consumer kept, which is the same for both kinds of consumer
+  template<typename AnySharedPtr, typename T>
+  void refill(std::vector<AnySharedPtr> & queue, std::vector<std::shared_ptr<T>> & kept) {
+    queue.clear();
+    for (std::shared_ptr<T> & ptr : kept) {
+      queue.emplace_back(std::static_pointer_cast<Derived>(std::move(ptr)));
+    }
+    kept.clear();
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void copy_consume(benchmark::State& state) {
+    start_a_thread();
+    std::vector<AnySharedPtr> queue = make_queue<AnySharedPtr>();
+    std::vector<std::shared_ptr<T>> kept;
+    kept.reserve(our_count);
+    while (state.KeepRunning()) {
+      for (const AnySharedPtr & any : queue) {
+        using xxx::any_shared_ptr_cast; // finds the casts of the same name in namespace v2 
+        kept.push_back(any_shared_ptr_cast<T>(any));
+      }
+      benchmark::DoNotOptimize(kept.data());
+      refill(queue, kept);
+    }
+    state.SetItemsProcessed(state.iterations() * our_count);
+  }
+
+  template<typename T, typename AnySharedPtr>
+  void move_consume(benchmark::State& state) {
+    start_a_thread();
+    std::vector<AnySharedPtr> queue = make_queue<AnySharedPtr>();
+    std::vector<std::shared_ptr<T>> kept;
+    kept.reserve(our_count);
+    while (state.KeepRunning()) {
+      for (AnySharedPtr & any : queue) {
+        using xxx::any_shared_ptr_cast; // finds the casts of the same name in namespace v2 
+        kept.push_back(any_shared_ptr_cast<T>(std::move(any)));
+      }
+      benchmark::DoNotOptimize(kept.data());
+      refill(queue, kept);
+    }
+    state.SetItemsProcessed(state.iterations() * our_count);
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_copy_consume(benchmark::State& state) { copy_consume<Derived, xxx::v1::any_shared_ptr>(state); }
+static void BM_v1_move_consume(benchmark::State& state) { move_consume<Derived, xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_copy_consume(benchmark::State& state) { copy_consume<Derived, xxx::v2::any_shared_ptr>(state); }
+static void BM_v2_move_consume(benchmark::State& state) { move_consume<Derived, xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr consume 1000 x any_shared_ptr_cast< Derived >(const &) - cast to same type", BM_v1_copy_consume);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr consume 1000 x any_shared_ptr_cast< Derived >(&&) - cast to same type", BM_v1_move_consume);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr consume 1000 x any_shared_ptr_cast< Derived >(const &) - cast to same type", BM_v2_copy_consume);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr consume 1000 x any_shared_ptr_cast< Derived >(&&) - cast to same type", BM_v2_move_consume);
+
+//-----------------------------------------------------------------------------
+
+static void BM_v1_copy_consume_up_cast(benchmark::State& state) { copy_consume<Base, xxx::v1::any_shared_ptr>(state); }
+static void BM_v1_move_consume_up_cast(benchmark::State& state) { move_consume<Base, xxx::v1::any_shared_ptr>(state); }
+static void BM_v2_copy_consume_up_cast(benchmark::State& state) { copy_consume<Base, xxx::v2::any_shared_ptr>(state); }
+static void BM_v2_move_consume_up_cast(benchmark::State& state) { move_consume<Base, xxx::v2::any_shared_ptr>(state); }
+
+BENCHMARK_WITH_NAME("v1::any_shared_ptr consume 1000 x any_shared_ptr_cast< Base >(const &) - implicit up cast", BM_v1_copy_consume_up_cast);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr consume 1000 x any_shared_ptr_cast< Base >(&&) - implicit up cast", BM_v1_move_consume_up_cast);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr consume 1000 x any_shared_ptr_cast< Base >(const &) - implicit up cast", BM_v2_copy_consume_up_cast);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr consume 1000 x any_shared_ptr_cast< Base >(&&) - implicit up cast", BM_v2_move_consume_up_cast);
+
+//-----------------------------------------------------------------------------
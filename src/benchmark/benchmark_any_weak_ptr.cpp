@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_weak_ptr.h>
+#include <memory>
+
+namespace {
+
+  struct Base { int value{ 42 }; };
+  struct Derived : public Base {};
+
+  const std::shared_ptr<Derived> our_ptr = std::make_shared<Derived>();
+
+  const std::weak_ptr<Derived> our_weak_ptr{ our_ptr };
+  const xxx::any_weak_ptr our_any_weak_ptr{ our_ptr };
+  // Observes the type-erased shared_ptr of an any_shared_ptr, where the held_type provides the weak_ptr<Derived> 
+  const xxx::any_weak_ptr our_erased_any_weak_ptr{ xxx::any_shared_ptr{ our_ptr } };
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_std_weak_ptr_lock(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<Derived> result = our_weak_ptr.lock();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("std::weak_ptr<Derived>::lock()", BM_std_weak_ptr_lock);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_weak_ptr_lock_as(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<Derived> result = our_any_weak_ptr.lock_as<Derived>();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr::lock_as<Derived>() - same type", BM_any_weak_ptr_lock_as);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_weak_ptr_lock_as_cv_promotion(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<const Derived> result = our_any_weak_ptr.lock_as<const Derived>();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr::lock_as<const Derived>() - cv-promotion", BM_any_weak_ptr_lock_as_cv_promotion);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_weak_ptr_lock_as_up_cast(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<Base> result = our_any_weak_ptr.lock_as<Base>();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr::lock_as<Base>() - up cast", BM_any_weak_ptr_lock_as_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_erased_any_weak_ptr_lock_as(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<Derived> result = our_erased_any_weak_ptr.lock_as<Derived>();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr{ any_shared_ptr }.lock_as<Derived>() - same type", BM_erased_any_weak_ptr_lock_as);
+
+static void BM_erased_any_weak_ptr_lock_as_up_cast(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    std::shared_ptr<Base> result = our_erased_any_weak_ptr.lock_as<Base>();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr{ any_shared_ptr }.lock_as<Base>() - up cast", BM_erased_any_weak_ptr_lock_as_up_cast);
+
+//-----------------------------------------------------------------------------
+// The alternative that lock_as() replaces i.e. lock, cast and then copy
+
+static void BM_any_weak_ptr_lock_then_cast(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    const xxx::any_shared_ptr locked = our_any_weak_ptr.lock();
+    std::shared_ptr<Derived> result = xxx::any_shared_ptr_cast<Derived>(locked);
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_shared_ptr_cast<Derived>(any_weak_ptr::lock()) - same type", BM_any_weak_ptr_lock_then_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_weak_ptr_expired(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(our_any_weak_ptr);
+    bool result = our_any_weak_ptr.expired();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK_WITH_NAME("any_weak_ptr::expired()", BM_any_weak_ptr_expired);
+
+//-----------------------------------------------------------------------------
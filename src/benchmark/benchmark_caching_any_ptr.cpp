@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <caching_any_ptr.h>
+#include <sstream>
+#include <memory>
+
+namespace {
+
+  struct Base {};
+  struct Derived : public Base {};
+
+  std::unique_ptr<Derived> our_ptr = std::make_unique<Derived>();
+  xxx::caching_any_ptr our_caching_any_ptr(our_ptr.get());
+
+  bool caching_any_ptr_cast() {
+    return xxx::any_ptr_cast<Derived>(our_caching_any_ptr) != nullptr;
+  }
+
+  // Cached after the 1st iteration
+  bool caching_any_ptr_implicit_up_cast() {
+    return xxx::any_ptr_cast<Base>(our_caching_any_ptr) != nullptr;
+  }
+
+  // The cache holds Base so this is a miss on every iteration
+  bool caching_any_ptr_cast_cv_promotion() {
+    return xxx::any_ptr_cast<const Derived>(our_caching_any_ptr) != nullptr;
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_caching_any_ptr_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = caching_any_ptr_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(caching_any) - same type", BM_caching_any_ptr_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_caching_any_ptr_implicit_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = caching_any_ptr_implicit_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Base >(caching_any) - cached up cast", BM_caching_any_ptr_implicit_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_caching_any_ptr_cast_cv_promotion(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = caching_any_ptr_cast_cv_promotion();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< const Derived >(caching_any) - cache miss", BM_caching_any_ptr_cast_cv_promotion);
+
+//-----------------------------------------------------------------------------
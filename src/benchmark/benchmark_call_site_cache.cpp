@@ -0,0 +1,184 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <sstream>
+#include <memory>
+
+namespace {
+
+  struct Base1 { virtual ~Base1() = default; };
+  struct Base2 { virtual ~Base2() = default; };
+  template<int N>
+  struct Derived : public Base1, public Base2 {};
+
+  template<int N>
+  xxx::any_ptr make_any_ptr() {
+    static Derived<N> our_derived;
+    return xxx::any_ptr(&our_derived);
+  }
+
+  // Held types cycled through by the polymorphic and megamorphic call sites
+  const xxx::any_ptr our_any_ptrs[] = { 
+    make_any_ptr<0>(), make_any_ptr<1>(), make_any_ptr<2>(), make_any_ptr<3>(), 
+    make_any_ptr<4>(), make_any_ptr<5>(), make_any_ptr<6>(), make_any_ptr<7>()
+  };
+
+  std::shared_ptr<Derived<0>> our_shared_ptr = std::make_shared<Derived<0>>();
+  xxx::any_shared_ptr our_any_shared_ptr(our_shared_ptr);
+
+  // Warmed up after the 1st iteration
+  bool call_site_hit() {
+    return ANY_PTR_CAST(Base2, our_any_ptrs[0]) != nullptr;
+  }
+
+  // A new cache on every iteration i.e. the cost of warming up a call site 
+  bool call_site_miss() {
+    xxx::call_site_cache<Base2> site;
+    return xxx::any_ptr_cast<Base2>(our_any_ptrs[0], site) != nullptr;
+  }
+
+  // Sees 'count' held types, falling back to the up_cast_cache for those that don't fit in the cache
+  bool call_site_cycle(std::size_t & i, std::size_t count) {
+    i = (i + 1) % count;
+    return ANY_PTR_CAST(Base2, our_any_ptrs[i]) != nullptr;
+  }
+
+  // The same cycle of casts without the call site cache
+  bool any_ptr_cycle(std::size_t & i, std::size_t count) {
+    i = (i + 1) % count;
+    return xxx::any_ptr_cast<Base2>(our_any_ptrs[i]) != nullptr;
+  }
+
+  bool any_shared_ptr_call_site_hit() {
+    return ANY_SHARED_PTR_CAST(Base2, our_any_shared_ptr) != nullptr;
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_call_site_hit(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = call_site_hit();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("ANY_PTR_CAST(Base2, any) - call site hit", BM_call_site_hit);
+
+//-----------------------------------------------------------------------------
+
+static void BM_call_site_miss(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = call_site_miss();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast<Base2>(any, site) - call site miss", BM_call_site_miss);
+
+//-----------------------------------------------------------------------------
+
+static void BM_call_site_polymorphic(benchmark::State& state) {
+  bool result{ false };
+  std::size_t i{ 0 };
+  while (state.KeepRunning()) {
+    result = call_site_cycle(i, 4);
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("ANY_PTR_CAST(Base2, any) - polymorphic call site (4 types)", BM_call_site_polymorphic);
+
+//-----------------------------------------------------------------------------
+
+static void BM_call_site_megamorphic(benchmark::State& state) {
+  bool result{ false };
+  std::size_t i{ 0 };
+  while (state.KeepRunning()) {
+    result = call_site_cycle(i, 8);
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("ANY_PTR_CAST(Base2, any) - megamorphic call site (8 types)", BM_call_site_megamorphic);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_megamorphic(benchmark::State& state) {
+  bool result{ false };
+  std::size_t i{ 0 };
+  while (state.KeepRunning()) {
+    result = any_ptr_cycle(i, 8);
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast<Base2>(any) - 8 types without a call site cache", BM_any_ptr_megamorphic);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_shared_ptr_call_site_hit(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_shared_ptr_call_site_hit();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("ANY_SHARED_PTR_CAST(Base2, any) - call site hit", BM_any_shared_ptr_call_site_hit);
+
+//-----------------------------------------------------------------------------
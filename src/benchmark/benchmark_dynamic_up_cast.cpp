@@ -0,0 +1,164 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <dynamic_up_cast.h>
+#include <sstream>
+#include <memory>
+
+using namespace xxx;
+
+namespace {
+
+  struct Base1 { virtual ~Base1() = default; };
+  struct Base2 { virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct Top { virtual ~Top() = default; };
+  struct Left : public virtual Top {};
+  struct Right : public virtual Top {};
+  struct Diamond : public Left, public Right {};
+
+  std::unique_ptr<Derived> our_derived = std::make_unique<Derived>();
+  std::unique_ptr<Diamond> our_diamond = std::make_unique<Diamond>();
+
+  // Compare the portable try/catch engine with the engine that walks the Itanium ABI's RTTI
+  template<typename U, typename T>
+  bool throw_up_cast(T* p) {
+    void * ptr = p;
+    return detail::throw_up_cast<U>(&detail::throw_pointer<T>, ptr) != up_cast_result::failed && ptr != nullptr;
+  }
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+  template<typename U, typename T>
+  bool rtti_up_cast(T* p) {
+    void * ptr = p;
+    return detail::rtti_up_cast(typeid(T*), typeid(U*), ptr) != up_cast_result::failed && ptr != nullptr;
+  }
+#endif
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_throw_up_cast_multiple_inheritance(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = throw_up_cast<Base2>(our_derived.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("throw_up_cast< Base2 >(Derived*) - multiple inheritance", BM_throw_up_cast_multiple_inheritance);
+
+//-----------------------------------------------------------------------------
+
+static void BM_throw_up_cast_virtual_base(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = throw_up_cast<Top>(our_diamond.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("throw_up_cast< Top >(Diamond*) - virtual base", BM_throw_up_cast_virtual_base);
+
+//-----------------------------------------------------------------------------
+
+static void BM_throw_up_cast_bad_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = !throw_up_cast<int>(our_derived.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("throw_up_cast< int >(Derived*) - bad cast", BM_throw_up_cast_bad_cast);
+
+//-----------------------------------------------------------------------------
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+
+static void BM_rtti_up_cast_multiple_inheritance(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = rtti_up_cast<Base2>(our_derived.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("rtti_up_cast< Base2 >(Derived*) - multiple inheritance", BM_rtti_up_cast_multiple_inheritance);
+
+//-----------------------------------------------------------------------------
+
+static void BM_rtti_up_cast_virtual_base(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = rtti_up_cast<Top>(our_diamond.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("rtti_up_cast< Top >(Diamond*) - virtual base", BM_rtti_up_cast_virtual_base);
+
+//-----------------------------------------------------------------------------
+
+static void BM_rtti_up_cast_bad_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = !rtti_up_cast<int>(our_derived.get());
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("rtti_up_cast< int >(Derived*) - bad cast", BM_rtti_up_cast_bad_cast);
+
+#endif // ANY_PTR_HAS_ITANIUM_RTTI
+//-----------------------------------------------------------------------------
@@ -0,0 +1,39 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#pragma once
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+
+// The types shared by the benchmarks and the plugin built by benchmark_plugin.cpp, which is 
+// loaded with RTLD_LOCAL and built with hidden visibility so that it has its own type_info objects.
+namespace benchmark_plugin { namespace widgets { namespace controls {
+
+  struct Widget { int w{ 1 }; virtual ~Widget() = default; };
+  struct Clickable { int c{ 2 }; virtual ~Clickable() = default; };
+  struct Button : public Widget, public Clickable {};
+  struct Slider : public Widget {};
+
+} } } // namespace benchmark_plugin::widgets::controls
+
+// The signature of the plugin's function "make_plugin_button" that returns an any_ptr and an 
+// any_shared_ptr to a Button created by the plugin
+using make_plugin_button_func = void(xxx::any_ptr & any, xxx::v2::any_shared_ptr & any_shared);
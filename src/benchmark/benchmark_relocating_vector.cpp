@@ -0,0 +1,108 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_shared_ptr.h>
+#include <relocating_vector.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  struct Derived { int value{ 42 }; };
+
+  // The number of elements
+  constexpr std::size_t our_size = 1000000;
+
+  const std::shared_ptr<Derived> our_ptr = std::make_shared<Derived>();
+
+  // Returns a full vector of 'our_size' handles i.e. the next insertion reallocates
+  template<typename Vector>
+  Vector make_full_vector() {
+    Vector handles;
+    handles.reserve(our_size);
+    for (std::size_t i = 0; i < our_size; ++i) {
+      handles.emplace_back(our_ptr);
+    }
+    return handles;
+  }
+
+  // Measures the reallocation of a full vector of 'our_size' handles.
+  // Note the page faults of the new storage can dominate if the allocator returns the storage to the OS 
+  // on every iteration, e.g. with glibc run with GLIBC_TUNABLES=glibc.malloc.mmap_threshold=4294967295
+  template<typename Vector>
+  void reallocate(benchmark::State& state) {
+    while (state.KeepRunning()) {
+      state.PauseTiming();
+      {
+        Vector handles = make_full_vector<Vector>();
+        state.ResumeTiming();
+        handles.reserve(2 * our_size);
+        benchmark::DoNotOptimize(handles.data());
+        state.PauseTiming();
+      }
+      state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(our_size));
+  }
+
+  // Measures the erase of the first element of a vector of 'our_size' handles
+  template<typename Vector>
+  void erase_front(benchmark::State& state) {
+    Vector handles = make_full_vector<Vector>();
+    while (state.KeepRunning()) {
+      handles.erase(handles.begin());
+      state.PauseTiming();
+      handles.emplace_back(our_ptr);
+      state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(our_size));
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_std_vector_v1_reallocate(benchmark::State& state) { reallocate<std::vector<xxx::v1::any_shared_ptr>>(state); }
+static void BM_std_vector_v2_reallocate(benchmark::State& state) { reallocate<std::vector<xxx::v2::any_shared_ptr>>(state); }
+static void BM_relocating_vector_v1_reallocate(benchmark::State& state) { reallocate<xxx::v1::any_shared_ptr_vector>(state); }
+static void BM_relocating_vector_v2_reallocate(benchmark::State& state) { reallocate<xxx::v2::any_shared_ptr_vector>(state); }
+
+BENCHMARK_WITH_NAME("std::vector<v1::any_shared_ptr> reallocation of 10^6 elements", BM_std_vector_v1_reallocate);
+BENCHMARK_WITH_NAME("std::vector<v2::any_shared_ptr> reallocation of 10^6 elements", BM_std_vector_v2_reallocate);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr_vector reallocation of 10^6 elements", BM_relocating_vector_v1_reallocate);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_vector reallocation of 10^6 elements", BM_relocating_vector_v2_reallocate);
+
+//-----------------------------------------------------------------------------
+
+static void BM_std_vector_v1_erase_front(benchmark::State& state) { erase_front<std::vector<xxx::v1::any_shared_ptr>>(state); }
+static void BM_std_vector_v2_erase_front(benchmark::State& state) { erase_front<std::vector<xxx::v2::any_shared_ptr>>(state); }
+static void BM_relocating_vector_v1_erase_front(benchmark::State& state) { erase_front<xxx::v1::any_shared_ptr_vector>(state); }
+static void BM_relocating_vector_v2_erase_front(benchmark::State& state) { erase_front<xxx::v2::any_shared_ptr_vector>(state); }
+
+BENCHMARK_WITH_NAME("std::vector<v1::any_shared_ptr> erase of the first of 10^6 elements", BM_std_vector_v1_erase_front);
+BENCHMARK_WITH_NAME("std::vector<v2::any_shared_ptr> erase of the first of 10^6 elements", BM_std_vector_v2_erase_front);
+BENCHMARK_WITH_NAME("v1::any_shared_ptr_vector erase of the first of 10^6 elements", BM_relocating_vector_v1_erase_front);
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_vector erase of the first of 10^6 elements", BM_relocating_vector_v2_erase_front);
+
+//-----------------------------------------------------------------------------
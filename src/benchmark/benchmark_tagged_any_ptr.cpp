@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <tagged_any_ptr.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  struct Base { int value{ 1 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+  // The number of elements
+  constexpr std::size_t our_size = 10000000;
+
+  std::unique_ptr<Derived> our_derived = std::make_unique<Derived>();
+
+  template<typename AnyPtr>
+  void any_ptr_bandwidth(benchmark::State& state) {
+    const std::vector<AnyPtr> any_ptrs(our_size, AnyPtr{ our_derived.get() });
+    int sum{ 0 };
+    while (state.KeepRunning()) {
+      for (const AnyPtr & any : any_ptrs) {
+        sum += xxx::any_ptr_cast<Derived>(any)->value;
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(our_size * sizeof(AnyPtr)));
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(our_size));
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_10M(benchmark::State& state) {
+  any_ptr_bandwidth<xxx::any_ptr>(state);
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any) - vector<any_ptr> of 10M elements", BM_any_ptr_10M);
+
+//-----------------------------------------------------------------------------
+
+static void BM_tagged_any_ptr_10M(benchmark::State& state) {
+  any_ptr_bandwidth<xxx::tagged_any_ptr>(state);
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Derived >(any) - vector<tagged_any_ptr> of 10M elements", BM_tagged_any_ptr_10M);
+
+//-----------------------------------------------------------------------------
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <sstream>
+#include <memory>
+
+// The plugin is only built on platforms with dlopen - see CMakeLists.txt
+#ifdef ANY_PTR_PLUGIN_PATH
+
+#include <dlfcn.h>
+#include "benchmark_plugin.h"
+
+namespace {
+
+  using namespace benchmark_plugin::widgets::controls;
+
+  struct plugin
+  {
+    xxx::any_ptr              any;
+    xxx::v2::any_shared_ptr   any_shared;
+
+    plugin() {
+      // The plugin is never unloaded as the held objects and their type_info objects live in it
+      void * const handle = dlopen(ANY_PTR_PLUGIN_PATH, RTLD_NOW | RTLD_LOCAL);
+      if (handle != nullptr) {
+        if (void * const make_button = dlsym(handle, "make_plugin_button")) {
+          reinterpret_cast<make_plugin_button_func*>(make_button)(any, any_shared);
+        }
+      }
+    }
+  };
+
+  const plugin & our_plugin() {
+    static const plugin our_plugin;
+    return our_plugin;
+  }
+
+  Button our_button;
+  xxx::any_ptr our_any_ptr(&our_button);
+  xxx::v2::any_shared_ptr our_any_shared_ptr(std::make_shared<Button>());
+
+  // Labels a benchmark of a cast of 'any' by whether its type_info is a duplicate
+  template<typename Any>
+  std::string label(const Any & any, bool result) {
+    std::stringstream ss;
+    ss << result << (&any.type() != &typeid(Button*) && &any.type() != &typeid(std::shared_ptr<Button>) ? " duplicate type_info" : " same type_info");
+    return ss.str();
+  }
+
+  template<typename T>
+  bool any_ptr_cast_ok(const xxx::any_ptr & any) {
+    return xxx::any_ptr_cast<T>(&any).has_value();
+  }
+
+  template<typename T>
+  bool any_shared_ptr_cast_ok(const xxx::v2::any_shared_ptr & any) {
+    return xxx::v2::any_shared_ptr_cast<T>(&any).has_value();
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast_local_same_type(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cast_ok<Button>(our_any_ptr);
+  }
+  state.SetLabel(label(our_any_ptr, result));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Button >(any) - same type", BM_any_ptr_cast_local_same_type);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast_plugin_same_type(benchmark::State& state) {
+  const xxx::any_ptr & any = our_plugin().any;
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cast_ok<Button>(any);
+  }
+  state.SetLabel(label(any, result));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Button >(any) - same type from an RTLD_LOCAL plugin", BM_any_ptr_cast_plugin_same_type);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast_plugin_other_type(benchmark::State& state) {
+  const xxx::any_ptr & any = our_plugin().any;
+  bool result{ true };
+  while (state.KeepRunning()) {
+    result = any_ptr_cast_ok<Slider>(any);
+  }
+  state.SetLabel(label(any, result));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Slider >(&any) - other type from an RTLD_LOCAL plugin", BM_any_ptr_cast_plugin_other_type);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cast_plugin_up_cast(benchmark::State& state) {
+  const xxx::any_ptr & any = our_plugin().any;
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cast_ok<Clickable>(any);
+  }
+  state.SetLabel(label(any, result));
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Clickable >(any) - up cast from an RTLD_LOCAL plugin", BM_any_ptr_cast_plugin_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_shared_ptr_cast_local_same_type(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_shared_ptr_cast_ok<Button>(our_any_shared_ptr);
+  }
+  state.SetLabel(label(our_any_shared_ptr, result));
+}
+
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_cast< Button >(any) - same type", BM_any_shared_ptr_cast_local_same_type);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_shared_ptr_cast_plugin_same_type(benchmark::State& state) {
+  const xxx::v2::any_shared_ptr & any = our_plugin().any_shared;
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_shared_ptr_cast_ok<Button>(any);
+  }
+  state.SetLabel(label(any, result));
+}
+
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_cast< Button >(any) - same type from an RTLD_LOCAL plugin", BM_any_shared_ptr_cast_plugin_same_type);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_shared_ptr_cast_plugin_other_type(benchmark::State& state) {
+  const xxx::v2::any_shared_ptr & any = our_plugin().any_shared;
+  bool result{ true };
+  while (state.KeepRunning()) {
+    result = any_shared_ptr_cast_ok<Slider>(any);
+  }
+  state.SetLabel(label(any, result));
+}
+
+BENCHMARK_WITH_NAME("v2::any_shared_ptr_cast< Slider >(&any) - other type from an RTLD_LOCAL plugin", BM_any_shared_ptr_cast_plugin_other_type);
+
+//-----------------------------------------------------------------------------
+
+#endif // ANY_PTR_PLUGIN_PATH
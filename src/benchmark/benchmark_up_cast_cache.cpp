@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "benchmark.hpp"
+#include <any_ptr.h>
+#include <sstream>
+#include <memory>
+
+namespace {
+
+  struct Base1 { virtual ~Base1() = default; };
+  struct Base2 { virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct Top { virtual ~Top() = default; };
+  struct Left : public virtual Top {};
+  struct Right : public virtual Top {};
+  struct Diamond : public Left, public Right {};
+
+  std::unique_ptr<Derived> our_derived = std::make_unique<Derived>();
+  std::unique_ptr<Diamond> our_diamond = std::make_unique<Diamond>();
+  xxx::any_ptr our_any_derived(our_derived.get());
+  xxx::any_ptr our_any_diamond(our_diamond.get());
+
+  // Found in the up_cast_cache after the 1st iteration
+  bool any_ptr_cached_up_cast() {
+    return xxx::any_ptr_cast<Base2>(our_any_derived) != nullptr;
+  }
+
+  // Cached as dynamic_offset so the RTTI is walked on every cast
+  bool any_ptr_virtual_base_up_cast() {
+    return xxx::any_ptr_cast<Top>(our_any_diamond) != nullptr;
+  }
+
+  // The noexcept form of any_ptr_cast reports a failed cast without throwing
+  bool any_ptr_cached_failed_probe() {
+    return !xxx::any_ptr_cast<int>(&our_any_derived).has_value();
+  }
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cached_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cached_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Base2 >(any) - cached up cast", BM_any_ptr_cached_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_virtual_base_up_cast(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_virtual_base_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< Top >(any) - virtual base up cast", BM_any_ptr_virtual_base_up_cast);
+
+//-----------------------------------------------------------------------------
+
+static void BM_any_ptr_cached_failed_probe(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cached_failed_probe();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK_WITH_NAME("any_ptr_cast< int >(&any) - cached failed probe", BM_any_ptr_cached_failed_probe);
+
+//-----------------------------------------------------------------------------
+
+// All threads share the same cache entry
+static void BM_any_ptr_cached_up_cast_threads(benchmark::State& state) {
+  bool result{ false };
+  while (state.KeepRunning()) {
+    result = any_ptr_cached_up_cast();
+    assert(result);
+  }
+
+  // Prevent compiler optimizations
+  std::stringstream ss;
+  ss << result;
+  state.SetLabel(ss.str());
+}
+
+BENCHMARK(BM_any_ptr_cached_up_cast_threads)->ThreadRange(1, 64);
+
+//-----------------------------------------------------------------------------
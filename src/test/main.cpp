@@ -21,7 +21,11 @@
 // SOFTWARE.
 #include <gtest/gtest.h>
 #include <any_ptr.h>
+#include <caching_any_ptr.h>
+#include <tagged_any_ptr.h>
+#include <any_unique_ptr.h>
 #include <any_shared_ptr.h>
+#include <any_local_shared_ptr.h>
 #include <iostream>
 #ifdef _MSC_VER
   #include <crtdbg.h>
@@ -31,10 +35,15 @@ int main(int argc, char ** const argv)
 {
   std::cout << "*** any_ptr ****" << '\n';
   std::cout << "sizeof(any_ptr)       = " << sizeof(xxx::any_ptr) << '\n';
+  std::cout << "sizeof(caching_any_ptr) = " << sizeof(xxx::caching_any_ptr) << '\n';
+  std::cout << "sizeof(tagged_any_ptr) = " << sizeof(xxx::tagged_any_ptr) << '\n';
+  std::cout << "sizeof(any_unique_ptr) = " << sizeof(xxx::any_unique_ptr) << '\n';
   std::cout << "*** any_shared_ptr ****" << '\n';
   std::cout << "sizeof(std::shared_ptr<int>)  = " << sizeof(std::shared_ptr<int>) << '\n';
   std::cout << "sizeof(v1::any_shared_ptr)    = " << sizeof(xxx::v1::any_shared_ptr) << '\n';
   std::cout << "sizeof(v2::any_shared_ptr)    = " << sizeof(xxx::v2::any_shared_ptr) << '\n';
+  std::cout << "sizeof(v3::any_shared_ptr)    = " << sizeof(xxx::v3::any_shared_ptr) << '\n';
+  std::cout << "sizeof(any_local_shared_ptr)  = " << sizeof(xxx::any_local_shared_ptr) << '\n';
   std::cout << std::endl;
 
 #ifdef _MSC_VER
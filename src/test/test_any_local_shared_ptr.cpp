@@ -0,0 +1,192 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_local_shared_ptr.h>
+#include <call_site_cache.h>
+#include <memory>
+#include <thread>
+#include <utility>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  // Counts the live instances
+  struct Base1 
+  { 
+    static int our_count;
+    int b1{ 1 }; 
+    Base1() { ++our_count; }
+    virtual ~Base1() { --our_count; } 
+  };
+  int Base1::our_count{ 0 };
+
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 
+  {
+    Derived() = default;
+    explicit Derived(int value) { b2 = value; }
+  };
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+} // namespace
+
+TEST(any_local_shared_ptr, empty)
+{
+  any_local_shared_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any.use_count(), 0);
+  ASSERT_EQ(any.type(), typeid(void));
+  ASSERT_THROW(any_shared_ptr_cast<int>(any), bad_any_shared_ptr_cast);
+  ASSERT_FALSE(any_shared_ptr_cast<int>(&any));
+
+  any_local_shared_ptr from_nullptr{ unique_ptr<int>{} };
+  ASSERT_FALSE(from_nullptr.has_value());
+}
+
+TEST(any_local_shared_ptr, size)
+{
+  ASSERT_EQ(sizeof(any_local_shared_ptr), sizeof(void*));
+  ASSERT_EQ(sizeof(local_shared_ptr<int>), 2 * sizeof(void*));
+  ASSERT_TRUE(is_trivially_relocatable_v<any_local_shared_ptr>);
+}
+
+TEST(any_local_shared_ptr, make_any_local_shared_ptr)
+{
+  {
+    const any_local_shared_ptr any = make_any_local_shared_ptr<Derived>(42);
+    ASSERT_EQ(Base1::our_count, 1);
+    ASSERT_TRUE(any.has_value());
+    ASSERT_EQ(any.type(), typeid(local_shared_ptr<Derived>));
+    ASSERT_EQ(any.type_id(), type_id<local_shared_ptr<Derived>>());
+    ASSERT_EQ(any.use_count(), 1);
+
+    const local_shared_ptr<Derived> derived = any_shared_ptr_cast<Derived>(any);
+    ASSERT_EQ(derived->b2, 42);
+    ASSERT_EQ(any.use_count(), 2);
+    ASSERT_EQ(derived.use_count(), 2);
+  }
+  ASSERT_EQ(Base1::our_count, 0);
+}
+
+TEST(any_local_shared_ptr, adopt_unique_ptr)
+{
+  {
+    any_local_shared_ptr any{ make_unique<Derived>() };
+    ASSERT_EQ(Base1::our_count, 1);
+    local_shared_ptr<Base1> base = any_shared_ptr_cast<Base1>(any);
+    any.reset();
+    ASSERT_EQ(Base1::our_count, 1); // kept alive by the cast
+    ASSERT_EQ(base.use_count(), 1);
+    ASSERT_EQ(base->b1, 1);
+  }
+  ASSERT_EQ(Base1::our_count, 0);
+}
+
+TEST(any_local_shared_ptr, casts)
+{
+  const any_local_shared_ptr any = make_any_local_shared_ptr<Derived>();
+  const Derived * const derived = any_shared_ptr_cast<Derived>(any).get();
+
+  // cv-promotion
+  ASSERT_EQ(any_shared_ptr_cast<const volatile Derived>(any).get(), derived);
+
+  // up cast
+  ASSERT_EQ(any_shared_ptr_cast<Base2>(any).get(), static_cast<const Base2*>(derived));
+  ASSERT_EQ(any_shared_ptr_cast<const Base1>(any).get(), static_cast<const Base1*>(derived));
+
+  // pointer overloads
+  ASSERT_TRUE(any_shared_ptr_cast<Base2>(&any));
+  ASSERT_FALSE(any_shared_ptr_cast<int>(&any));
+  ASSERT_THROW(any_shared_ptr_cast<int>(any), bad_any_shared_ptr_cast);
+
+  // call site cache
+  ASSERT_EQ(static_cast<const Base2*>(derived), ANY_SHARED_PTR_CAST(Base2, any).get());
+  ASSERT_EQ(static_cast<const Base2*>(derived), ANY_SHARED_PTR_CAST(Base2, &any)->get());
+
+  // failed casts don't own the object
+  ASSERT_EQ(any.use_count(), 1);
+}
+
+TEST(any_local_shared_ptr, cv_qualifiers_are_not_dropped)
+{
+  const any_local_shared_ptr any = make_any_local_shared_ptr<const Derived>();
+  ASSERT_EQ(any.type(), typeid(local_shared_ptr<const Derived>));
+  ASSERT_THROW(any_shared_ptr_cast<Derived>(any), bad_any_shared_ptr_cast);
+  ASSERT_THROW(any_shared_ptr_cast<Base1>(any), bad_any_shared_ptr_cast);
+  ASSERT_NE(any_shared_ptr_cast<const Base1>(any), nullptr);
+}
+
+TEST(any_local_shared_ptr, virtual_base)
+{
+  const any_local_shared_ptr any = make_any_local_shared_ptr<VirtualDerived>();
+  const local_shared_ptr<VirtualBase> base = any_shared_ptr_cast<VirtualBase>(any);
+  ASSERT_EQ(base.get(), static_cast<VirtualBase*>(any_shared_ptr_cast<VirtualDerived>(any).get()));
+  ASSERT_EQ(base->v, 3);
+}
+
+TEST(any_local_shared_ptr, copy_move_and_swap)
+{
+  {
+    any_local_shared_ptr any = make_any_local_shared_ptr<Derived>();
+    any_local_shared_ptr copy{ any };
+    ASSERT_EQ(any.use_count(), 2);
+
+    any_local_shared_ptr moved{ std::move(copy) };
+    ASSERT_FALSE(copy.has_value());
+    ASSERT_EQ(any.use_count(), 2);
+
+    any_local_shared_ptr other;
+    std::swap(other, moved);
+    ASSERT_FALSE(moved.has_value());
+    ASSERT_TRUE(other.has_value());
+
+    other = any;
+    ASSERT_EQ(any.use_count(), 2);
+    other = any_local_shared_ptr{};
+    ASSERT_EQ(any.use_count(), 1);
+
+    local_shared_ptr<Base2> base = any_shared_ptr_cast<Base2>(any);
+    local_shared_ptr<Base2> base_copy = base;
+    ASSERT_EQ(any.use_count(), 3);
+    base = std::move(base_copy);
+    ASSERT_EQ(any.use_count(), 2);
+    base.reset();
+    ASSERT_EQ(base, nullptr);
+    ASSERT_EQ(any.use_count(), 1);
+  }
+  ASSERT_EQ(Base1::our_count, 0);
+}
+
+#ifndef NDEBUG
+
+TEST(any_local_shared_ptr, asserts_on_another_thread)
+{
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  const any_local_shared_ptr any = make_any_local_shared_ptr<Derived>();
+  ASSERT_DEATH(std::thread([&any] { any_local_shared_ptr copy{ any }; }).join(), "");
+}
+
+#endif
@@ -0,0 +1,280 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr_bases.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Top { int t{ 0 }; virtual ~Top() = default; };
+  struct Base1 : public Top { int b1{ 1 }; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Unregistered { int u{ 3 }; virtual ~Unregistered() = default; };
+  struct Derived : public Base1, public Base2, public Unregistered {};
+
+  // A non-virtual diamond where Derived has 2 Top subobjects
+  struct Left : public Top {};
+  struct Right : public Top {};
+  struct Diamond : public Left, public Right {};
+
+  // An over-aligned class without a default ctor
+  struct alignas(64) Aligned : public Base2, public Base1 { explicit Aligned(int) {} };
+
+  // Returns the outcome of an up cast to the ancestor 'target' in 'table' where 'offset' is set if it's static
+  up_cast_result find(const detail::base_table & table, const type_info & target, ptrdiff_t & offset)
+  {
+    const detail::ancestor * const base = table.find(target, detail::fingerprint_of(target));
+    if (base == nullptr) {
+      return up_cast_result::unknown;
+    }
+    offset = base->offset;
+    return base->result;
+  }
+
+  // Returns the number of lookups of the process-wide up_cast_cache
+  uint64_t up_cast_cache_lookups()
+  {
+    const up_cast_cache::statistics stats = up_cast_cache::instance().stats();
+    return stats.hits + stats.misses;
+  }
+
+} // namespace
+
+ANY_PTR_BASES(Base1, Top);
+ANY_PTR_BASES(Derived, Base1, Base2);
+ANY_PTR_BASES(Left, Top);
+ANY_PTR_BASES(Right, Top);
+ANY_PTR_BASES(Diamond, Left, Right);
+
+TEST(any_ptr_bases, base_table)
+{
+  const detail::base_table table = detail::base_table_of<Derived>();
+  ASSERT_EQ(table.size, 3u);
+
+  Derived derived;
+  const char * const address = reinterpret_cast<const char*>(&derived);
+  ptrdiff_t offset{ 0 };
+  ASSERT_EQ(find(table, typeid(Base1), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Base1*>(&derived)));
+  ASSERT_EQ(find(table, typeid(Base2), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Base2*>(&derived)));
+  ASSERT_EQ(find(table, typeid(Top), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Top*>(&derived)));
+  ASSERT_EQ(find(table, typeid(Unregistered), offset), up_cast_result::unknown);
+
+  // Types without bases have no table unless it's known by walking the RTTI
+#if !defined(ANY_PTR_HAS_ITANIUM_RTTI) || defined(ANY_PTR_HAS_DIRECT_BASES)
+  ASSERT_EQ(detail::base_table_function<Base2>(), nullptr);
+#endif
+  ASSERT_EQ(detail::base_table_function<int>(), nullptr);
+  // A class whose bases are listed uses the listed bases, even if its RTTI could be walked
+  ASSERT_EQ(detail::base_table_function<const Derived>(), &detail::base_table_of<Derived>);
+}
+
+TEST(any_ptr_bases, base_offset)
+{
+  const Aligned aligned{ 0 };
+  const char * const address = reinterpret_cast<const char*>(&aligned);
+  ASSERT_EQ(address + (detail::base_offset<Aligned, Base1>()), reinterpret_cast<const char*>(static_cast<const Base1*>(&aligned)));
+  ASSERT_EQ(address + (detail::base_offset<Aligned, Base2>()), reinterpret_cast<const char*>(static_cast<const Base2*>(&aligned)));
+  ASSERT_EQ(address + (detail::base_offset<Aligned, Top>()), reinterpret_cast<const char*>(static_cast<const Top*>(&aligned)));
+}
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+
+namespace {
+
+  struct Private : private Base2 {};
+  struct VirtualBase1 : public virtual Base1 {};
+  struct Walked : public Diamond, public Private, public VirtualBase1 {};
+
+} // namespace
+
+TEST(any_ptr_bases, rtti_base_table)
+{
+  // Each ancestor has one entry which records the outcome of an up cast to it
+  const detail::base_table table = detail::rtti_base_table_of<Walked>();
+  ASSERT_EQ(table.size, 8u);
+
+  Walked walked;
+  const char * const address = reinterpret_cast<const char*>(&walked);
+  ptrdiff_t offset{ 0 };
+  ASSERT_EQ(find(table, typeid(Diamond), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Diamond*>(&walked)));
+  ASSERT_EQ(find(table, typeid(Right), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Right*>(&walked)));
+  ASSERT_EQ(find(table, typeid(Private), offset), up_cast_result::static_offset);
+  ASSERT_EQ(address + offset, reinterpret_cast<const char*>(static_cast<Private*>(&walked)));
+  ASSERT_EQ(find(table, typeid(VirtualBase1), offset), up_cast_result::static_offset);
+  // A virtual base is located by the vtable
+  ASSERT_EQ(find(table, typeid(Base1), offset), up_cast_result::dynamic_offset);
+  // A private base
+  ASSERT_EQ(find(table, typeid(Base2), offset), up_cast_result::failed);
+  // An ambiguous base
+  ASSERT_EQ(find(table, typeid(Top), offset), up_cast_result::failed);
+  ASSERT_EQ(find(table, typeid(Walked), offset), up_cast_result::unknown);
+  ASSERT_EQ(find(table, typeid(Unregistered), offset), up_cast_result::unknown);
+
+  const any_ptr any{ &walked };
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Right>(any), static_cast<Right*>(&walked));
+  ASSERT_EQ(any_ptr_cast<const Base1>(any), static_cast<Base1*>(&walked));
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+  ASSERT_THROW(any_ptr_cast<Base2>(any), bad_any_ptr_cast);
+  ASSERT_THROW(any_ptr_cast<Top>(any), bad_any_ptr_cast);
+}
+
+#endif // ANY_PTR_HAS_ITANIUM_RTTI
+
+TEST(any_ptr_bases, registered_up_cast)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Base1>(any), static_cast<Base1*>(&derived));
+  ASSERT_EQ(any_ptr_cast<const Base2>(any), static_cast<Base2*>(&derived));
+  // A transitive ancestor
+  ASSERT_EQ(any_ptr_cast<Top>(any), static_cast<Top*>(&derived));
+  // The casts are resolved without the up_cast_cache
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  // An unregistered base uses the dynamic up cast
+  ASSERT_EQ(any_ptr_cast<Unregistered>(any), static_cast<Unregistered*>(&derived));
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+
+  // A nullptr
+  const any_ptr any_nullptr{ static_cast<Derived*>(nullptr) };
+  ASSERT_EQ(any_ptr_cast<Base2>(any_nullptr), nullptr);
+}
+
+TEST(any_ptr_bases, cv_promotion_violations)
+{
+  const Derived derived;
+  const any_ptr any{ &derived };
+  ASSERT_EQ(any_ptr_cast<const Base2>(any), static_cast<const Base2*>(&derived));
+  ASSERT_EQ(any_ptr_cast<const volatile Top>(any), static_cast<const Top*>(&derived));
+  ASSERT_THROW(any_ptr_cast<Base2>(any), bad_any_ptr_cast);
+  ASSERT_THROW(any_ptr_cast<volatile Top>(any), bad_any_ptr_cast);
+}
+
+TEST(any_ptr_bases, ambiguous_ancestor)
+{
+  Diamond diamond;
+  const any_ptr any{ &diamond };
+  ASSERT_EQ(any_ptr_cast<Left>(any), static_cast<Left*>(&diamond));
+  ASSERT_EQ(any_ptr_cast<Right>(any), static_cast<Right*>(&diamond));
+  ASSERT_THROW(any_ptr_cast<Top>(any), bad_any_ptr_cast);
+}
+
+TEST(any_ptr_bases, any_shared_ptr)
+{
+  const auto derived = make_shared<Derived>();
+  const v1::any_shared_ptr any_v1{ derived };
+  const v2::any_shared_ptr any_v2{ derived };
+
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(v1::any_shared_ptr_cast<Base2>(any_v1), static_pointer_cast<Base2>(derived));
+  ASSERT_EQ(v1::any_shared_ptr_cast<Top>(any_v1), static_pointer_cast<Top>(derived));
+  ASSERT_EQ(v2::any_shared_ptr_cast<Base2>(any_v2), static_pointer_cast<Base2>(derived));
+  ASSERT_EQ(v2::any_shared_ptr_cast<const Top>(any_v2), static_pointer_cast<const Top>(derived));
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  ASSERT_EQ(v2::any_shared_ptr_cast<Unregistered>(any_v2), static_pointer_cast<Unregistered>(derived));
+  ASSERT_EQ(derived.use_count(), 3);
+}
+
+#ifdef ANY_PTR_HAS_DIRECT_BASES
+
+namespace {
+
+  // Unregistered hierarchies where the bases are discovered
+  struct Discovered : public Base1, public Base2, private Unregistered {};
+  struct PublicOnly : public Base2, public Unregistered {};
+
+  struct VirtualLeft : public virtual Top {};
+  struct VirtualRight : public virtual Top {};
+  struct VirtualDiamond : public VirtualLeft, public VirtualRight {};
+
+  // Top is both a non-virtual and a virtual ancestor, so it's ambiguous
+  struct VirtualTop : public virtual Top {};
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winaccessible-base"
+  struct Mixed : public Base1, public VirtualTop {};
+#pragma GCC diagnostic pop
+
+} // namespace
+
+TEST(any_ptr_bases, discovered_bases)
+{
+  ASSERT_EQ(detail::base_table_of<Discovered>().size, 4u);
+
+  Discovered discovered;
+  const any_ptr any{ &discovered };
+
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Base1>(any), static_cast<Base1*>(&discovered));
+  ASSERT_EQ(any_ptr_cast<const Base2>(any), static_cast<Base2*>(&discovered));
+  ASSERT_EQ(any_ptr_cast<Top>(any), static_cast<Top*>(&discovered));
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  // A private base uses the dynamic up cast
+  ASSERT_THROW(any_ptr_cast<Unregistered>(any), bad_any_ptr_cast);
+}
+
+TEST(any_ptr_bases, discovered_table)
+{
+  // A class whose ancestors all have a static offset uses the discovered bases
+  ASSERT_EQ(detail::base_table_function<PublicOnly>(), &detail::base_table_of<PublicOnly>);
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+  // otherwise the RTTI is walked
+  ASSERT_EQ(detail::base_table_function<Discovered>(), &detail::rtti_base_table_of<Discovered>);
+  ASSERT_EQ(detail::base_table_function<VirtualDiamond>(), &detail::rtti_base_table_of<VirtualDiamond>);
+#else
+  ASSERT_EQ(detail::base_table_function<Discovered>(), &detail::base_table_of<Discovered>);
+#endif
+}
+
+TEST(any_ptr_bases, discovered_virtual_bases)
+{
+  VirtualDiamond diamond;
+  const any_ptr any_diamond{ &diamond };
+  ASSERT_EQ(any_ptr_cast<VirtualLeft>(any_diamond), static_cast<VirtualLeft*>(&diamond));
+  ASSERT_EQ(any_ptr_cast<VirtualRight>(any_diamond), static_cast<VirtualRight*>(&diamond));
+  ASSERT_EQ(any_ptr_cast<Top>(any_diamond), static_cast<Top*>(&diamond));
+
+  Mixed mixed;
+  const any_ptr any_mixed{ &mixed };
+  ASSERT_EQ(any_ptr_cast<Base1>(any_mixed), static_cast<Base1*>(&mixed));
+  ASSERT_EQ(any_ptr_cast<VirtualTop>(any_mixed), static_cast<VirtualTop*>(&mixed));
+  ASSERT_THROW(any_ptr_cast<Top>(any_mixed), bad_any_ptr_cast);
+
+  const v2::any_shared_ptr any_shared{ make_shared<VirtualDiamond>() };
+  ASSERT_TRUE(v2::any_shared_ptr_cast<Top>(any_shared));
+}
+
+#endif // ANY_PTR_HAS_DIRECT_BASES
@@ -0,0 +1,153 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+#include <variant>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+  struct Unrelated {};
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+  // Checks that any_shared_ptr_cast_first<Ts...> returns the cast of the first candidate that 
+  // any_shared_ptr_cast succeeds for
+  template<typename AnySharedPtr>
+  void check_cast_first()
+  {
+    using xxx::any_shared_ptr_cast_first; // finds the casts of the same name in namespace v2 and v3 
+
+    const shared_ptr<Derived> derived = make_shared<Derived>();
+    const AnySharedPtr any{ derived };
+
+    const auto up_cast = any_shared_ptr_cast_first<Unrelated, int, Base2, Base1>(any);
+    ASSERT_EQ(up_cast.index(), 3u);
+    ASSERT_EQ(get<3>(up_cast).get(), static_cast<Base2*>(derived.get()));
+    ASSERT_EQ(get<3>(up_cast)->b2, 2);
+
+    const auto same_type = any_shared_ptr_cast_first<Unrelated, const Derived, Base1>(any);
+    ASSERT_EQ(same_type.index(), 2u);
+    ASSERT_EQ(get<2>(same_type), derived);
+    ASSERT_EQ(derived.use_count(), 4);
+
+    ASSERT_EQ((any_shared_ptr_cast_first<Unrelated, int>(any).index()), 0u);
+
+    // cv-qualifiers aren't dropped
+    const AnySharedPtr any_const{ shared_ptr<const Derived>{ derived } };
+    const auto const_cast_first = any_shared_ptr_cast_first<Derived, Base1, const Base1>(any_const);
+    ASSERT_EQ(const_cast_first.index(), 3u);
+    ASSERT_EQ(get<3>(const_cast_first).get(), static_cast<const Base1*>(derived.get()));
+
+    // empty
+    const AnySharedPtr empty;
+    ASSERT_EQ((any_shared_ptr_cast_first<void, Base1>(empty).index()), 0u);
+  }
+
+} // namespace
+
+TEST(any_ptr_cast_first, first_match)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+
+  // repeated to resolve by the up_cast_cache after the first time
+  for (int i = 0; i < 3; ++i) {
+    const auto up_cast = any_ptr_cast_first<Unrelated, Base2, Base1>(any);
+    ASSERT_EQ(up_cast.index(), 2u);
+    ASSERT_EQ(get<2>(up_cast), static_cast<Base2*>(&derived));
+
+    const auto first = any_ptr_cast_first<Base1, Base2>(any);
+    ASSERT_EQ(first.index(), 1u);
+    ASSERT_EQ(get<1>(first), static_cast<Base1*>(&derived));
+
+    const auto same_type = any_ptr_cast_first<Unrelated, const volatile Derived, Base1>(any);
+    ASSERT_EQ(same_type.index(), 2u);
+    ASSERT_EQ(get<2>(same_type), &derived);
+
+    const auto to_void = any_ptr_cast_first<Unrelated, void>(any);
+    ASSERT_EQ(to_void.index(), 2u);
+    ASSERT_EQ(get<2>(to_void), static_cast<void*>(&derived));
+  }
+}
+
+TEST(any_ptr_cast_first, no_match)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE((holds_alternative<monostate>(any_ptr_cast_first<Unrelated, int, VirtualBase>(any))));
+  }
+  ASSERT_TRUE((holds_alternative<monostate>(any_ptr_cast_first<Base1>(any_ptr{}))));
+}
+
+TEST(any_ptr_cast_first, cv_qualifiers)
+{
+  const Derived derived;
+  const any_ptr any{ &derived };
+  const auto result = any_ptr_cast_first<Derived, Base2, const Base2>(any);
+  ASSERT_EQ(result.index(), 3u);
+  ASSERT_EQ(get<3>(result), static_cast<const Base2*>(&derived));
+}
+
+TEST(any_ptr_cast_first, virtual_base)
+{
+  VirtualDerived derived;
+  const any_ptr any{ &derived };
+  for (int i = 0; i < 3; ++i) {
+    const auto result = any_ptr_cast_first<Base1, VirtualBase>(any);
+    ASSERT_EQ(result.index(), 2u);
+    ASSERT_EQ(get<2>(result), static_cast<VirtualBase*>(&derived));
+  }
+}
+
+TEST(any_ptr_cast_first, same_as_any_ptr_cast)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+  const auto result = any_ptr_cast_first<Unrelated, Base2>(any);
+  ASSERT_EQ(get<2>(result), any_ptr_cast<Base2>(any));
+  ASSERT_FALSE(any_ptr_cast<Unrelated>(&any));
+}
+
+TEST(any_shared_ptr_cast_first, v1)
+{
+  check_cast_first<v1::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_cast_first, v2)
+{
+  check_cast_first<v2::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_cast_first, v3)
+{
+  check_cast_first<v3::any_shared_ptr>();
+}
@@ -0,0 +1,258 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Shape { int s{ 1 }; virtual ~Shape() = default; };
+  struct Named { int n{ 2 }; virtual ~Named() = default; };
+  struct Circle : public Shape, public Named { int c{ 3 }; };
+  struct Unrelated { virtual ~Unrelated() = default; };
+
+  struct Left : public virtual Shape {};
+  struct Right : public virtual Shape {};
+  struct Diamond : public Left, public Right { int d{ 4 }; };
+
+  // Named is a private base
+  struct Hidden : public Shape, private Named {};
+
+  // Named is an ambiguous base
+  struct NamedLeft : public Named {};
+  struct NamedRight : public Named {};
+  struct Ambiguous : public Shape, public NamedLeft, public NamedRight {};
+
+  struct NonPolymorphic { int p{ 5 }; };
+
+  // The held pointer is to a private base
+  struct PrivateShape : private Shape, public Named 
+  { 
+    Shape * shape() { return this; } 
+  };
+
+  // Cell is an ambiguous base of Grid but is unique from each of its Named subobjects
+  struct Cell : public Named { int c{ 6 }; };
+  struct LeftCell : public Cell {};
+  struct RightCell : public Cell {};
+  struct Grid : public Shape, public LeftCell, public RightCell {};
+
+  // Checks that any_shared_ptr_dynamic_cast<T> has the semantics of dynamic_pointer_cast<T> 
+  // and that the result shares the ownership of the held shared_ptr
+  template<typename AnySharedPtr>
+  void check_dynamic_cast()
+  {
+    using xxx::any_shared_ptr_dynamic_cast; // finds the casts of the same name in namespace v2 and v3 
+
+    const shared_ptr<Circle> circle = make_shared<Circle>();
+    const AnySharedPtr any{ shared_ptr<Shape>{ circle } };
+
+    // up cast
+    const shared_ptr<const Shape> shape = any_shared_ptr_dynamic_cast<const Shape>(any);
+    ASSERT_EQ(shape.get(), static_cast<Shape*>(circle.get()));
+    ASSERT_EQ(circle.use_count(), 3);
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+    // down cast and cross cast
+    for (int i = 0; i < 3; ++i) {
+      const shared_ptr<Circle> down = any_shared_ptr_dynamic_cast<Circle>(any);
+      ASSERT_EQ(down, circle);
+      const auto cross = any_shared_ptr_dynamic_cast<Named>(&any);
+      ASSERT_TRUE(cross);
+      ASSERT_EQ(cross->get(), static_cast<Named*>(circle.get()));
+      ASSERT_EQ((*cross)->n, 2);
+      ASSERT_EQ(circle.use_count(), 5);
+    }
+#endif
+
+    ASSERT_FALSE(any_shared_ptr_dynamic_cast<Unrelated>(&any));
+    ASSERT_THROW(any_shared_ptr_dynamic_cast<Unrelated>(any), bad_any_shared_ptr_cast);
+
+    // cv-qualifiers aren't dropped
+    const AnySharedPtr any_const{ shared_ptr<const Shape>{ circle } };
+    ASSERT_FALSE(any_shared_ptr_dynamic_cast<Named>(&any_const));
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+    ASSERT_EQ(any_shared_ptr_dynamic_cast<const Named>(any_const).get(), static_cast<const Named*>(circle.get()));
+#endif
+
+    // empty
+    const AnySharedPtr empty;
+    ASSERT_FALSE(any_shared_ptr_dynamic_cast<Named>(&empty));
+  }
+
+} // namespace
+
+TEST(any_ptr_dynamic_cast, up_cast)
+{
+  Circle circle;
+  const any_ptr any{ &circle };
+  ASSERT_EQ(any_ptr_dynamic_cast<Named>(any), static_cast<Named*>(&circle));
+  ASSERT_EQ(any_ptr_dynamic_cast<const Shape>(any), static_cast<const Shape*>(&circle));
+  ASSERT_EQ(any_ptr_dynamic_cast<Circle>(any), &circle);
+  ASSERT_EQ(any_ptr_dynamic_cast<void>(any), static_cast<void*>(&circle));
+  ASSERT_EQ(any_ptr_dynamic_cast<Named>(any), any_ptr_cast<Named>(any));
+}
+
+TEST(any_ptr_dynamic_cast, null)
+{
+  Shape * const shape{ nullptr };
+  const any_ptr any{ shape };
+  const auto result = any_ptr_dynamic_cast<Named>(&any);
+  ASSERT_TRUE(result);
+  ASSERT_EQ(*result, nullptr);
+  const any_ptr empty;
+  ASSERT_FALSE(any_ptr_dynamic_cast<Named>(&empty));
+}
+
+TEST(any_ptr_dynamic_cast, no_match)
+{
+  Circle circle;
+  const any_ptr any{ static_cast<Shape*>(&circle) };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_FALSE(any_ptr_dynamic_cast<Unrelated>(&any));
+    ASSERT_FALSE(any_ptr_dynamic_cast<Diamond>(&any));
+    ASSERT_FALSE(any_ptr_dynamic_cast<int>(&any));
+    ASSERT_THROW(any_ptr_dynamic_cast<Unrelated>(any), bad_any_ptr_cast);
+  }
+
+  // the held pointer isn't to a polymorphic class
+  NonPolymorphic non_polymorphic;
+  const any_ptr any_non_polymorphic{ &non_polymorphic };
+  ASSERT_FALSE(any_ptr_dynamic_cast<Shape>(&any_non_polymorphic));
+}
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+
+TEST(any_ptr_dynamic_cast, down_cast)
+{
+  Circle circle;
+  const any_ptr any{ static_cast<Named*>(&circle) };
+  // repeated to resolve by the up_cast_cache after the first time
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(any_ptr_dynamic_cast<Circle>(any), &circle);
+    ASSERT_EQ(any_ptr_dynamic_cast<Circle>(any)->c, 3);
+  }
+}
+
+TEST(any_ptr_dynamic_cast, cross_cast)
+{
+  Circle circle;
+  const any_ptr any{ static_cast<Shape*>(&circle) };
+  for (int i = 0; i < 3; ++i) {
+    Named * const named = any_ptr_dynamic_cast<Named>(any);
+    ASSERT_EQ(named, dynamic_cast<Named*>(static_cast<Shape*>(&circle)));
+    ASSERT_EQ(named->n, 2);
+  }
+  // as for any_ptr_cast an unrelated object of the same dynamic type is cast by the cached offset
+  Circle other;
+  const any_ptr any_other{ static_cast<Shape*>(&other) };
+  ASSERT_EQ(any_ptr_dynamic_cast<Named>(any_other), static_cast<Named*>(&other));
+}
+
+TEST(any_ptr_dynamic_cast, virtual_base)
+{
+  Diamond diamond;
+  const any_ptr any{ static_cast<Left*>(&diamond) };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(any_ptr_dynamic_cast<Right>(any), static_cast<Right*>(&diamond));
+    ASSERT_EQ(any_ptr_dynamic_cast<Diamond>(any), &diamond);
+  }
+  const any_ptr any_shape{ static_cast<Shape*>(&diamond) };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(any_ptr_dynamic_cast<Diamond>(any_shape), &diamond);
+    ASSERT_EQ(any_ptr_dynamic_cast<Left>(any_shape), static_cast<Left*>(&diamond));
+  }
+}
+
+TEST(any_ptr_dynamic_cast, inaccessible_or_ambiguous)
+{
+  Hidden hidden;
+  const any_ptr any_hidden{ static_cast<Shape*>(&hidden) };
+  Ambiguous ambiguous;
+  const any_ptr any_ambiguous{ static_cast<Shape*>(&ambiguous) };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(dynamic_cast<Named*>(static_cast<Shape*>(&hidden)), nullptr);
+    ASSERT_EQ(dynamic_cast<Named*>(static_cast<Shape*>(&ambiguous)), nullptr);
+    ASSERT_FALSE(any_ptr_dynamic_cast<Named>(&any_hidden));
+    ASSERT_FALSE(any_ptr_dynamic_cast<Named>(&any_ambiguous));
+    ASSERT_EQ(any_ptr_dynamic_cast<NamedLeft>(any_ambiguous), static_cast<NamedLeft*>(&ambiguous));
+  }
+}
+
+TEST(any_ptr_dynamic_cast, held_subobject)
+{
+  // A cross cast from a private base fails as for dynamic_cast
+  PrivateShape private_shape;
+  Shape * const shape = private_shape.shape();
+  const any_ptr any_private{ shape };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(dynamic_cast<Named*>(shape), nullptr);
+    ASSERT_FALSE(any_ptr_dynamic_cast<Named>(&any_private));
+    ASSERT_FALSE(any_ptr_dynamic_cast<PrivateShape>(&any_private));
+  }
+
+  // A down cast to an ambiguous base of the most derived object succeeds if it's unique from the held subobject
+  Grid grid;
+  Named * const left = static_cast<Cell*>(static_cast<LeftCell*>(&grid));
+  Named * const right = static_cast<Cell*>(static_cast<RightCell*>(&grid));
+  const any_ptr any_shape{ static_cast<Shape*>(&grid) };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(any_ptr_dynamic_cast<Cell>(any_ptr{ left }), dynamic_cast<Cell*>(left));
+    ASSERT_EQ(any_ptr_dynamic_cast<Cell>(any_ptr{ right }), dynamic_cast<Cell*>(right));
+    ASSERT_EQ(any_ptr_dynamic_cast<Cell>(any_ptr{ right }), static_cast<Cell*>(static_cast<RightCell*>(&grid)));
+    ASSERT_EQ(any_ptr_dynamic_cast<LeftCell>(any_ptr{ left }), static_cast<LeftCell*>(&grid));
+    ASSERT_EQ(any_ptr_dynamic_cast<Grid>(any_ptr{ right }), &grid);
+    ASSERT_EQ(any_ptr_dynamic_cast<Shape>(any_ptr{ right }), static_cast<Shape*>(&grid));
+    // but a cross cast from an unambiguous base to an ambiguous one fails
+    ASSERT_FALSE(any_ptr_dynamic_cast<Cell>(&any_shape));
+  }
+}
+
+TEST(any_ptr_dynamic_cast, cv_qualifiers)
+{
+  const Circle circle;
+  const any_ptr any{ static_cast<const Shape*>(&circle) };
+  ASSERT_FALSE(any_ptr_dynamic_cast<Named>(&any));
+  ASSERT_EQ(any_ptr_dynamic_cast<const Named>(any), static_cast<const Named*>(&circle));
+  ASSERT_EQ(any_ptr_dynamic_cast<const volatile Circle>(any), &circle);
+}
+
+#endif // ANY_PTR_HAS_ITANIUM_RTTI
+
+TEST(any_shared_ptr_dynamic_cast, v1)
+{
+  check_dynamic_cast<v1::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_dynamic_cast, v2)
+{
+  check_dynamic_cast<v2::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_dynamic_cast, v3)
+{
+  check_dynamic_cast<v3::any_shared_ptr>();
+}
@@ -0,0 +1,216 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr_visit.h>
+#include <memory>
+#include <string>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+  struct MoreDerived : public Derived {};
+  struct Unrelated {};
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+  // Visits with an overload per alternative and a generic fallback
+  string visit_name(const any_ptr & any)
+  {
+    return any_ptr_visit(any, overloaded{
+      [](Derived &) { return string{ "Derived" }; },
+      [](Base2 & base) { return "Base2 " + to_string(base.b2); },
+      [](const Base1 & base) { return "const Base1 " + to_string(base.b1); },
+      [](VirtualBase & base) { return "VirtualBase " + to_string(base.v); },
+      [](auto &) { return string{ "other" }; }
+    });
+  }
+
+} // namespace
+
+TEST(any_ptr_visit, most_derived_alternative)
+{
+  Derived derived;
+  MoreDerived more_derived;
+  const Derived const_derived;
+
+  // repeated to visit by the resolved visit after the first time
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(visit_name(any_ptr{ &derived }), "Derived");
+    ASSERT_EQ(visit_name(any_ptr{ &more_derived }), "Derived");
+    ASSERT_EQ(visit_name(any_ptr{ static_cast<Base2*>(&derived) }), "Base2 2");
+    ASSERT_EQ(visit_name(any_ptr{ static_cast<Base1*>(&derived) }), "const Base1 1");
+    // cv-qualifiers aren't dropped
+    ASSERT_EQ(visit_name(any_ptr{ &const_derived }), "const Base1 1");
+  }
+}
+
+TEST(any_ptr_visit, adjusts_the_held_pointer)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+  for (int i = 0; i < 3; ++i) {
+    Base2 * visited = any_ptr_visit(any, overloaded{ [](Base2 & base) { return &base; }, [](Unrelated &) { return static_cast<Base2*>(nullptr); } });
+    ASSERT_EQ(visited, static_cast<Base2*>(&derived));
+  }
+}
+
+TEST(any_ptr_visit, virtual_base)
+{
+  VirtualDerived derived1;
+  VirtualDerived derived2;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(visit_name(any_ptr{ &derived1 }), "VirtualBase 3");
+    VirtualBase * visited = any_ptr_visit(any_ptr{ &derived2 }, [](VirtualBase & base) { return &base; });
+    ASSERT_EQ(visited, static_cast<VirtualBase*>(&derived2));
+  }
+}
+
+TEST(any_ptr_visit, no_alternative)
+{
+  Unrelated unrelated;
+  int i{ 0 };
+  ASSERT_EQ(visit_name(any_ptr{ &unrelated }), "other");
+  ASSERT_EQ(visit_name(any_ptr{ &i }), "other");
+  ASSERT_EQ(visit_name(any_ptr{}), "other");
+  ASSERT_EQ(visit_name(any_ptr{ static_cast<Derived*>(nullptr) }), "other");
+
+  // without a fallback
+  auto visitor = [](Base1 &) { return 1; };
+  ASSERT_THROW(any_ptr_visit(any_ptr{ &unrelated }, visitor), bad_any_ptr_cast);
+  ASSERT_THROW(any_ptr_visit(any_ptr{}, visitor), bad_any_ptr_cast);
+}
+
+TEST(any_ptr_visit, explicit_alternatives)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+  struct visitor
+  {
+    int operator()(Base1 &) const { return 1; }
+    int operator()(Base2 &) const { return 2; }
+    int operator()(const any_ptr &) const { return 0; }
+  };
+  ASSERT_EQ((any_ptr_visit<Base2, Base1>(any, visitor{})), 2);
+  ASSERT_EQ((any_ptr_visit<Base1, Base2>(any, visitor{})), 1);
+  ASSERT_EQ((any_ptr_visit<Base1>(any_ptr{ static_cast<Base2*>(&derived) }, visitor{})), 0);
+  ASSERT_EQ(any_ptr_visit(any, visitor{}), 0);
+
+  // A visitor whose alternatives can't be found must be given them, as it can't be invoked with the any_ptr
+  struct no_fallback
+  {
+    int operator()(Base1 &) const { return 1; }
+    int operator()(Base2 &) const { return 2; }
+  };
+  static_assert(!detail::has_visit_alternatives_v<no_fallback>, "");
+  static_assert(detail::has_visit_alternatives_v<visitor>, "");
+  auto lambda = [](Base1 &) { return 1; };
+  static_assert(detail::has_visit_alternatives_v<decltype(lambda)>, "");
+  ASSERT_EQ((any_ptr_visit<Base1, Base2>(any, no_fallback{})), 1);
+}
+
+TEST(any_ptr_visit, any_shared_ptr)
+{
+  const shared_ptr<MoreDerived> ptr = make_shared<MoreDerived>();
+  auto visitor = overloaded{ [](Base2 & base) { return &base; }, [](auto &) { return static_cast<Base2*>(nullptr); } };
+  ASSERT_EQ(any_ptr_visit(v1::any_shared_ptr{ ptr }, visitor), static_cast<Base2*>(ptr.get()));
+  ASSERT_EQ(any_ptr_visit(v2::any_shared_ptr{ ptr }, visitor), static_cast<Base2*>(ptr.get()));
+  ASSERT_EQ(any_ptr_visit(v3::any_shared_ptr{ ptr }, visitor), static_cast<Base2*>(ptr.get()));
+  ASSERT_EQ(any_ptr_visit(v2::any_shared_ptr{}, visitor), nullptr);
+  ASSERT_EQ(ptr.use_count(), 1);
+}
+
+namespace {
+
+  struct Body { virtual ~Body() = default; };
+  struct Ship : public Body { int id{ 1 }; };
+  struct Asteroid : public Body { int id{ 2 }; };
+  struct Moon : public virtual Body { int id{ 3 }; };
+
+  string collide(const any_ptr & first, const any_ptr & second)
+  {
+    return any_ptr_visit2(first, second,
+      [](Ship &, Asteroid &) { return string{ "Ship Asteroid" }; },
+      [](Ship &, Body &) { return string{ "Ship Body" }; },
+      [](Body &, Asteroid & asteroid) { return "Body Asteroid " + to_string(asteroid.id); },
+      [](Body &, Body &) { return string{ "Body Body" }; },
+      [](const any_ptr &, const any_ptr &) { return string{ "other" }; });
+  }
+
+} // namespace
+
+TEST(any_ptr_visit2, most_specific_handler)
+{
+  Ship ship;
+  Asteroid asteroid;
+  Moon moon;
+
+  // repeated to visit by the resolved visit after the first time
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(collide(any_ptr{ &ship }, any_ptr{ &asteroid }), "Ship Asteroid");
+    ASSERT_EQ(collide(any_ptr{ &ship }, any_ptr{ &ship }), "Ship Body");
+    ASSERT_EQ(collide(any_ptr{ &asteroid }, any_ptr{ &asteroid }), "Body Asteroid 2");
+    ASSERT_EQ(collide(any_ptr{ &asteroid }, any_ptr{ &ship }), "Body Body");
+    ASSERT_EQ(collide(any_ptr{ static_cast<Body*>(&ship) }, any_ptr{ &asteroid }), "Body Asteroid 2");
+    ASSERT_EQ(collide(any_ptr{ &moon }, any_ptr{ &moon }), "Body Body");
+  }
+}
+
+TEST(any_ptr_visit2, adjusts_the_held_pointers)
+{
+  Derived derived;
+  VirtualDerived virtual_derived;
+  for (int i = 0; i < 3; ++i) {
+    const auto visited = any_ptr_visit2(any_ptr{ &derived }, any_ptr{ &virtual_derived },
+      [](Base2 & base2, VirtualBase & virtual_base) { return make_pair(&base2, &virtual_base); });
+    ASSERT_EQ(visited.first, static_cast<Base2*>(&derived));
+    ASSERT_EQ(visited.second, static_cast<VirtualBase*>(&virtual_derived));
+
+    const auto reversed = any_ptr_visit2(any_ptr{ &virtual_derived }, any_ptr{ &derived },
+      [](VirtualBase & virtual_base, Base2 & base2) { return make_pair(&base2, &virtual_base); });
+    ASSERT_EQ(reversed.first, static_cast<Base2*>(&derived));
+    ASSERT_EQ(reversed.second, static_cast<VirtualBase*>(&virtual_derived));
+  }
+}
+
+TEST(any_ptr_visit2, no_alternative)
+{
+  Ship ship;
+  Unrelated unrelated;
+  ASSERT_EQ(collide(any_ptr{ &ship }, any_ptr{ &unrelated }), "other");
+  ASSERT_EQ(collide(any_ptr{}, any_ptr{ &ship }), "other");
+  ASSERT_EQ(collide(any_ptr{ &ship }, any_ptr{ static_cast<Asteroid*>(nullptr) }), "other");
+
+  // cv-qualifiers aren't dropped
+  const Ship const_ship;
+  ASSERT_EQ(collide(any_ptr{ &const_ship }, any_ptr{ &ship }), "other");
+
+  // without a fallback
+  auto handler = [](Ship &, Ship &) { return 0; };
+  ASSERT_THROW(any_ptr_visit2(any_ptr{ &ship }, any_ptr{ &unrelated }, handler), bad_any_ptr_cast);
+  ASSERT_EQ(any_ptr_visit2(any_ptr{ &ship }, any_ptr{ &ship }, handler), 0);
+}
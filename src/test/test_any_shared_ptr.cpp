@@ -21,6 +21,7 @@
 // SOFTWARE.
 #include <gtest/gtest.h>
 #include <any_shared_ptr.h>
+#include <cstring>
 #include <type_traits>
 
 using namespace xxx;
@@ -40,6 +41,24 @@ TEST(any_shared_ptr, empty)
   EXPECT_THROW(any_shared_ptr_cast<int>(any), bad_any_shared_ptr_cast);
 }
 
+TEST(any_shared_ptr, v2_empty_is_all_zero)
+{
+  static_assert(std::is_nothrow_default_constructible<v2::any_shared_ptr>::value, "");
+  const unsigned char zeros[sizeof(v2::any_shared_ptr)]{};
+
+  v2::any_shared_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(memcmp(&any, zeros, sizeof(any)), 0);
+
+  // A moved from instance and a reset instance are also all-zero
+  v2::any_shared_ptr any1{ std::make_shared<int>(42) };
+  v2::any_shared_ptr any2{ std::move(any1) };
+  ASSERT_EQ(memcmp(&any1, zeros, sizeof(any1)), 0);
+  ASSERT_EQ(any2.use_count(), 1);
+  any2.reset();
+  ASSERT_EQ(memcmp(&any2, zeros, sizeof(any2)), 0);
+}
+
 TEST(any_shared_ptr, copy_ctor)
 {
   any_shared_ptr any1{ std::make_shared<int>(42) };
@@ -182,6 +201,16 @@ TEST(any_shared_ptr, move_assignment)
   }
 }
 
+TEST(any_shared_ptr, reset)
+{
+  const shared_ptr<int> ptr = make_shared<int>(42);
+  any_shared_ptr any{ ptr };
+  ASSERT_EQ(ptr.use_count(), 2);
+  any.reset();
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(ptr.use_count(), 1); // the reference is released
+}
+
 TEST(any_shared_ptr, void_nullptr)
 {
   // Check that any_shared_ptr can hold shared_ptr<void> 
@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_shared_ptr.h>
+#include <call_site_cache.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+  // Checks that any_shared_ptr_get<T> has the cast semantics of any_shared_ptr_cast<T> 
+  // without changing the reference count
+  template<typename AnySharedPtr>
+  void check_get()
+  {
+    using xxx::any_shared_ptr_get; // finds the casts of the same name in namespace v2 and v3 
+
+    const shared_ptr<Derived> derived = make_shared<Derived>();
+    const AnySharedPtr any{ derived };
+    const long use_count = derived.use_count();
+
+    // same type and cv-promotion
+    ASSERT_EQ(any_shared_ptr_get<Derived>(any), derived.get());
+    ASSERT_EQ(any_shared_ptr_get<const volatile Derived>(any), derived.get());
+
+    // up cast
+    ASSERT_EQ(any_shared_ptr_get<Base2>(any), static_cast<Base2*>(derived.get()));
+    ASSERT_EQ(any_shared_ptr_get<const Base1>(any), static_cast<const Base1*>(derived.get()));
+    ASSERT_EQ(any_shared_ptr_get<Base2>(any)->b2, 2);
+
+    // pointer overloads
+    ASSERT_EQ(*any_shared_ptr_get<Base2>(&any), static_cast<Base2*>(derived.get()));
+    ASSERT_FALSE(any_shared_ptr_get<int>(&any));
+    ASSERT_THROW(any_shared_ptr_get<int>(any), bad_any_shared_ptr_cast);
+
+    // call site cache
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_EQ(static_cast<Base2*>(derived.get()), ANY_SHARED_PTR_GET(Base2, any));
+      ASSERT_EQ(static_cast<Base2*>(derived.get()), *ANY_SHARED_PTR_GET(Base2, &any));
+      ASSERT_FALSE(ANY_SHARED_PTR_GET(int, &any));
+    }
+
+    ASSERT_EQ(derived.use_count(), use_count);
+
+    // cv-qualifiers aren't dropped
+    const AnySharedPtr any_const{ shared_ptr<const Derived>{ derived } };
+    ASSERT_THROW(any_shared_ptr_get<Derived>(any_const), bad_any_shared_ptr_cast);
+    ASSERT_THROW(any_shared_ptr_get<Base1>(any_const), bad_any_shared_ptr_cast);
+    ASSERT_EQ(any_shared_ptr_get<const Base1>(any_const), static_cast<const Base1*>(derived.get()));
+
+    // virtual base
+    const shared_ptr<VirtualDerived> virtual_derived = make_shared<VirtualDerived>();
+    const AnySharedPtr any_virtual{ virtual_derived };
+    ASSERT_EQ(any_shared_ptr_get<VirtualBase>(any_virtual), static_cast<VirtualBase*>(virtual_derived.get()));
+
+    // empty
+    const AnySharedPtr empty;
+    ASSERT_THROW(any_shared_ptr_get<void>(empty), bad_any_shared_ptr_cast);
+    ASSERT_THROW(any_shared_ptr_get<Base1>(empty), bad_any_shared_ptr_cast);
+    ASSERT_FALSE(any_shared_ptr_get<Base1>(&empty));
+  }
+
+} // namespace
+
+TEST(any_shared_ptr_get, v1)
+{
+  check_get<v1::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_get, v2)
+{
+  check_get<v2::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_get, v3)
+{
+  check_get<v3::any_shared_ptr>();
+}
@@ -0,0 +1,130 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_shared_ptr.h>
+#include <call_site_cache.h>
+#include <memory>
+#include <utility>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+
+  // Checks that the rvalue any_shared_ptr_cast<T> and any_shared_ptr_move_cast<T> have the cast 
+  // semantics of any_shared_ptr_cast<T> but move the held reference, leaving the source empty, 
+  // only if the cast succeeds
+  template<typename AnySharedPtr>
+  void check_move_cast()
+  {
+    using xxx::any_shared_ptr_cast; // finds the casts of the same name in namespace v2
+    using xxx::any_shared_ptr_move_cast;
+
+    const shared_ptr<Derived> derived = make_shared<Derived>();
+
+    // same type
+    {
+      AnySharedPtr any{ derived };
+      const shared_ptr<Derived> moved = any_shared_ptr_cast<Derived>(std::move(any));
+      ASSERT_EQ(moved, derived);
+      ASSERT_FALSE(moved.owner_before(derived) || derived.owner_before(moved)); // shares the control block
+      ASSERT_EQ(derived.use_count(), 2);
+      ASSERT_FALSE(any.has_value());
+    }
+    // cv-promotion
+    {
+      AnySharedPtr any{ derived };
+      const shared_ptr<const volatile Derived> moved = any_shared_ptr_cast<const volatile Derived>(std::move(any));
+      ASSERT_EQ(moved, derived);
+      ASSERT_FALSE(moved.owner_before(derived) || derived.owner_before(moved));
+      ASSERT_EQ(derived.use_count(), 2);
+      ASSERT_FALSE(any.has_value());
+    }
+    // up cast
+    {
+      AnySharedPtr any{ derived };
+      const shared_ptr<Base2> moved = any_shared_ptr_cast<Base2>(std::move(any));
+      ASSERT_EQ(moved.get(), static_cast<Base2*>(derived.get()));
+      ASSERT_EQ(moved->b2, 2);
+      ASSERT_EQ(derived.use_count(), 2);
+      ASSERT_FALSE(any.has_value());
+    }
+    // failed casts leave the source unchanged
+    {
+      AnySharedPtr any{ derived };
+      ASSERT_THROW(any_shared_ptr_cast<int>(std::move(any)), bad_any_shared_ptr_cast);
+      ASSERT_FALSE(any_shared_ptr_move_cast<int>(&any));
+      ASSERT_TRUE(any.has_value());
+      ASSERT_EQ(derived.use_count(), 2);
+
+      AnySharedPtr any_const{ shared_ptr<const Derived>{ derived } };
+      ASSERT_THROW(any_shared_ptr_cast<Derived>(std::move(any_const)), bad_any_shared_ptr_cast);
+      ASSERT_THROW(any_shared_ptr_cast<Base1>(std::move(any_const)), bad_any_shared_ptr_cast);
+      ASSERT_TRUE(any_const.has_value());
+      ASSERT_EQ(derived.use_count(), 3);
+    }
+    // pointer overloads
+    {
+      AnySharedPtr any{ derived };
+      auto moved = any_shared_ptr_move_cast<Base1>(&any);
+      ASSERT_TRUE(moved);
+      ASSERT_EQ(moved->get(), static_cast<Base1*>(derived.get()));
+      ASSERT_FALSE(any.has_value());
+      ASSERT_FALSE(any_shared_ptr_move_cast<Base1>(&any));
+    }
+    // call site cache
+    {
+      call_site_cache<Base2> site;
+      call_site_cache<int> int_site;
+      for (int i = 0; i < 3; ++i) {
+        AnySharedPtr any{ derived };
+        ASSERT_FALSE(any_shared_ptr_move_cast<int>(&any, int_site));
+        ASSERT_EQ(any_shared_ptr_move_cast<Base2>(&any, site)->get(), static_cast<Base2*>(derived.get()));
+        ASSERT_FALSE(any.has_value());
+        any = AnySharedPtr{ derived };
+        ASSERT_EQ(any_shared_ptr_cast<Base2>(std::move(any), site).get(), static_cast<Base2*>(derived.get()));
+        ASSERT_FALSE(any.has_value());
+      }
+    }
+    ASSERT_EQ(derived.use_count(), 1);
+
+    // empty
+    AnySharedPtr empty;
+    ASSERT_THROW(any_shared_ptr_cast<Base1>(std::move(empty)), bad_any_shared_ptr_cast);
+    ASSERT_FALSE(any_shared_ptr_move_cast<Base1>(&empty));
+  }
+
+} // namespace
+
+TEST(any_shared_ptr_move_cast, v1)
+{
+  check_move_cast<v1::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_move_cast, v2)
+{
+  check_move_cast<v2::any_shared_ptr>();
+}
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <any_local_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+  // Checks that view() is an any_ptr to the held object that's indistinguishable from 
+  // an any_ptr that's constructed from the object's pointer
+  template<typename AnySharedPtr, typename Derived_>
+  void check_view(const AnySharedPtr & any, Derived_ * derived)
+  {
+    const long use_count = any.use_count();
+    const any_ptr view = any.view();
+    const any_ptr expected{ derived };
+    ASSERT_TRUE(view.has_value());
+    ASSERT_EQ(view.type(), expected.type());
+    ASSERT_EQ(view.type_id(), expected.type_id());
+    ASSERT_EQ(any.use_count(), use_count);
+
+    ASSERT_EQ(any_ptr_cast<const volatile Derived>(view), derived);
+    ASSERT_EQ(any_ptr_cast<const Base1>(view), static_cast<const Base1*>(derived));
+    ASSERT_EQ(any_ptr_cast<const Base2>(view), static_cast<const Base2*>(derived));
+    ASSERT_EQ(any_ptr_cast<const Base2>(view)->b2, 2);
+    ASSERT_FALSE(any_ptr_cast<int>(&view));
+    // cv-qualifiers aren't dropped
+    ASSERT_EQ(static_cast<bool>(any_ptr_cast<Derived>(&view)), static_cast<bool>(any_ptr_cast<Derived>(&expected)));
+    ASSERT_EQ(static_cast<bool>(any_ptr_cast<Base1>(&view)), static_cast<bool>(any_ptr_cast<Base1>(&expected)));
+  }
+
+  template<typename AnySharedPtr>
+  void check_views()
+  {
+    const shared_ptr<Derived> derived = make_shared<Derived>();
+    check_view(AnySharedPtr{ derived }, derived.get());
+    check_view(AnySharedPtr{ shared_ptr<const Derived>{ derived } }, static_cast<const Derived*>(derived.get()));
+
+    const shared_ptr<VirtualDerived> virtual_derived = make_shared<VirtualDerived>();
+    const any_ptr view = AnySharedPtr{ virtual_derived }.view();
+    ASSERT_EQ(any_ptr_cast<VirtualBase>(view), static_cast<VirtualBase*>(virtual_derived.get()));
+
+    const any_ptr empty = AnySharedPtr{}.view();
+    ASSERT_FALSE(empty.has_value());
+    ASSERT_EQ(empty.type(), typeid(void));
+  }
+
+} // namespace
+
+TEST(any_shared_ptr_view, v1)
+{
+  check_views<v1::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_view, v2)
+{
+  check_views<v2::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_view, v3)
+{
+  check_views<v3::any_shared_ptr>();
+}
+
+TEST(any_shared_ptr_view, any_local_shared_ptr)
+{
+  const any_local_shared_ptr any = make_any_local_shared_ptr<Derived>();
+  check_view(any, any_shared_ptr_cast<Derived>(any).get());
+  const any_local_shared_ptr any_const = make_any_local_shared_ptr<const Derived>();
+  check_view(any_const, any_shared_ptr_cast<const Derived>(any_const).get());
+  ASSERT_FALSE(any_local_shared_ptr{}.view().has_value());
+}
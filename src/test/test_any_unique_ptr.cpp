@@ -0,0 +1,171 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_unique_ptr.h>
+#include <memory>
+#include <utility>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  // Counts the live instances
+  struct Base1 
+  { 
+    static int our_count;
+    int b1{ 1 }; 
+    Base1() { ++our_count; }
+    virtual ~Base1() { --our_count; } 
+  };
+  int Base1::our_count{ 0 };
+
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+
+  // A deleter with state
+  struct CountingDeleter
+  {
+    int * my_deletes;
+    void operator()(Derived * ptr) const { ++*my_deletes; delete ptr; }
+  };
+
+} // namespace
+
+TEST(any_unique_ptr, empty)
+{
+  any_unique_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(void));
+  ASSERT_FALSE(any.get().has_value());
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+  ASSERT_THROW(any.release_as<int>(), bad_any_ptr_cast);
+}
+
+TEST(any_unique_ptr, size)
+{
+  ASSERT_EQ(sizeof(any_unique_ptr), 2 * sizeof(void*));
+  ASSERT_TRUE(is_trivially_relocatable_v<any_unique_ptr>);
+}
+
+TEST(any_unique_ptr, borrow)
+{
+  {
+    const any_unique_ptr any = make_any_unique_ptr<Derived>();
+    ASSERT_EQ(Base1::our_count, 1);
+    ASSERT_TRUE(any.has_value());
+    ASSERT_EQ(any.type(), typeid(Derived*));
+    ASSERT_EQ(any.type_id(), type_id<Derived*>());
+
+    Derived * const derived = any_ptr_cast<Derived>(any);
+    ASSERT_NE(derived, nullptr);
+    ASSERT_EQ(any_ptr_cast<const Derived>(any), derived);
+    ASSERT_EQ(any_ptr_cast<Base1>(any), derived);
+    ASSERT_EQ(*any_ptr_cast<const Base2>(&any), derived);
+    ASSERT_FALSE(any_ptr_cast<int>(&any));
+    ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+    ASSERT_EQ(any_ptr_cast<Base2>(any.get()), derived);
+  }
+  ASSERT_EQ(Base1::our_count, 0);
+
+  // cv-qualifiers can't be dropped
+  const any_unique_ptr const_any{ unique_ptr<const Derived>{ new Derived } };
+  ASSERT_EQ(const_any.type(), typeid(const Derived*));
+  ASSERT_TRUE(any_ptr_cast<const Base1>(&const_any));
+  ASSERT_FALSE(any_ptr_cast<Base1>(&const_any));
+}
+
+TEST(any_unique_ptr, move_and_reset)
+{
+  any_unique_ptr any = make_any_unique_ptr<Derived>();
+  Derived * const derived = any_ptr_cast<Derived>(any);
+
+  any_unique_ptr moved{ std::move(any) };
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any_ptr_cast<Derived>(moved), derived);
+
+  any = std::move(moved);
+  ASSERT_EQ(any_ptr_cast<Derived>(any), derived);
+  any.swap(moved);
+  ASSERT_EQ(any_ptr_cast<Derived>(moved), derived);
+  ASSERT_EQ(Base1::our_count, 1);
+
+  moved.reset();
+  ASSERT_FALSE(moved.has_value());
+  ASSERT_EQ(Base1::our_count, 0);
+
+  // A held nullptr isn't empty and isn't deleted
+  const any_unique_ptr null_any{ unique_ptr<Derived>{} };
+  ASSERT_TRUE(null_any.has_value());
+  ASSERT_EQ(any_ptr_cast<Base2>(null_any), nullptr);
+}
+
+TEST(any_unique_ptr, release_as)
+{
+  any_unique_ptr any = make_any_unique_ptr<Derived>();
+  Derived * const derived = any_ptr_cast<Derived>(any);
+
+  // A failed cast keeps ownership
+  ASSERT_THROW(any.release_as<int>(), bad_any_ptr_cast);
+  // Base2 doesn't have a virtual destructor
+  ASSERT_THROW(any.release_as<Base2>(), bad_any_ptr_cast);
+  ASSERT_TRUE(any.has_value());
+
+  unique_ptr<Base1> base = any.release_as<Base1>();
+  ASSERT_EQ(base.get(), derived);
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(Base1::our_count, 1);
+  base.reset();
+  ASSERT_EQ(Base1::our_count, 0);
+
+  // The owned type doesn't need a virtual destructor
+  any_unique_ptr any2 = make_any_unique_ptr<Base2>();
+  unique_ptr<const Base2> base2 = any2.release_as<const Base2>();
+  ASSERT_NE(base2, nullptr);
+  ASSERT_FALSE(any2.has_value());
+}
+
+TEST(any_unique_ptr, custom_deleter)
+{
+  int deletes{ 0 };
+  {
+    any_unique_ptr any{ unique_ptr<Derived, CountingDeleter>{ new Derived, CountingDeleter{ &deletes } } };
+    ASSERT_EQ(any.type(), typeid(Derived*));
+    ASSERT_NE(any_ptr_cast<Base2>(any), nullptr);
+    // Only a pointer deleted by std::default_delete can be released
+    ASSERT_THROW(any.release_as<Base1>(), bad_any_ptr_cast);
+
+    any_unique_ptr moved{ std::move(any) };
+    ASSERT_EQ(deletes, 0);
+  }
+  ASSERT_EQ(deletes, 1);
+  ASSERT_EQ(Base1::our_count, 0);
+
+  // A lambda deleter
+  {
+    auto deleter = [&deletes](Derived * ptr) { ++deletes; delete ptr; };
+    const any_unique_ptr any{ unique_ptr<Derived, decltype(deleter)>{ new Derived, deleter } };
+    ASSERT_NE(any_ptr_cast<Base1>(any), nullptr);
+  }
+  ASSERT_EQ(deletes, 2);
+}
@@ -0,0 +1,192 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_weak_ptr.h>
+#include <call_site_cache.h>
+#include <memory>
+#include <utility>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct VirtualBase { int v{ 3 }; };
+  struct VirtualDerived : public virtual VirtualBase {};
+
+} // namespace
+
+TEST(any_weak_ptr, empty)
+{
+  any_weak_ptr weak;
+  ASSERT_FALSE(weak.has_value());
+  ASSERT_TRUE(weak.expired());
+  ASSERT_EQ(weak.use_count(), 0);
+  ASSERT_EQ(weak.type(), typeid(void));
+  ASSERT_FALSE(weak.lock().has_value());
+  ASSERT_EQ(weak.lock_as<int>(), nullptr);
+
+  any_weak_ptr from_empty{ any_shared_ptr{} };
+  ASSERT_FALSE(from_empty.has_value());
+  ASSERT_TRUE(from_empty.expired());
+}
+
+TEST(any_weak_ptr, size)
+{
+  ASSERT_EQ(sizeof(any_weak_ptr), 2 * sizeof(void*) + sizeof(weak_ptr<void>));
+  ASSERT_TRUE(is_trivially_relocatable_v<any_weak_ptr>);
+}
+
+TEST(any_weak_ptr, does_not_own)
+{
+  any_shared_ptr any = make_any_shared_ptr<Derived>();
+  const any_weak_ptr weak{ any };
+  ASSERT_TRUE(weak.has_value());
+  ASSERT_FALSE(weak.expired());
+  ASSERT_EQ(weak.use_count(), 1);
+  ASSERT_EQ(weak.type(), any.type());
+  ASSERT_EQ(weak.type_id(), any.type_id());
+
+  any.reset();
+  ASSERT_TRUE(weak.has_value());
+  ASSERT_TRUE(weak.expired());
+  ASSERT_EQ(weak.use_count(), 0);
+  ASSERT_FALSE(weak.lock().has_value());
+  ASSERT_EQ(weak.lock_as<Derived>(), nullptr);
+  ASSERT_EQ(weak.lock_as<Base1>(), nullptr);
+}
+
+TEST(any_weak_ptr, lock_as)
+{
+  const shared_ptr<Derived> derived = make_shared<Derived>();
+  const any_weak_ptr weak{ any_shared_ptr{ derived } };
+  ASSERT_FALSE(weak.expired());
+
+  // same type and cv-promotion
+  {
+    const shared_ptr<Derived> p = weak.lock_as<Derived>();
+    ASSERT_EQ(p, derived);
+    ASSERT_EQ(derived.use_count(), 2);
+  }
+  ASSERT_EQ(derived.use_count(), 1);
+  ASSERT_EQ(weak.lock_as<const volatile Derived>(), derived);
+
+  // up cast
+  {
+    const shared_ptr<Base2> p = weak.lock_as<Base2>();
+    ASSERT_EQ(p.get(), static_cast<Base2*>(derived.get()));
+    ASSERT_EQ(p->b2, 2);
+    ASSERT_EQ(derived.use_count(), 2);
+  }
+  ASSERT_EQ(weak.lock_as<const Base1>().get(), static_cast<Base1*>(derived.get()));
+
+  // failed casts don't own the object
+  ASSERT_EQ(weak.lock_as<int>(), nullptr);
+  ASSERT_EQ(derived.use_count(), 1);
+}
+
+TEST(any_weak_ptr, typed_from_any_shared_ptr)
+{
+  // The weak_ptr to the object of an any_shared_ptr is a weak_ptr<T> as for a shared_ptr<T>, 
+  // so lock_as<T>() up to cv-qualifiers is a single lock
+  ASSERT_EQ((detail::held_type_v<Derived, shared_ptr<Derived>, shared_ptr<Derived>>.weak_ops), &detail::weak_ptr_ops_v<Derived>);
+  ASSERT_EQ((detail::held_type_v<const Derived, shared_ptr<const Derived>, shared_ptr<Derived>>.weak_ops), &detail::weak_ptr_ops_v<Derived>);
+  ASSERT_EQ((detail::held_type_v<void, shared_ptr<void>, shared_ptr<void>>.weak_ops), &detail::weak_ptr_ops_v<void>);
+  ASSERT_EQ(detail::held_type_v<Derived>.weak_ops, nullptr);
+
+  const shared_ptr<const Derived> derived = make_shared<Derived>();
+  const any_weak_ptr weak{ any_shared_ptr{ derived } };
+  const any_weak_ptr copy{ weak };
+  ASSERT_EQ(copy.use_count(), 1);
+  ASSERT_EQ(copy.lock_as<const Derived>(), derived);
+  ASSERT_EQ(copy.lock_as<Derived>(), nullptr); // drops const
+  ASSERT_EQ(copy.lock().type(), typeid(shared_ptr<const Derived>));
+  ASSERT_EQ(derived.use_count(), 1);
+}
+
+TEST(any_weak_ptr, cv_qualifiers_are_not_dropped)
+{
+  const shared_ptr<const Derived> derived = make_shared<const Derived>();
+  const any_weak_ptr weak{ derived };
+  ASSERT_EQ(weak.type(), typeid(shared_ptr<const Derived>));
+  ASSERT_EQ(weak.lock_as<Derived>(), nullptr);
+  ASSERT_EQ(weak.lock_as<Base1>(), nullptr);
+  ASSERT_EQ(weak.lock_as<const Derived>(), derived);
+  ASSERT_EQ(weak.lock_as<const Base1>().get(), static_cast<const Base1*>(derived.get()));
+}
+
+TEST(any_weak_ptr, virtual_base)
+{
+  const shared_ptr<VirtualDerived> derived = make_shared<VirtualDerived>();
+  const any_weak_ptr weak{ derived };
+  const shared_ptr<VirtualBase> base = weak.lock_as<VirtualBase>();
+  ASSERT_EQ(base.get(), static_cast<VirtualBase*>(derived.get()));
+  ASSERT_EQ(base->v, 3);
+}
+
+TEST(any_weak_ptr, call_site_cache)
+{
+  const shared_ptr<Derived> derived = make_shared<Derived>();
+  const any_weak_ptr weak{ derived };
+  call_site_cache<Base2> site;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(weak.lock_as<Base2>(site).get(), static_cast<Base2*>(derived.get()));
+  }
+  call_site_cache<int> failed_site;
+  ASSERT_EQ(weak.lock_as<int>(failed_site), nullptr);
+}
+
+TEST(any_weak_ptr, lock)
+{
+  const shared_ptr<Derived> derived = make_shared<Derived>();
+  const any_weak_ptr weak{ derived };
+  const any_shared_ptr any = weak.lock();
+  ASSERT_TRUE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(shared_ptr<Derived>));
+  ASSERT_EQ(derived.use_count(), 2);
+  ASSERT_EQ(any_shared_ptr_cast<Base2>(any).get(), static_cast<Base2*>(derived.get()));
+}
+
+TEST(any_weak_ptr, copy_move_and_swap)
+{
+  const shared_ptr<Derived> derived = make_shared<Derived>();
+  any_weak_ptr weak{ derived };
+  any_weak_ptr copy{ weak };
+  ASSERT_EQ(copy.lock_as<Derived>(), derived);
+
+  any_weak_ptr moved{ std::move(copy) };
+  ASSERT_EQ(moved.lock_as<Derived>(), derived);
+
+  any_weak_ptr other;
+  std::swap(other, moved);
+  ASSERT_FALSE(moved.has_value());
+  ASSERT_EQ(other.lock_as<Derived>(), derived);
+
+  other.reset();
+  ASSERT_FALSE(other.has_value());
+  ASSERT_TRUE(other.expired());
+  ASSERT_EQ(derived.use_count(), 1);
+}
@@ -0,0 +1,151 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <caching_any_ptr.h>
+#include <up_cast_cache.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  // Returns the number of lookups of the process-wide up_cast_cache
+  uint64_t up_cast_cache_lookups()
+  {
+    const up_cast_cache::statistics stats = up_cast_cache::instance().stats();
+    return stats.hits + stats.misses;
+  }
+
+} // namespace
+
+TEST(caching_any_ptr, empty)
+{
+  caching_any_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(void));
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+}
+
+TEST(caching_any_ptr, cached_up_cast)
+{
+  auto derived = make_unique<Derived>();
+  caching_any_ptr any{ derived.get() };
+  Base2 * const expected = derived.get();
+
+  ASSERT_EQ(any_ptr_cast<Base2>(any), expected);
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Base2>(any), expected);
+  ASSERT_EQ(*any_ptr_cast<Base2>(&any), expected);
+  // The cast is resolved by the instance
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  // Other targets are still supported
+  ASSERT_EQ(any_ptr_cast<Derived>(any), derived.get());
+  ASSERT_EQ(any_ptr_cast<const Base1>(any), derived.get());
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+  ASSERT_EQ(any_ptr_cast<Base2>(any), expected);
+}
+
+TEST(caching_any_ptr, most_recent_target)
+{
+  auto derived = make_unique<Derived>();
+  caching_any_ptr any{ derived.get() };
+  Base1 * const expected1 = derived.get();
+  Base2 * const expected2 = derived.get();
+
+  // Alternating the targets overwrites the cache on each miss, which is then a hit for the next cast to the same target
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(any_ptr_cast<Base1>(any), expected1);
+    uint64_t lookups = up_cast_cache_lookups();
+    ASSERT_EQ(any_ptr_cast<Base1>(any), expected1);
+    ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+    ASSERT_EQ(any_ptr_cast<Base2>(any), expected2);
+    lookups = up_cast_cache_lookups();
+    ASSERT_EQ(any_ptr_cast<Base2>(any), expected2);
+    ASSERT_EQ(*any_ptr_cast<Base2>(&any), expected2);
+    ASSERT_EQ(up_cast_cache_lookups(), lookups);
+  }
+
+  // A failed cast leaves the cache unchanged
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Base2>(any), expected2);
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+}
+
+TEST(caching_any_ptr, copy_and_reset)
+{
+  auto derived = make_unique<Derived>();
+  caching_any_ptr any{ derived.get() };
+  ASSERT_EQ(any_ptr_cast<Base2>(any), derived.get());
+
+  // The copy carries the cache with it
+  caching_any_ptr copy{ any };
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(any_ptr_cast<Base2>(copy), derived.get());
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  // A new value invalidates the cache
+  auto other = make_unique<Derived>();
+  copy = caching_any_ptr{ other.get() };
+  ASSERT_EQ(any_ptr_cast<Base2>(copy), other.get());
+
+  copy.swap(any);
+  ASSERT_EQ(any_ptr_cast<Base2>(copy), derived.get());
+  ASSERT_EQ(any_ptr_cast<Base2>(any), other.get());
+
+  any.reset();
+  ASSERT_FALSE(any.has_value());
+  ASSERT_FALSE(any_ptr_cast<Base2>(&any));
+}
+
+TEST(caching_any_ptr, concurrent_casts)
+{
+  auto derived = make_unique<Derived>();
+  const caching_any_ptr any{ derived.get() };
+  Base1 * const expected1 = derived.get();
+  Base2 * const expected2 = derived.get();
+
+  // The threads race to overwrite the cache with either target and each cast must still see a consistent pair
+  vector<thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&any, expected1, expected2] {
+      for (int j = 0; j < 10000; ++j) {
+        ASSERT_EQ(any_ptr_cast<Base2>(any), expected2);
+        ASSERT_EQ(any_ptr_cast<Base1>(any), expected1);
+      }
+    });
+  }
+  for (thread & t : threads) {
+    t.join();
+  }
+}
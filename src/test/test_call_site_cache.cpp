@@ -0,0 +1,180 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <call_site_cache.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  template<int N>
+  struct Derived : public Base1, public Base2 {};
+
+  struct Top { virtual ~Top() = default; };
+  struct Left : public virtual Top {};
+  struct Right : public virtual Top {};
+  struct Diamond : public Left, public Right {};
+
+  // Returns the number of lookups of the process-wide up_cast_cache
+  uint64_t up_cast_cache_lookups()
+  {
+    const up_cast_cache::statistics stats = up_cast_cache::instance().stats();
+    return stats.hits + stats.misses;
+  }
+
+  Base2 * cast_to_base2(any_ptr const & any)
+  {
+    return ANY_PTR_CAST(Base2, any);
+  }
+
+} // namespace
+
+TEST(call_site_cache, find_and_insert)
+{
+  call_site_cache<Base2> site;
+  ptrdiff_t offset{ 0 };
+
+  ASSERT_EQ(site.find(typeid(Derived<0>*), offset), up_cast_result::unknown);
+
+  site.insert(typeid(Derived<0>*), up_cast_result::static_offset, 16);
+  site.insert(typeid(int*), up_cast_result::failed, 0);
+  ASSERT_EQ(site.find(typeid(Derived<0>*), offset), up_cast_result::static_offset);
+  ASSERT_EQ(offset, 16);
+  ASSERT_EQ(site.find(typeid(int*), offset), up_cast_result::failed);
+
+  // The entries are never evicted
+  site.insert(typeid(Derived<1>*), up_cast_result::static_offset, 16);
+  site.insert(typeid(Derived<2>*), up_cast_result::static_offset, 16);
+  site.insert(typeid(Derived<3>*), up_cast_result::static_offset, 16);
+  ASSERT_EQ(site.find(typeid(Derived<2>*), offset), up_cast_result::static_offset);
+  ASSERT_EQ(site.find(typeid(Derived<3>*), offset), up_cast_result::unknown);
+  ASSERT_EQ(site.find(typeid(Derived<0>*), offset), up_cast_result::static_offset);
+}
+
+TEST(call_site_cache, monomorphic)
+{
+  auto derived = make_unique<Derived<0>>();
+  const any_ptr any{ derived.get() };
+  Base2 * const expected = derived.get();
+
+  ASSERT_EQ(cast_to_base2(any), expected);
+  const uint64_t lookups = up_cast_cache_lookups();
+  ASSERT_EQ(cast_to_base2(any), expected);
+  ASSERT_EQ(cast_to_base2(any), expected);
+  // The cast is resolved by the call site
+  ASSERT_EQ(up_cast_cache_lookups(), lookups);
+
+  // Failures are also cached
+  const any_ptr any_int{ static_cast<int*>(nullptr) };
+  ASSERT_THROW(cast_to_base2(any_int), bad_any_ptr_cast);
+  const uint64_t lookups_after_failure = up_cast_cache_lookups();
+  ASSERT_THROW(cast_to_base2(any_int), bad_any_ptr_cast);
+  ASSERT_EQ(up_cast_cache_lookups(), lookups_after_failure);
+
+  // The pointer form doesn't throw
+  ASSERT_EQ(expected, *ANY_PTR_CAST(Base2, &any));
+  ASSERT_FALSE(ANY_PTR_CAST(Base2, &any_int));
+}
+
+TEST(call_site_cache, megamorphic)
+{
+  auto d0 = make_unique<Derived<0>>();
+  auto d1 = make_unique<Derived<1>>();
+  auto d2 = make_unique<Derived<2>>();
+  auto d3 = make_unique<Derived<3>>();
+  auto d4 = make_unique<Derived<4>>();
+  auto d5 = make_unique<Derived<5>>();
+  const vector<pair<any_ptr, Base2*>> anys{ 
+    { any_ptr{ d0.get() }, d0.get() }, { any_ptr{ d1.get() }, d1.get() }, { any_ptr{ d2.get() }, d2.get() },
+    { any_ptr{ d3.get() }, d3.get() }, { any_ptr{ d4.get() }, d4.get() }, { any_ptr{ d5.get() }, d5.get() } 
+  };
+  // The call site sees more held types than it has entries
+  for (int i = 0; i < 3; ++i) {
+    for (const auto & any : anys) {
+      ASSERT_EQ(any.second, ANY_PTR_CAST(Base2, any.first));
+    }
+  }
+}
+
+TEST(call_site_cache, virtual_base)
+{
+  auto diamond = make_unique<Diamond>();
+  auto right = make_unique<Right>();
+  const any_ptr any_diamond{ diamond.get() };
+  const any_ptr any_right{ right.get() };
+  for (int i = 0; i < 3; ++i) {
+    // The offset depends on the most derived object
+    ASSERT_EQ(static_cast<Top*>(diamond.get()), ANY_PTR_CAST(Top, any_diamond));
+    ASSERT_EQ(static_cast<Top*>(right.get()), ANY_PTR_CAST(Top, any_right));
+  }
+}
+
+TEST(call_site_cache, any_shared_ptr)
+{
+  auto derived = make_shared<Derived<0>>();
+  const v1::any_shared_ptr any_v1{ derived };
+  const v2::any_shared_ptr any_v2{ derived };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(static_pointer_cast<Base2>(derived), ANY_SHARED_PTR_CAST(Base2, any_v1));
+    ASSERT_EQ(static_pointer_cast<const Base1>(derived), ANY_SHARED_PTR_CAST(const Base1, any_v2));
+    ASSERT_EQ(static_pointer_cast<Base1>(derived), *ANY_SHARED_PTR_CAST(Base1, &any_v1));
+    ASSERT_FALSE(ANY_SHARED_PTR_CAST(int, &any_v2));
+    ASSERT_THROW(ANY_SHARED_PTR_CAST(int, any_v1), bad_any_shared_ptr_cast);
+  }
+  ASSERT_EQ(derived.use_count(), 3);
+}
+
+TEST(call_site_cache, concurrent_casts)
+{
+  auto d0 = make_unique<Derived<0>>();
+  auto d1 = make_unique<Derived<1>>();
+  const any_ptr any0{ d0.get() };
+  const any_ptr any1{ d1.get() };
+  Base2 * const expected0 = d0.get();
+  Base2 * const expected1 = d1.get();
+
+  // The threads race to fill the same call site's cache
+  vector<thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 10000; ++j) {
+        if ((i + j) % 2 == 0) {
+          ASSERT_EQ(cast_to_base2(any0), expected0);
+        }
+        else {
+          ASSERT_EQ(cast_to_base2(any1), expected1);
+        }
+      }
+    });
+  }
+  for (thread & t : threads) {
+    t.join();
+  }
+}
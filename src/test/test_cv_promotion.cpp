@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base { int b{ 1 }; };
+  struct Derived : public Base {};
+
+  // Tests casting a held pointer to From to a pointer to To, which only
+  // succeeds if To is at least as cv-qualified as From.
+  template<typename From, typename To>
+  void test_cv_cast()
+  {
+    const bool expected = (is_const<To>::value || !is_const<From>::value) && (is_volatile<To>::value || !is_volatile<From>::value);
+
+    Derived derived;
+    From * const ptr = &derived;
+    const any_ptr any{ ptr };
+    ASSERT_EQ(any.type(), typeid(From*));
+    ASSERT_EQ(any_ptr_cast<To>(&any).has_value(), expected);
+    if (expected) {
+      ASSERT_EQ(any_ptr_cast<To>(any), ptr);
+    }
+    else {
+      ASSERT_THROW(any_ptr_cast<To>(any), bad_any_ptr_cast);
+    }
+
+    const shared_ptr<From> shared{ make_shared<Derived>() };
+    const v1::any_shared_ptr any_v1{ shared };
+    const v2::any_shared_ptr any_v2{ shared };
+    ASSERT_EQ(v1::any_shared_ptr_cast<To>(&any_v1).has_value(), expected);
+    ASSERT_EQ(v2::any_shared_ptr_cast<To>(&any_v2).has_value(), expected);
+    if (expected) {
+      ASSERT_EQ(v1::any_shared_ptr_cast<To>(any_v1), shared);
+      ASSERT_EQ(v2::any_shared_ptr_cast<To>(any_v2), shared);
+    }
+    else {
+      ASSERT_THROW(v1::any_shared_ptr_cast<To>(any_v1), bad_any_shared_ptr_cast);
+      ASSERT_THROW(v2::any_shared_ptr_cast<To>(any_v2), bad_any_shared_ptr_cast);
+    }
+    ASSERT_EQ(shared.use_count(), 3);
+  }
+
+  template<typename From, typename To>
+  void test_cv_casts()
+  {
+    test_cv_cast<From, To>();
+    test_cv_cast<From, const To>();
+    test_cv_cast<From, volatile To>();
+    test_cv_cast<From, const volatile To>();
+  }
+
+} // namespace
+
+TEST(cv_promotion, same_type)
+{
+  test_cv_casts<Derived, Derived>();
+  test_cv_casts<const Derived, Derived>();
+  test_cv_casts<volatile Derived, Derived>();
+  test_cv_casts<const volatile Derived, Derived>();
+}
+
+TEST(cv_promotion, up_cast)
+{
+  test_cv_casts<Derived, Base>();
+  test_cv_casts<const Derived, Base>();
+  test_cv_casts<volatile Derived, Base>();
+  test_cv_casts<const volatile Derived, Base>();
+}
@@ -0,0 +1,281 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <dynamic_up_cast.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  // Multiple inheritance - Base2 isn't at offset 0 in Derived
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 { int d{ 3 }; };
+
+  // Virtual inheritance - a diamond with a single Top subobject
+  struct Top { int t{ 4 }; virtual ~Top() = default; };
+  struct Left : public virtual Top { int l{ 5 }; };
+  struct Right : public virtual Top { int r{ 6 }; };
+  struct Diamond : public Left, public Right { int d{ 7 }; };
+
+  // Non-virtual diamond - Top is an ambiguous base of Ambiguous 
+  struct NvLeft : public Top {};
+  struct NvRight : public Top {};
+  struct Ambiguous : public NvLeft, public NvRight {};
+
+  // Top is reached both virtually and non-virtually - also ambiguous
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winaccessible-base"
+#endif
+  struct Mixed : public Left, public NvRight {};
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+  // Non-public bases
+  struct Private : private Base1 {};
+  struct Protected : protected Base1 {};
+  // Base1 is public via one path of a virtual diamond and private via another
+  struct VBase1 : public virtual Base1 {};
+  struct PrivateVBase1 : private virtual Base1 {};
+  struct PublicAndPrivate : public VBase1, public PrivateVBase1 {};
+
+  // Empty bases share the address of the derived object
+  struct Empty {};
+  struct WithEmptyBase : public Empty, public Base2 {};
+
+  // Compare the RTTI engine with the try/catch engine for a held T* cast to U*
+  template<typename U, typename T>
+  bool expect_same_up_cast(T * const p)
+  {
+    void * const held = const_cast<void*>(static_cast<const volatile void*>(p));
+    void * throw_ptr = held;
+    const bool throw_ok = detail::throw_up_cast<U>(&detail::throw_pointer<T>, throw_ptr) != up_cast_result::failed;
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+    void * rtti_ptr = held;
+    const bool rtti_ok = detail::rtti_up_cast(typeid(T*), typeid(U*), rtti_ptr) != up_cast_result::failed;
+    EXPECT_EQ(throw_ok, rtti_ok);
+    if (throw_ok && rtti_ok) {
+      EXPECT_EQ(throw_ptr, rtti_ptr);
+    }
+#endif
+    return throw_ok;
+  }
+
+  // The address of the U subobject given by an implicit conversion
+  template<typename U, typename T>
+  void * up_cast_address(T * const p)
+  {
+    U * const u = p;
+    return const_cast<void*>(static_cast<const volatile void*>(u));
+  }
+
+} // namespace
+
+TEST(dynamic_up_cast, same_type)
+{
+  Derived d;
+  ASSERT_TRUE(expect_same_up_cast<Derived>(&d));
+  ASSERT_TRUE(expect_same_up_cast<int>(&d.d));
+  ASSERT_TRUE(expect_same_up_cast<int*>(static_cast<int**>(nullptr)));
+}
+
+TEST(dynamic_up_cast, cv_qualifiers)
+{
+  int i{ 42 };
+  const int ci{ 42 };
+  volatile int vi{ 42 };
+
+  ASSERT_TRUE(expect_same_up_cast<const int>(&i));
+  ASSERT_TRUE(expect_same_up_cast<volatile int>(&i));
+  ASSERT_TRUE(expect_same_up_cast<const volatile int>(&i));
+  ASSERT_TRUE(expect_same_up_cast<const volatile int>(&ci));
+  ASSERT_FALSE(expect_same_up_cast<int>(&ci));
+  ASSERT_FALSE(expect_same_up_cast<volatile int>(&ci));
+  ASSERT_FALSE(expect_same_up_cast<int>(&vi));
+  ASSERT_FALSE(expect_same_up_cast<const int>(&vi));
+
+  Derived d;
+  const Derived & cd = d;
+  ASSERT_TRUE(expect_same_up_cast<const Base2>(&d));
+  ASSERT_TRUE(expect_same_up_cast<const Base2>(&cd));
+  ASSERT_FALSE(expect_same_up_cast<Base2>(&cd));
+}
+
+TEST(dynamic_up_cast, unrelated_types)
+{
+  int i{ 42 };
+  Derived d;
+  ASSERT_FALSE(expect_same_up_cast<long>(&i));
+  ASSERT_FALSE(expect_same_up_cast<unsigned int>(&i));
+  ASSERT_FALSE(expect_same_up_cast<Derived>(&i));
+  ASSERT_FALSE(expect_same_up_cast<int>(&d));
+  ASSERT_FALSE(expect_same_up_cast<Top>(&d));
+  // down cast
+  Base1 & b1 = d;
+  ASSERT_FALSE(expect_same_up_cast<Derived>(&b1));
+}
+
+TEST(dynamic_up_cast, void_pointer)
+{
+  int i{ 42 };
+  const int ci{ 42 };
+  Derived d;
+  ASSERT_TRUE(expect_same_up_cast<void>(&i));
+  ASSERT_TRUE(expect_same_up_cast<const void>(&i));
+  ASSERT_TRUE(expect_same_up_cast<void>(&d));
+  ASSERT_TRUE(expect_same_up_cast<const void>(&ci));
+  ASSERT_FALSE(expect_same_up_cast<void>(&ci));
+}
+
+TEST(dynamic_up_cast, multiple_inheritance)
+{
+  Derived d;
+  ASSERT_TRUE(expect_same_up_cast<Base1>(&d));
+  ASSERT_TRUE(expect_same_up_cast<Base2>(&d));
+
+  void * ptr = &d;
+  ASSERT_TRUE(detail::dynamic_up_cast<Base2>(detail::held_type_v<Derived>, ptr));
+  ASSERT_EQ(ptr, up_cast_address<Base2>(&d));
+  ASSERT_NE(ptr, static_cast<void*>(&d));
+
+  WithEmptyBase e;
+  ASSERT_TRUE(expect_same_up_cast<Empty>(&e));
+  ASSERT_TRUE(expect_same_up_cast<Base2>(&e));
+}
+
+TEST(dynamic_up_cast, virtual_inheritance)
+{
+  Diamond d;
+  ASSERT_TRUE(expect_same_up_cast<Left>(&d));
+  ASSERT_TRUE(expect_same_up_cast<Right>(&d));
+  ASSERT_TRUE(expect_same_up_cast<Top>(&d));
+
+  void * ptr = &d;
+  ASSERT_TRUE(detail::dynamic_up_cast<Top>(detail::held_type_v<Diamond>, ptr));
+  ASSERT_EQ(ptr, up_cast_address<Top>(&d));
+
+  // The offset of a virtual base depends on the most derived object
+  Right & r = d;
+  Right r2;
+  ASSERT_TRUE(expect_same_up_cast<Top>(&r));
+  ASSERT_TRUE(expect_same_up_cast<Top>(&r2));
+  ptr = &r;
+  ASSERT_TRUE(detail::dynamic_up_cast<Top>(detail::held_type_v<Right>, ptr));
+  ASSERT_EQ(ptr, up_cast_address<Top>(&r));
+}
+
+TEST(dynamic_up_cast, ambiguous_base)
+{
+  Ambiguous a;
+  ASSERT_TRUE(expect_same_up_cast<NvLeft>(&a));
+  ASSERT_TRUE(expect_same_up_cast<NvRight>(&a));
+  ASSERT_FALSE(expect_same_up_cast<Top>(&a));
+
+  Mixed m;
+  ASSERT_TRUE(expect_same_up_cast<Left>(&m));
+  ASSERT_FALSE(expect_same_up_cast<Top>(&m));
+}
+
+TEST(dynamic_up_cast, non_public_base)
+{
+  Private p;
+  Protected q;
+  ASSERT_FALSE(expect_same_up_cast<Base1>(&p));
+  ASSERT_FALSE(expect_same_up_cast<Base1>(&q));
+
+  PublicAndPrivate pp;
+  ASSERT_TRUE(expect_same_up_cast<Base1>(&pp));
+}
+
+TEST(dynamic_up_cast, nullptr)
+{
+  ASSERT_TRUE(expect_same_up_cast<Base2>(static_cast<Derived*>(nullptr)));
+  ASSERT_TRUE(expect_same_up_cast<Top>(static_cast<Diamond*>(nullptr)));
+  ASSERT_TRUE(expect_same_up_cast<Top>(static_cast<Right*>(nullptr)));
+  ASSERT_FALSE(expect_same_up_cast<Top>(static_cast<Ambiguous*>(nullptr)));
+  ASSERT_FALSE(expect_same_up_cast<Top>(static_cast<Mixed*>(nullptr)));
+  ASSERT_FALSE(expect_same_up_cast<Base1>(static_cast<Private*>(nullptr)));
+  ASSERT_TRUE(expect_same_up_cast<Base1>(static_cast<PublicAndPrivate*>(nullptr)));
+}
+
+TEST(dynamic_up_cast, multi_level_pointers)
+{
+  int i{ 42 };
+  int * pi = &i;
+  Derived d;
+  Derived * pd = &d;
+  // Only qualification conversions are allowed for the pointee of a pointer 
+  ASSERT_TRUE(expect_same_up_cast<int * const>(&pi));
+  ASSERT_TRUE(expect_same_up_cast<const int * const>(&pi));
+  ASSERT_FALSE(expect_same_up_cast<const int *>(&pi));
+  ASSERT_FALSE(expect_same_up_cast<void * const>(&pi));
+  ASSERT_FALSE(expect_same_up_cast<Base2 * const>(&pd));
+  ASSERT_TRUE(expect_same_up_cast<void>(&pd));
+}
+
+TEST(dynamic_up_cast, any_ptr_and_any_shared_ptr)
+{
+  auto d = make_shared<Diamond>();
+  Top * top = d.get();
+
+  any_ptr a{ d.get() };
+  ASSERT_EQ(any_ptr_cast<Top>(a), top);
+  ASSERT_EQ(any_ptr_cast<const Right>(a), static_cast<Right*>(d.get()));
+  EXPECT_THROW(any_ptr_cast<Derived>(a), bad_any_ptr_cast);
+
+  v1::any_shared_ptr s1{ d };
+  ASSERT_EQ(any_shared_ptr_cast<Top>(s1).get(), top);
+  EXPECT_THROW(any_shared_ptr_cast<Derived>(s1), bad_any_shared_ptr_cast);
+
+  v2::any_shared_ptr s2{ d };
+  ASSERT_EQ(any_shared_ptr_cast<Top>(s2).get(), top);
+  EXPECT_THROW(any_shared_ptr_cast<Derived>(s2), bad_any_shared_ptr_cast);
+}
+
+TEST(dynamic_up_cast, throw_up_cast_first)
+{
+  Diamond d;
+  void * held = &d;
+
+  // a single throw is caught by the first candidate that matches, in the order of the candidates
+  void * ptr = held;
+  ASSERT_EQ((detail::throw_up_cast_first<Base1, const Right, Top>(&detail::throw_pointer<Diamond>, ptr)), 1u);
+  ASSERT_EQ(ptr, up_cast_address<Right>(&d));
+
+  ptr = held;
+  ASSERT_EQ((detail::throw_up_cast_first<Top, Right>(&detail::throw_pointer<Diamond>, ptr)), 0u);
+  ASSERT_EQ(ptr, up_cast_address<Top>(&d));
+
+  // cv-qualifiers aren't dropped
+  ptr = held;
+  ASSERT_EQ((detail::throw_up_cast_first<Left, const Top>(&detail::throw_pointer<const Diamond>, ptr)), 1u);
+
+  ptr = held;
+  ASSERT_EQ((detail::throw_up_cast_first<Base1, Base2, Empty>(&detail::throw_pointer<Diamond>, ptr)), 3u);
+  ASSERT_EQ(ptr, held);
+}
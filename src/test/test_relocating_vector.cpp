@@ -0,0 +1,216 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <relocating_vector.h>
+#include <any_ptr.h>
+#include <caching_any_ptr.h>
+#include <tagged_any_ptr.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base { int value{ 0 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+  static_assert(is_trivially_relocatable_v<any_ptr>, "");
+  static_assert(is_trivially_relocatable_v<caching_any_ptr>, "");
+  static_assert(is_trivially_relocatable_v<tagged_any_ptr>, "");
+  static_assert(is_trivially_relocatable_v<v1::any_shared_ptr>, "");
+  static_assert(is_trivially_relocatable_v<v2::any_shared_ptr>, "");
+  static_assert(is_trivially_relocatable_v<v3::any_shared_ptr>, "");
+  static_assert(!is_trivially_relocatable_v<string>, "");
+
+  // Counts the live instances, where the copy constructor throws once 'copies_until_throw' copies are made
+  struct Counted
+  {
+    static int live;
+    static int copies_until_throw;
+
+    Counted() { ++live; }
+    Counted(const Counted &)
+    {
+      if (copies_until_throw-- == 0) {
+        throw runtime_error("copy failed");
+      }
+      ++live;
+    }
+    ~Counted() { --live; }
+  };
+
+  int Counted::live = 0;
+  int Counted::copies_until_throw = -1;
+
+} // namespace
+
+namespace xxx {
+
+  template<> struct is_trivially_relocatable<Counted> : std::true_type {};
+
+} // namespace xxx
+
+namespace {
+
+  // Fills a vector with handles to 'count' objects, growing it element by element, 
+  // and checks that every handle still refers to its object.
+  template<typename AnySharedPtr>
+  void test_growth(int count)
+  {
+    relocating_vector<AnySharedPtr> handles;
+    vector<shared_ptr<Derived>> objects;
+    for (int i = 0; i < count; ++i) {
+      objects.push_back(make_shared<Derived>());
+      objects.back()->value = i;
+      handles.push_back(AnySharedPtr{ objects.back() });
+    }
+    ASSERT_EQ(handles.size(), static_cast<size_t>(count));
+    ASSERT_GE(handles.capacity(), handles.size());
+    for (int i = 0; i < count; ++i) {
+      // The relocation neither copied nor leaked a handle
+      ASSERT_EQ(handles[i].use_count(), 2);
+      ASSERT_EQ(any_shared_ptr_cast<Base>(handles[i])->value, i);
+    }
+    handles.clear();
+    ASSERT_TRUE(handles.empty());
+    ASSERT_EQ(objects.front().use_count(), 1);
+  }
+
+  template<typename AnySharedPtr>
+  void test_erase()
+  {
+    relocating_vector<AnySharedPtr> handles;
+    vector<shared_ptr<Derived>> objects;
+    for (int i = 0; i < 10; ++i) {
+      objects.push_back(make_shared<Derived>());
+      objects.back()->value = i;
+      handles.emplace_back(objects.back());
+    }
+    // Erase 1 and then 3, 4 and 5
+    ASSERT_EQ(handles.erase(handles.begin() + 1), handles.begin() + 1);
+    handles.erase(handles.begin() + 2, handles.begin() + 5);
+    ASSERT_EQ(handles.erase(handles.end(), handles.end()), handles.end());
+    ASSERT_EQ(handles.size(), 6u);
+    const int expected[] = { 0, 2, 6, 7, 8, 9 };
+    for (size_t i = 0; i < handles.size(); ++i) {
+      ASSERT_EQ(any_shared_ptr_cast<Base>(handles[i])->value, expected[i]);
+    }
+    ASSERT_EQ(objects[1].use_count(), 1);
+    ASSERT_EQ(objects[4].use_count(), 1);
+    ASSERT_EQ(objects[6].use_count(), 2);
+
+    handles.pop_back();
+    ASSERT_EQ(objects[9].use_count(), 1);
+    ASSERT_EQ(any_shared_ptr_cast<Base>(handles.back())->value, 8);
+  }
+
+} // namespace
+
+TEST(relocating_vector, growth)
+{
+  test_growth<v1::any_shared_ptr>(1000);
+  test_growth<v2::any_shared_ptr>(1000);
+  test_growth<v3::any_shared_ptr>(1000);
+}
+
+TEST(relocating_vector, erase)
+{
+  test_erase<v1::any_shared_ptr>();
+  test_erase<v2::any_shared_ptr>();
+  test_erase<v3::any_shared_ptr>();
+}
+
+TEST(relocating_vector, emplace_back_an_element)
+{
+  // The argument refers to an element that's relocated when the vector grows
+  v2::any_shared_ptr_vector handles;
+  handles.push_back(v2::any_shared_ptr{ make_shared<Derived>() });
+  ASSERT_EQ(handles.capacity(), 1u);
+  handles.push_back(handles.front());
+  ASSERT_EQ(handles.size(), 2u);
+  ASSERT_EQ(handles[0].use_count(), 2);
+  ASSERT_EQ(any_shared_ptr_cast<Derived>(handles[0]), any_shared_ptr_cast<Derived>(handles[1]));
+}
+
+TEST(relocating_vector, copy_and_move)
+{
+  auto derived = make_shared<Derived>();
+  any_shared_ptr_vector handles;
+  handles.reserve(4);
+  ASSERT_EQ(handles.capacity(), 4u);
+  handles.emplace_back(derived);
+  handles.emplace_back(derived);
+
+  any_shared_ptr_vector copy{ handles };
+  ASSERT_EQ(copy.size(), 2u);
+  ASSERT_EQ(derived.use_count(), 5);
+
+  any_shared_ptr_vector moved{ std::move(copy) };
+  ASSERT_TRUE(copy.empty());
+  ASSERT_EQ(derived.use_count(), 5);
+
+  moved = handles;
+  ASSERT_EQ(derived.use_count(), 5);
+  moved = any_shared_ptr_vector{};
+  ASSERT_EQ(derived.use_count(), 3);
+
+  handles.swap(moved);
+  ASSERT_TRUE(handles.empty());
+  ASSERT_EQ(moved.size(), 2u);
+}
+
+TEST(relocating_vector, copy_constructor_throws)
+{
+  {
+    relocating_vector<Counted> counted;
+    for (int i = 0; i < 4; ++i) {
+      counted.emplace_back();
+    }
+    ASSERT_EQ(Counted::live, 4);
+
+    // The copies made before the copy constructor throws are destroyed
+    Counted::copies_until_throw = 2;
+    ASSERT_THROW(relocating_vector<Counted>{ counted }, runtime_error);
+    ASSERT_EQ(Counted::live, 4);
+
+    Counted::copies_until_throw = -1;
+    relocating_vector<Counted> copy{ counted };
+    ASSERT_EQ(Counted::live, 8);
+  }
+  ASSERT_EQ(Counted::live, 0);
+}
+
+TEST(relocating_vector, tagged_any_ptr)
+{
+  auto derived = make_unique<Derived>();
+  relocating_vector<tagged_any_ptr> handles;
+  for (int i = 0; i < 100; ++i) {
+    handles.emplace_back(derived.get());
+  }
+  for (const tagged_any_ptr & handle : handles) {
+    ASSERT_EQ(any_ptr_cast<Base>(handle), derived.get());
+  }
+}
@@ -0,0 +1,189 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <tagged_any_ptr.h>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  // Returns a pointer whose upper 16 bits aren't 0 e.g. a pointer with a hardware memory tag.
+  // It's never dereferenced.
+  Derived * non_canonical_pointer()
+  {
+    return reinterpret_cast<Derived*>(static_cast<uintptr_t>(UINT64_C(0xABCD000000001000)));
+  }
+
+} // namespace
+
+TEST(tagged_any_ptr, size)
+{
+  ASSERT_EQ(sizeof(tagged_any_ptr), 8u);
+}
+
+TEST(tagged_any_ptr, empty)
+{
+  tagged_any_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(void));
+  ASSERT_FALSE(any.get().has_value());
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+}
+
+TEST(tagged_any_ptr, casts)
+{
+  auto derived = make_unique<Derived>();
+  const tagged_any_ptr any{ derived.get() };
+  ASSERT_TRUE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(Derived*));
+  ASSERT_EQ(any.type_id(), type_id<Derived*>());
+
+  // same type and cv-qualifier promotion
+  ASSERT_EQ(any_ptr_cast<Derived>(any), derived.get());
+  ASSERT_EQ(any_ptr_cast<const volatile Derived>(any), derived.get());
+  // up cast
+  ASSERT_EQ(any_ptr_cast<Base1>(any), derived.get());
+  ASSERT_EQ(*any_ptr_cast<const Base2>(&any), derived.get());
+  // failed casts
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_THROW(any_ptr_cast<int>(any), bad_any_ptr_cast);
+
+  // cv-qualifiers can't be dropped
+  const tagged_any_ptr const_any{ static_cast<const Derived*>(derived.get()) };
+  ASSERT_EQ(const_any.type(), typeid(const Derived*));
+  ASSERT_EQ(any_ptr_cast<const Base2>(const_any), derived.get());
+  ASSERT_FALSE(any_ptr_cast<Derived>(&const_any));
+  ASSERT_FALSE(any_ptr_cast<Base2>(&const_any));
+
+  // a held nullptr isn't empty
+  const tagged_any_ptr null_any{ static_cast<Derived*>(nullptr) };
+  ASSERT_TRUE(null_any.has_value());
+  ASSERT_EQ(any_ptr_cast<Derived>(null_any), nullptr);
+  ASSERT_EQ(any_ptr_cast<Base2>(null_any), nullptr);
+  ASSERT_FALSE(any_ptr_cast<int>(&null_any));
+}
+
+TEST(tagged_any_ptr, any_ptr_round_trip)
+{
+  auto derived = make_unique<Derived>();
+  const any_ptr any{ derived.get() };
+  const tagged_any_ptr tagged{ any };
+  ASSERT_EQ(tagged.type(), any.type());
+  ASSERT_EQ(any_ptr_cast<Base2>(tagged), any_ptr_cast<Base2>(any));
+  ASSERT_EQ(any_ptr_cast<Base2>(tagged.get()), derived.get());
+  ASSERT_FALSE(tagged_any_ptr{ any_ptr{} }.has_value());
+}
+
+TEST(tagged_any_ptr, copy_move_and_reset)
+{
+  auto derived = make_unique<Derived>();
+  tagged_any_ptr any{ derived.get() };
+
+  tagged_any_ptr copy{ any };
+  ASSERT_EQ(any_ptr_cast<Base2>(copy), derived.get());
+
+  tagged_any_ptr moved{ std::move(copy) };
+  ASSERT_FALSE(copy.has_value());
+  ASSERT_EQ(any_ptr_cast<Base2>(moved), derived.get());
+
+  auto other = make_unique<Base1>();
+  moved = tagged_any_ptr{ other.get() };
+  moved.swap(any);
+  ASSERT_EQ(any_ptr_cast<Base1>(moved), derived.get());
+  ASSERT_EQ(any_ptr_cast<Base1>(any), other.get());
+  ASSERT_FALSE(any_ptr_cast<Base2>(&any));
+
+  any.reset();
+  ASSERT_FALSE(any.has_value());
+  ASSERT_FALSE(any_ptr_cast<Base1>(&any));
+}
+
+TEST(tagged_any_ptr, boxed)
+{
+  // The pointer doesn't fit in 48 bits so the instance holds an any_ptr on the heap
+  Derived * const ptr = non_canonical_pointer();
+  tagged_any_ptr any{ ptr };
+  ASSERT_TRUE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(Derived*));
+  ASSERT_EQ(any_ptr_cast<Derived>(any), ptr);
+  ASSERT_EQ(any_ptr_cast<const Derived>(any), ptr);
+  ASSERT_FALSE(any_ptr_cast<int>(&any));
+  ASSERT_EQ(any_ptr_cast<Derived>(any.get()), ptr);
+
+  tagged_any_ptr copy{ any };
+  any.reset();
+  ASSERT_EQ(any_ptr_cast<Derived>(copy), ptr);
+  any = copy;
+  ASSERT_EQ(any_ptr_cast<Derived>(any), ptr);
+  any = std::move(copy);
+  ASSERT_EQ(any_ptr_cast<Derived>(any), ptr);
+}
+
+TEST(tagged_any_ptr, box_that_does_not_fit)
+{
+  // A box on a heap whose addresses don't fit in 48 bits can't be packed into the bits
+  const void * const box = non_canonical_pointer();
+  ASSERT_THROW(detail::tagged_type_table::boxed_bits(box), bad_tagged_any_ptr_box);
+  ASSERT_THROW(detail::tagged_type_table::boxed_bits(reinterpret_cast<const void*>(static_cast<uintptr_t>(UINT64_C(1) << 56))), std::bad_alloc);
+
+  any_ptr boxed;
+  const uint64_t bits = detail::tagged_type_table::boxed_bits(&boxed);
+  ASSERT_EQ(bits >> detail::tagged_type_table::tag_shift, detail::tagged_type_table::boxed_tag);
+  ASSERT_EQ(bits & ((UINT64_C(1) << detail::tagged_type_table::tag_shift) - 1), static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&boxed)));
+}
+
+TEST(tagged_any_ptr, invalid_type_id)
+{
+  // A held type without a type_registry ID is boxed and isn't mistaken for the tag of an empty instance
+  ASSERT_FALSE(detail::tagged_type_table::has_tag(type_registry::invalid_id));
+  ASSERT_FALSE(detail::tagged_type_table::has_tag(detail::tagged_type_table::boxed_tag - 1u));
+  ASSERT_TRUE(detail::tagged_type_table::has_tag(0));
+}
+
+TEST(tagged_any_ptr, vector)
+{
+  auto derived = make_unique<Derived>();
+  auto base1 = make_unique<Base1>();
+  vector<tagged_any_ptr> any_ptrs;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 2 == 0) {
+      any_ptrs.emplace_back(derived.get());
+    }
+    else {
+      any_ptrs.emplace_back(base1.get());
+    }
+  }
+  for (size_t i = 0; i < any_ptrs.size(); ++i) {
+    Base1 * const expected = i % 2 == 0 ? static_cast<Base1*>(derived.get()) : base1.get();
+    ASSERT_EQ(any_ptr_cast<Base1>(any_ptrs[i]), expected);
+  }
+}
@@ -0,0 +1,96 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <type_fingerprint.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <memory>
+
+using namespace xxx;
+using namespace std;
+
+// Types with external linkage as a type_info of a type in an anonymous namespace is only equal to itself
+namespace type_fingerprint_test {
+
+  struct Base { int b{ 1 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+} // namespace type_fingerprint_test
+
+ANY_PTR_BASES(type_fingerprint_test::Derived, type_fingerprint_test::Base);
+
+using namespace type_fingerprint_test;
+
+namespace {
+
+#ifdef __GXX_ABI_VERSION
+  // A duplicate of a type_info object, as if the type had a type_info in another shared library
+  struct duplicate_type_info : public type_info
+  {
+    explicit duplicate_type_info(const type_info & type) : type_info(type.name()) {}
+  };
+#endif
+
+} // namespace
+
+TEST(type_fingerprint, fingerprints)
+{
+  ASSERT_NE(detail::type_fingerprint_v<Base*>, 0u);
+  ASSERT_EQ(detail::type_fingerprint_v<Base*>, detail::fingerprint_of(typeid(Base*)));
+  ASSERT_NE(detail::type_fingerprint_v<Base*>, detail::type_fingerprint_v<Derived*>);
+  ASSERT_NE(detail::type_fingerprint_v<Base*>, detail::type_fingerprint_v<Base>);
+  ASSERT_TRUE(detail::is_different_fingerprint(detail::type_fingerprint_v<Base*>, detail::type_fingerprint_v<Derived*>));
+  // An unknown fingerprint
+  ASSERT_FALSE(detail::is_different_fingerprint(detail::type_fingerprint_v<Base*>, 0));
+}
+
+TEST(type_fingerprint, same_unqualified_type)
+{
+  ASSERT_TRUE(detail::is_same_unqualified_type(detail::held_type_v<Derived>, detail::held_type_v<const Derived>));
+  ASSERT_FALSE(detail::is_same_unqualified_type(detail::held_type_v<Derived>, detail::held_type_v<Base>));
+  ASSERT_FALSE(detail::is_same_unqualified_type(detail::empty_held_type, detail::held_type_v<Base>));
+  // The pointer types of any_shared_ptr
+  ASSERT_FALSE(detail::is_same_unqualified_type(detail::held_type_v<Derived, shared_ptr<Derived>, shared_ptr<Derived>>, detail::held_type_v<Derived>));
+}
+
+#ifdef __GXX_ABI_VERSION
+TEST(type_fingerprint, duplicate_type_info)
+{
+  // The fingerprint is derived from the name so it's the same for each type_info of a type
+  const duplicate_type_info derived_type{ typeid(Derived*) };
+  ASSERT_NE(&derived_type, &typeid(Derived*));
+  ASSERT_EQ(detail::fingerprint_of(derived_type), detail::type_fingerprint_v<Derived*>);
+
+  detail::held_type held{ detail::held_type_v<Derived> };
+  held.unqualified_type = &derived_type;
+  ASSERT_TRUE(detail::is_same_unqualified_type(held, detail::held_type_v<Derived>));
+  ASSERT_FALSE(detail::is_same_unqualified_type(held, detail::held_type_v<Base>));
+
+  // The ancestors are found in the table of the held type
+  const detail::base_table table = detail::base_table_function<Derived>()();
+  const duplicate_type_info base_type{ typeid(Base) };
+  const detail::ancestor * const base = table.find(base_type, detail::fingerprint_of(base_type));
+  ASSERT_NE(base, nullptr);
+  ASSERT_EQ(base->result, up_cast_result::static_offset);
+  ASSERT_EQ(table.find(typeid(Derived), detail::type_fingerprint_v<Derived>), nullptr);
+}
+#endif
@@ -0,0 +1,156 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <type_registry.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <caching_any_ptr.h>
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+// A type with external linkage so that a duplicate of its type_info compares equal
+namespace type_registry_test {
+
+  struct Base { int b{ 1 }; virtual ~Base() = default; };
+  struct Derived : public Base {};
+
+} // namespace type_registry_test
+
+using namespace type_registry_test;
+
+namespace {
+
+  template<int N>
+  struct Type {};
+
+#ifdef __GXX_ABI_VERSION
+  // A duplicate of a type_info object, as if the type had a type_info in another shared library
+  struct duplicate_type_info : public type_info
+  {
+    explicit duplicate_type_info(const type_info & type) : type_info(type.name()) {}
+  };
+#endif
+
+  // Returns the IDs of Type<N>... registered concurrently by 'threads' threads
+  template<int... N>
+  vector<type_registry::id_type> concurrent_type_ids(integer_sequence<int, N...>, size_t threads)
+  {
+    vector<vector<type_registry::id_type>> ids(threads);
+    atomic<bool> go{ false };
+    vector<thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([&go, &ids, i] {
+        while (!go.load()) {
+        }
+        ids[i] = { type_id<Type<N>>()... };
+      });
+    }
+    go.store(true);
+    for (thread & worker : workers) {
+      worker.join();
+    }
+    for (size_t i = 1; i < threads; ++i) {
+      if (ids[i] != ids[0]) {
+        return {};
+      }
+    }
+    return ids[0];
+  }
+
+} // namespace
+
+TEST(type_registry, dense_ids)
+{
+  const size_t size = type_registry::size();
+  const type_registry::id_type id1 = type_id<Type<-1>>();
+  const type_registry::id_type id2 = type_id<Type<-2>>();
+  // The IDs are assigned in order
+  ASSERT_EQ(id1, size);
+  ASSERT_EQ(id2, size + 1);
+  ASSERT_EQ(type_registry::size(), size + 2);
+  // and are stable
+  ASSERT_EQ(type_id<Type<-1>>(), id1);
+  ASSERT_EQ(type_registry::id_of(typeid(Type<-2>)), id2);
+  ASSERT_EQ(type_registry::size(), size + 2);
+
+  ASSERT_EQ(type_registry::type_of(id1), &typeid(Type<-1>));
+  ASSERT_EQ(type_registry::type_of(id2), &typeid(Type<-2>));
+  ASSERT_EQ(type_registry::type_of(static_cast<type_registry::id_type>(type_registry::size())), nullptr);
+}
+
+TEST(type_registry, invalid_id)
+{
+  // A type that can't be registered has invalid_id, which is never assigned, rather than throwing
+  static_assert(noexcept(type_registry::try_id_of(typeid(int))), "try_id_of should be noexcept");
+  static_assert(noexcept(type_id<int>()), "type_id should be noexcept");
+  ASSERT_GE(static_cast<size_t>(type_registry::invalid_id), type_registry::max_size);
+  ASSERT_EQ(type_registry::type_of(type_registry::invalid_id), nullptr);
+  ASSERT_EQ(type_registry::try_id_of(typeid(Type<-3>)), type_registry::id_of(typeid(Type<-3>)));
+}
+
+TEST(type_registry, collision_free)
+{
+  // Distinct types registered concurrently have distinct IDs that are less than the size
+  const vector<type_registry::id_type> ids = concurrent_type_ids(make_integer_sequence<int, 64>{}, 8);
+  ASSERT_EQ(ids.size(), 64u);
+  const set<type_registry::id_type> unique_ids(ids.begin(), ids.end());
+  ASSERT_EQ(unique_ids.size(), ids.size());
+  for (const type_registry::id_type id : ids) {
+    ASSERT_LT(id, type_registry::size());
+  }
+  for (type_registry::id_type id = 0; id < type_registry::size(); ++id) {
+    const type_info * const type = type_registry::type_of(id);
+    ASSERT_NE(type, nullptr);
+    ASSERT_EQ(type_registry::id_of(*type), id);
+  }
+}
+
+#ifdef __GXX_ABI_VERSION
+TEST(type_registry, duplicate_type_info)
+{
+  // A type has the same ID for each of its type_info objects
+  const duplicate_type_info derived_type{ typeid(Derived) };
+  ASSERT_EQ(type_registry::id_of(derived_type), type_id<Derived>());
+}
+#endif
+
+TEST(type_registry, held_types)
+{
+  Derived derived;
+  const any_ptr any{ &derived };
+  ASSERT_EQ(any.type_id(), type_id<Derived*>());
+  ASSERT_NE(any.type_id(), type_id<const Derived*>());
+  ASSERT_EQ(any_ptr{}.type_id(), type_id<void>());
+  ASSERT_EQ(caching_any_ptr{ &derived }.type_id(), type_id<Derived*>());
+
+  const shared_ptr<Derived> shared{ make_shared<Derived>() };
+  ASSERT_EQ(v1::any_shared_ptr{ shared }.type_id(), type_id<shared_ptr<Derived>>());
+  ASSERT_EQ(v2::any_shared_ptr{ shared }.type_id(), type_id<shared_ptr<Derived>>());
+  ASSERT_EQ(v2::any_shared_ptr{}.type_id(), type_id<void>());
+}
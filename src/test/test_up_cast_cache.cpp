@@ -0,0 +1,248 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <up_cast_cache.h>
+#include <any_ptr.h>
+#include <any_shared_ptr.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  struct Top { virtual ~Top() = default; };
+  struct Left : public virtual Top {};
+  struct Right : public virtual Top {};
+  struct Diamond : public Left, public Right {};
+
+  // A type that's only used by this test so that its casts start as misses
+  struct CacheDerived : public Base1, public Base2 {};
+
+  // Returns the up cast of 'd' by the dynamic up cast, i.e. bypassing the ancestors 
+  // discovered by any_ptr_bases, or nullptr if the up cast failed
+  template<typename U>
+  U* cached_up_cast(CacheDerived * d)
+  {
+    void * ptr = d;
+    const up_cast_result result = detail::cached_up_cast<U>(typeid(CacheDerived*), detail::up_cast_function<CacheDerived>(), ptr);
+    return result == up_cast_result::failed ? nullptr : static_cast<U*>(ptr);
+  }
+
+} // namespace
+
+TEST(up_cast_cache, find_and_insert)
+{
+  up_cast_cache cache;
+  ptrdiff_t offset{ 0 };
+
+  ASSERT_EQ(cache.find(typeid(Derived*), typeid(Base2*), offset), up_cast_result::unknown);
+
+  cache.insert(typeid(Derived*), typeid(Base2*), up_cast_result::static_offset, 16);
+  cache.insert(typeid(Derived*), typeid(int*), up_cast_result::failed, 0);
+  cache.insert(typeid(Diamond*), typeid(Top*), up_cast_result::dynamic_offset, 0);
+
+  ASSERT_EQ(cache.find(typeid(Derived*), typeid(Base2*), offset), up_cast_result::static_offset);
+  ASSERT_EQ(offset, 16);
+  ASSERT_EQ(cache.find(typeid(Derived*), typeid(int*), offset), up_cast_result::failed);
+  ASSERT_EQ(cache.find(typeid(Diamond*), typeid(Top*), offset), up_cast_result::dynamic_offset);
+  // The key is ordered
+  ASSERT_EQ(cache.find(typeid(Base2*), typeid(Derived*), offset), up_cast_result::unknown);
+
+  const up_cast_cache::statistics stats = cache.stats();
+  ASSERT_EQ(stats.hits, 3u);
+  ASSERT_EQ(stats.misses, 2u);
+  ASSERT_EQ(stats.evictions, 0u);
+
+  cache.clear();
+  ASSERT_EQ(cache.find(typeid(Derived*), typeid(Base2*), offset), up_cast_result::unknown);
+}
+
+TEST(up_cast_cache, per_thread_counts)
+{
+  up_cast_cache cache;
+  cache.insert(typeid(Derived*), typeid(Base2*), up_cast_result::static_offset, 16);
+  constexpr int thread_count = 4;
+  constexpr int lookups = 1000;
+  vector<thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&cache]() {
+      ptrdiff_t offset{ 0 };
+      for (int i = 0; i < lookups; ++i) {
+        cache.find(typeid(Derived*), typeid(Base2*), offset);
+        cache.find(typeid(Derived*), typeid(int*), offset);
+      }
+    });
+  }
+  for (thread & t : threads) {
+    t.join();
+  }
+  // The counts of every thread are summed, including those that have exited
+  const up_cast_cache::statistics stats = cache.stats();
+  ASSERT_EQ(stats.hits, static_cast<uint64_t>(thread_count * lookups));
+  ASSERT_EQ(stats.misses, static_cast<uint64_t>(thread_count * lookups));
+
+  // A thread's counts are kept apart for each instance
+  up_cast_cache other;
+  ptrdiff_t offset{ 0 };
+  other.find(typeid(Derived*), typeid(Base2*), offset);
+  cache.find(typeid(Derived*), typeid(Base2*), offset);
+  ASSERT_EQ(other.stats().misses, 1u);
+  ASSERT_EQ(other.stats().hits, 0u);
+  ASSERT_EQ(cache.stats().hits, static_cast<uint64_t>(thread_count * lookups + 1));
+}
+
+TEST(up_cast_cache, memory_bound)
+{
+  up_cast_cache small{ 0 };
+  up_cast_cache large{ 64 * 1024 };
+
+  ASSERT_GE(small.stats().capacity, 1u);
+  ASSERT_GT(large.stats().capacity, small.stats().capacity);
+  ASSERT_LE(large.stats().size_in_bytes, 64u * 1024u);
+
+  // Filling the smallest cache evicts entries
+  const type_info * const types[] = { 
+    &typeid(int*), &typeid(long*), &typeid(short*), &typeid(char*), 
+    &typeid(float*), &typeid(double*), &typeid(bool*), &typeid(unsigned*) 
+  };
+  for (const type_info * held : types) {
+    for (const type_info * target : types) {
+      small.insert(*held, *target, up_cast_result::failed, 0);
+    }
+  }
+  ASSERT_GT(small.stats().evictions, 0u);
+
+  // The process-wide instance has a fixed size once it's in use
+  (void)up_cast_cache::instance();
+  ASSERT_FALSE(up_cast_cache::set_max_bytes(1024));
+}
+
+TEST(up_cast_cache, cached_casts)
+{
+  up_cast_cache & cache = up_cast_cache::instance();
+
+  CacheDerived d;
+
+  const up_cast_cache::statistics before = cache.stats();
+  ASSERT_EQ(cached_up_cast<Base2>(&d), static_cast<Base2*>(&d));
+  ASSERT_EQ(cached_up_cast<Base2>(&d), static_cast<Base2*>(&d));
+  ASSERT_EQ(cached_up_cast<Base1>(&d), static_cast<Base1*>(&d));
+  ASSERT_EQ(cached_up_cast<Top>(&d), nullptr);
+  ASSERT_EQ(cached_up_cast<Top>(&d), nullptr);
+  const up_cast_cache::statistics after = cache.stats();
+  // Each distinct target misses once 
+  ASSERT_EQ(after.misses - before.misses, 3u);
+  ASSERT_EQ(after.hits - before.hits, 2u);
+
+  ptrdiff_t offset{ 0 };
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+  ASSERT_EQ(cache.find(typeid(CacheDerived*), typeid(Base2*), offset), up_cast_result::static_offset);
+  ASSERT_EQ(offset, reinterpret_cast<char*>(static_cast<Base2*>(&d)) - reinterpret_cast<char*>(&d));
+#else // the try/catch engine can't tell if the offset is constant
+  ASSERT_EQ(cache.find(typeid(CacheDerived*), typeid(Base2*), offset), up_cast_result::dynamic_offset);
+#endif
+  ASSERT_EQ(cache.find(typeid(CacheDerived*), typeid(Top*), offset), up_cast_result::failed);
+
+  // A cached offset is applied to each held pointer 
+  CacheDerived d2;
+  ASSERT_EQ(cached_up_cast<Base2>(&d2), static_cast<Base2*>(&d2));
+  // but not to a nullptr
+  ASSERT_EQ(cached_up_cast<Base2>(nullptr), nullptr);
+}
+
+TEST(up_cast_cache, virtual_base)
+{
+  // The offset of a virtual base depends on the most derived object
+  Diamond d;
+  Right r;
+  any_ptr any1{ static_cast<Right*>(&d) };
+  any_ptr any2{ &r };
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(any_ptr_cast<Top>(any1), static_cast<Top*>(&d));
+    ASSERT_EQ(any_ptr_cast<Top>(any2), static_cast<Top*>(&r));
+  }
+
+#ifdef ANY_PTR_HAS_ITANIUM_RTTI
+  // The casts above are resolved by the held type's table of ancestors, so the cache is used directly
+  void * ptr = &r;
+  ASSERT_EQ(detail::cached_up_cast<Top>(typeid(Right*), detail::up_cast_function<Right>(), ptr), up_cast_result::dynamic_offset);
+  ASSERT_EQ(ptr, static_cast<Top*>(&r));
+  ptrdiff_t offset{ 0 };
+  ASSERT_EQ(up_cast_cache::instance().find(typeid(Right*), typeid(Top*), offset), up_cast_result::dynamic_offset);
+#endif
+}
+
+TEST(up_cast_cache, any_shared_ptr)
+{
+  auto d = make_shared<Derived>();
+  v1::any_shared_ptr any1{ d };
+  v2::any_shared_ptr any2{ d };
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(any_shared_ptr_cast<Base2>(any1).get(), static_cast<Base2*>(d.get()));
+    ASSERT_EQ(any_shared_ptr_cast<Base2>(any2).get(), static_cast<Base2*>(d.get()));
+    ASSERT_FALSE(any_shared_ptr_cast<int>(&any1).has_value());
+    ASSERT_FALSE(any_shared_ptr_cast<int>(&any2).has_value());
+  }
+}
+
+TEST(up_cast_cache, concurrent_casts)
+{
+  Derived d;
+  Diamond dd;
+  any_ptr any1{ &d };
+  any_ptr any2{ &dd };
+  Base2 * const expected1 = &d;
+  Top * const expected2 = &dd;
+
+  up_cast_cache cache{ 0 };
+  atomic<bool> ok{ true };
+  vector<thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 10000; ++i) {
+        if (any_ptr_cast<Base2>(any1) != expected1 || any_ptr_cast<Top>(any2) != expected2) {
+          ok = false;
+        }
+        // Race updates of the same set in a tiny cache
+        ptrdiff_t offset{ 0 };
+        cache.insert(typeid(Derived*), typeid(Base1*), up_cast_result::static_offset, 1);
+        cache.insert(typeid(Derived*), typeid(Base2*), up_cast_result::static_offset, 2);
+        const up_cast_result result = cache.find(typeid(Derived*), typeid(Base2*), offset);
+        if (result != up_cast_result::unknown && (result != up_cast_result::static_offset || offset != 2)) {
+          ok = false;
+        }
+      }
+    });
+  }
+  for (thread & t : threads) {
+    t.join();
+  }
+  ASSERT_TRUE(ok);
+}
@@ -0,0 +1,207 @@
+// MIT License
+//
+// Copyright (c) 2017 Scott Slack-Smith
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include <gtest/gtest.h>
+#include <any_shared_ptr.h>
+#include <call_site_cache.h>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace xxx;
+using namespace std;
+
+namespace {
+
+  struct Base1 { int b1{ 1 }; virtual ~Base1() = default; };
+  struct Base2 { int b2{ 2 }; virtual ~Base2() = default; };
+  struct Derived : public Base1, public Base2 {};
+
+  // Sets 'destroyed' when it's destroyed
+  struct Tracked : public Base2
+  {
+    bool & my_destroyed;
+    explicit Tracked(bool & destroyed) : my_destroyed{ destroyed } {}
+    ~Tracked() { my_destroyed = true; }
+  };
+
+  struct alignas(64) OverAligned { int value{ 42 }; };
+
+} // namespace
+
+TEST(v3_any_shared_ptr, size)
+{
+  ASSERT_EQ(sizeof(v3::any_shared_ptr), sizeof(void*));
+}
+
+TEST(v3_any_shared_ptr, empty)
+{
+  v3::any_shared_ptr any;
+  ASSERT_FALSE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(void));
+  ASSERT_EQ(any.use_count(), 0);
+  ASSERT_FALSE(v3::any_shared_ptr_cast<int>(&any));
+  ASSERT_THROW(v3::any_shared_ptr_cast<int>(any), bad_any_shared_ptr_cast);
+}
+
+TEST(v3_any_shared_ptr, make_any_shared_ptr)
+{
+  const v3::any_shared_ptr any = v3::make_any_shared_ptr<Derived>();
+  ASSERT_TRUE(any.has_value());
+  ASSERT_EQ(any.type(), typeid(shared_ptr<Derived>));
+  ASSERT_EQ(any.type_id(), type_id<shared_ptr<Derived>>());
+
+  // same type, cv-qualifier promotion and up cast
+  const shared_ptr<Derived> derived = v3::any_shared_ptr_cast<Derived>(any);
+  ASSERT_NE(derived, nullptr);
+  ASSERT_EQ(v3::any_shared_ptr_cast<const Derived>(any), derived);
+  ASSERT_EQ(v3::any_shared_ptr_cast<Base2>(any), static_pointer_cast<Base2>(derived));
+  ASSERT_EQ(v3::any_shared_ptr_cast<const volatile Base1>(any), static_pointer_cast<const volatile Base1>(derived));
+  // failed casts
+  ASSERT_FALSE(v3::any_shared_ptr_cast<int>(&any));
+  ASSERT_THROW(v3::any_shared_ptr_cast<int>(any), bad_any_shared_ptr_cast);
+
+  // cv-qualifiers can't be dropped
+  const v3::any_shared_ptr const_any = v3::make_any_shared_ptr<const Derived>();
+  ASSERT_EQ(const_any.type(), typeid(shared_ptr<const Derived>));
+  ASSERT_TRUE(v3::any_shared_ptr_cast<const Base2>(&const_any));
+  ASSERT_FALSE(v3::any_shared_ptr_cast<Derived>(&const_any));
+  ASSERT_FALSE(v3::any_shared_ptr_cast<Base2>(&const_any));
+}
+
+TEST(v3_any_shared_ptr, adopt_shared_ptr)
+{
+  const shared_ptr<Derived> derived = make_shared<Derived>();
+  const v3::any_shared_ptr any{ derived };
+  ASSERT_EQ(any.type(), typeid(shared_ptr<Derived>));
+  ASSERT_EQ(any.use_count(), 2);
+  ASSERT_EQ(v3::any_shared_ptr_cast<Derived>(any), derived);
+  ASSERT_EQ(v3::any_shared_ptr_cast<Base2>(any), static_pointer_cast<Base2>(derived));
+
+  const v3::any_shared_ptr const_any{ shared_ptr<const Derived>{ derived } };
+  ASSERT_EQ(const_any.type(), typeid(shared_ptr<const Derived>));
+  ASSERT_FALSE(v3::any_shared_ptr_cast<Derived>(&const_any));
+  ASSERT_EQ(v3::any_shared_ptr_cast<const Derived>(const_any), derived);
+}
+
+TEST(v3_any_shared_ptr, use_count)
+{
+  v3::any_shared_ptr any = v3::make_any_shared_ptr<int>(42);
+  ASSERT_EQ(any.use_count(), 1);
+
+  v3::any_shared_ptr copy{ any };
+  ASSERT_EQ(any.use_count(), 2);
+  ASSERT_EQ(copy.use_count(), 2);
+  {
+    const shared_ptr<int> p = v3::any_shared_ptr_cast<int>(any);
+    ASSERT_EQ(*p, 42);
+    // The handles share a single shared_ptr so they count as one here
+    ASSERT_EQ(p.use_count(), 2);
+    ASSERT_EQ(any.use_count(), 3);
+  }
+  ASSERT_EQ(any.use_count(), 2);
+
+  v3::any_shared_ptr moved{ std::move(copy) };
+  ASSERT_EQ(copy.use_count(), 0);
+  ASSERT_EQ(moved.use_count(), 2);
+  moved.reset();
+  ASSERT_FALSE(moved.has_value());
+  ASSERT_EQ(any.use_count(), 1);
+}
+
+TEST(v3_any_shared_ptr, lifetime)
+{
+  bool destroyed{ false };
+  shared_ptr<Base2> base;
+  {
+    v3::any_shared_ptr any = v3::make_any_shared_ptr<Tracked>(destroyed);
+    v3::any_shared_ptr copy;
+    copy = any;
+    base = v3::any_shared_ptr_cast<Base2>(copy);
+  }
+  // The result of the cast keeps the object alive
+  ASSERT_FALSE(destroyed);
+  ASSERT_EQ(base->b2, 2);
+  base.reset();
+  ASSERT_TRUE(destroyed);
+
+  destroyed = false;
+  {
+    const v3::any_shared_ptr any{ shared_ptr<Tracked>(new Tracked{ destroyed }) };
+  }
+  ASSERT_TRUE(destroyed);
+}
+
+TEST(v3_any_shared_ptr, over_aligned)
+{
+  const v3::any_shared_ptr any = v3::make_any_shared_ptr<OverAligned>();
+  const shared_ptr<OverAligned> ptr = v3::any_shared_ptr_cast<OverAligned>(any);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr.get()) % alignof(OverAligned), 0u);
+  ASSERT_EQ(ptr->value, 42);
+}
+
+TEST(v3_any_shared_ptr, assignment_and_swap)
+{
+  v3::any_shared_ptr any1 = v3::make_any_shared_ptr<int>(1);
+  v3::any_shared_ptr any2 = v3::make_any_shared_ptr<Derived>();
+  any1.swap(any2);
+  ASSERT_EQ(any1.type(), typeid(shared_ptr<Derived>));
+  ASSERT_EQ(*v3::any_shared_ptr_cast<int>(any2), 1);
+
+  any1 = any1;
+  ASSERT_EQ(any1.use_count(), 1);
+  any2 = std::move(any1);
+  ASSERT_FALSE(any1.has_value());
+  ASSERT_TRUE(v3::any_shared_ptr_cast<Base1>(&any2));
+}
+
+TEST(v3_any_shared_ptr, call_site_cache)
+{
+  const v3::any_shared_ptr any = v3::make_any_shared_ptr<Derived>();
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(v3::any_shared_ptr_cast<Base2>(any), ANY_SHARED_PTR_CAST(Base2, any));
+    ASSERT_FALSE(ANY_SHARED_PTR_CAST(int, &any));
+  }
+}
+
+TEST(v3_any_shared_ptr, concurrent_copies)
+{
+  bool destroyed{ false };
+  {
+    const v3::any_shared_ptr any = v3::make_any_shared_ptr<Tracked>(destroyed);
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([any] {
+        for (int j = 0; j < 10000; ++j) {
+          const v3::any_shared_ptr copy{ any };
+          ASSERT_TRUE(v3::any_shared_ptr_cast<Base2>(&copy));
+        }
+      });
+    }
+    for (thread & t : threads) {
+      t.join();
+    }
+    ASSERT_EQ(any.use_count(), 1);
+  }
+  ASSERT_TRUE(destroyed);
+}